@@ -0,0 +1,246 @@
+#include "captureEncoder.hpp"
+
+void captureEncoder::initCaptureEncoder(captureFormat initFormat, const std::string& initPath, uint32_t initFps){
+    format = initFormat;
+    path = initPath;
+    fps = initFps;
+}
+
+void captureEncoder::encodeFrame(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, uint64_t frame){
+    switch (format){
+        case captureFormat::png:
+            writePng(pixels, width, height, bgra, frame);
+            break;
+        case captureFormat::raw:
+            writeRaw(pixels, width, height, bgra, frame);
+            break;
+        case captureFormat::y4m:
+            writeY4mFrame(pixels, width, height, bgra);
+            break;
+        case captureFormat::off:
+            break;
+    }
+}
+
+void captureEncoder::closeEncoder(){
+    if (stream.is_open()){
+        stream.close();
+    }
+}
+
+std::string captureEncoder::getFrameName(uint64_t frame, const std::string& extension){
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%06llu", static_cast<unsigned long long>(frame));
+    return path + number + extension;
+}
+
+void captureEncoder::writePng(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, uint64_t frame){
+    // Rgb with no filtering, every row is a zero filter byte and then the pixels with the alpha dropped
+    size_t rowSize = 1 + static_cast<size_t>(width) * 3;
+    scratch.resize(rowSize * height);
+    uint32_t red = bgra ? 2 : 0;
+    uint32_t blue = bgra ? 0 : 2;
+    for (uint32_t y = 0; y < height; y++){
+        uint8_t* row = scratch.data() + y * rowSize;
+        const uint8_t* source = pixels + static_cast<size_t>(y) * width * 4;
+        row[0] = 0;
+        for (uint32_t x = 0; x < width; x++){
+            row[1 + x * 3] = source[x * 4 + red];
+            row[2 + x * 3] = source[x * 4 + 1];
+            row[3 + x * 3] = source[x * 4 + blue];
+        }
+    }
+    
+    std::ofstream output(getFrameName(frame, ".png"), std::ios::binary);
+    if (!output.is_open()){
+        throw std::runtime_error("Failed to open capture file!");
+    }
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    output.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+    
+    // Width, height, 8 bits, truecolor, deflate, adaptive filtering, no interlace
+    chunk.assign(13, 0);
+    for (int i = 0; i < 4; i++){
+        chunk[i] = static_cast<uint8_t>(width >> (24 - i * 8));
+        chunk[4 + i] = static_cast<uint8_t>(height >> (24 - i * 8));
+    }
+    chunk[8] = 8;
+    chunk[9] = 2;
+    writeChunk(output, "IHDR", chunk);
+    
+    // A zlib stream made of stored blocks, each one holds up to 65535 bytes as is behind a five byte header
+    const size_t blockSize = 65535;
+    size_t blocks = std::max<size_t>(1, (scratch.size() + blockSize - 1) / blockSize);
+    chunk.clear();
+    chunk.reserve(2 + blocks * 5 + scratch.size() + 4);
+    chunk.push_back(0x78);
+    chunk.push_back(0x01);
+    for (size_t offset = 0, block = 0; block < blocks; block++, offset += blockSize){
+        size_t size = std::min(blockSize, scratch.size() - offset);
+        uint16_t length = static_cast<uint16_t>(size);
+        uint16_t inverse = static_cast<uint16_t>(~length);
+        chunk.push_back(block + 1 == blocks ? 1 : 0);
+        chunk.push_back(static_cast<uint8_t>(length));
+        chunk.push_back(static_cast<uint8_t>(length >> 8));
+        chunk.push_back(static_cast<uint8_t>(inverse));
+        chunk.push_back(static_cast<uint8_t>(inverse >> 8));
+        chunk.insert(chunk.end(), scratch.begin() + offset, scratch.begin() + offset + size);
+    }
+    uint32_t adler = adler32(scratch.data(), scratch.size());
+    for (int i = 0; i < 4; i++){
+        chunk.push_back(static_cast<uint8_t>(adler >> (24 - i * 8)));
+    }
+    writeChunk(output, "IDAT", chunk);
+    
+    chunk.clear();
+    writeChunk(output, "IEND", chunk);
+}
+
+void captureEncoder::writeChunk(std::ofstream& output, const char* type, const std::vector<uint8_t>& data){
+    // Big endian length, the type, the data and then a crc over the type and data
+    uint8_t header[8];
+    uint32_t length = static_cast<uint32_t>(data.size());
+    for (int i = 0; i < 4; i++){
+        header[i] = static_cast<uint8_t>(length >> (24 - i * 8));
+        header[4 + i] = static_cast<uint8_t>(type[i]);
+    }
+    uint32_t crc = crc32(header + 4, 4);
+    crc = crc32(data.data(), data.size(), crc);
+    uint8_t footer[4];
+    for (int i = 0; i < 4; i++){
+        footer[i] = static_cast<uint8_t>(crc >> (24 - i * 8));
+    }
+    
+    output.write(reinterpret_cast<const char*>(header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(data.data()), data.size());
+    output.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+}
+
+void captureEncoder::writeRaw(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, uint64_t frame){
+    // Always rgba on disk so whatever reads them doesn't need to know what the swapchain was, the size goes in the name since there's no header
+    const uint8_t* output = pixels;
+    size_t size = static_cast<size_t>(width) * height * 4;
+    if (bgra){
+        scratch.resize(size);
+        for (size_t i = 0; i < size; i += 4){
+            scratch[i] = pixels[i + 2];
+            scratch[i + 1] = pixels[i + 1];
+            scratch[i + 2] = pixels[i];
+            scratch[i + 3] = pixels[i + 3];
+        }
+        output = scratch.data();
+    }
+    
+    std::string extension = "_" + std::to_string(width) + "x" + std::to_string(height) + ".rgba";
+    std::ofstream file(getFrameName(frame, extension), std::ios::binary);
+    if (!file.is_open()){
+        throw std::runtime_error("Failed to open capture file!");
+    }
+    file.write(reinterpret_cast<const char*>(output), size);
+}
+
+void captureEncoder::openY4mStream(uint32_t width, uint32_t height){
+    closeEncoder();
+    streamSegment++;
+    std::string filename = streamSegment == 1 ? path + ".y4m" : path + "_" + std::to_string(streamSegment) + ".y4m";
+    stream.open(filename, std::ios::binary);
+    if (!stream.is_open()){
+        throw std::runtime_error("Failed to open capture file!");
+    }
+    streamWidth = width;
+    streamHeight = height;
+    
+    // Full range 4:2:0 with the chroma centered between rows, the same as a jpeg
+    stream << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+}
+
+void captureEncoder::writeY4mFrame(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra){
+    if (!stream.is_open() || width != streamWidth || height != streamHeight){
+        openY4mStream(width, height);
+    }
+    
+    // Bt.601 in 8 bit fixed point, the chroma comes from the average of each 2x2 block with the last row and column repeated for odd sizes
+    uint32_t chromaWidth = (width + 1) / 2;
+    uint32_t chromaHeight = (height + 1) / 2;
+    size_t lumaSize = static_cast<size_t>(width) * height;
+    size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+    scratch.resize(lumaSize + chromaSize * 2);
+    uint8_t* luma = scratch.data();
+    uint8_t* blueDifference = luma + lumaSize;
+    uint8_t* redDifference = blueDifference + chromaSize;
+    uint32_t redOffset = bgra ? 2 : 0;
+    uint32_t blueOffset = bgra ? 0 : 2;
+    
+    for (size_t i = 0; i < lumaSize; i++){
+        int r = pixels[i * 4 + redOffset];
+        int g = pixels[i * 4 + 1];
+        int b = pixels[i * 4 + blueOffset];
+        luma[i] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+    }
+    
+    for (uint32_t cy = 0; cy < chromaHeight; cy++){
+        for (uint32_t cx = 0; cx < chromaWidth; cx++){
+            int r = 0;
+            int g = 0;
+            int b = 0;
+            for (uint32_t dy = 0; dy < 2; dy++){
+                for (uint32_t dx = 0; dx < 2; dx++){
+                    uint32_t x = std::min(cx * 2 + dx, width - 1);
+                    uint32_t y = std::min(cy * 2 + dy, height - 1);
+                    const uint8_t* pixel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+                    r += pixel[redOffset];
+                    g += pixel[1];
+                    b += pixel[blueOffset];
+                }
+            }
+            // Sums of four, so the extra shift by two takes the average
+            int cb = 128 + ((-43 * r - 85 * g + 128 * b + 512) >> 10);
+            int cr = 128 + ((128 * r - 107 * g - 21 * b + 512) >> 10);
+            blueDifference[cy * chromaWidth + cx] = static_cast<uint8_t>(std::min(255, std::max(0, cb)));
+            redDifference[cy * chromaWidth + cx] = static_cast<uint8_t>(std::min(255, std::max(0, cr)));
+        }
+    }
+    
+    stream << "FRAME\n";
+    stream.write(reinterpret_cast<const char*>(scratch.data()), scratch.size());
+}
+
+uint32_t captureEncoder::crc32(const uint8_t* data, size_t size, uint32_t crc){
+    // The png crc, table built on first use and the running value passed back in to continue it
+    static uint32_t table[256] = {};
+    static bool tableBuilt = false;
+    if (!tableBuilt){
+        for (uint32_t n = 0; n < 256; n++){
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++){
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        tableBuilt = true;
+    }
+    
+    uint32_t c = crc ^ 0xffffffffu;
+    for (size_t i = 0; i < size; i++){
+        c = table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffffu;
+}
+
+uint32_t captureEncoder::adler32(const uint8_t* data, size_t size, uint32_t adler){
+    // The sums only need reducing every few thousand bytes before they could overflow
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size > 0){
+        size_t run = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < run; i++){
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += run;
+        size -= run;
+    }
+    return (b << 16) | a;
+}
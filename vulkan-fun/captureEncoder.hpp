@@ -0,0 +1,45 @@
+#ifndef captureEncoder_hpp
+#define captureEncoder_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "settings.hpp"
+
+// Turns read back frames into files, only ever used from the capture thread so it keeps its scratch memory between frames
+// PNGs are written with stored deflate blocks, no compressor to pull in and the encoder stays well ahead of the frame rate, the files are just big
+class captureEncoder{
+public:
+    void initCaptureEncoder(captureFormat initFormat, const std::string& initPath, uint32_t initFps);
+    // Pixels are tightly packed 8 bit rgba, or bgra when the swapchain was, frame numbers go in the file names so dropped frames show up as gaps
+    void encodeFrame(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, uint64_t frame);
+    void closeEncoder();
+private:
+    captureFormat format;
+    std::string path;
+    uint32_t fps;
+    std::vector<uint8_t> scratch;
+    std::vector<uint8_t> chunk;
+    
+    // A y4m stream can't change size, a resize starts a new file
+    std::ofstream stream;
+    uint32_t streamWidth = 0;
+    uint32_t streamHeight = 0;
+    uint32_t streamSegment = 0;
+    
+    std::string getFrameName(uint64_t frame, const std::string& extension);
+    void writePng(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, uint64_t frame);
+    void writeRaw(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, uint64_t frame);
+    void writeY4mFrame(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra);
+    void openY4mStream(uint32_t width, uint32_t height);
+    void writeChunk(std::ofstream& output, const char* type, const std::vector<uint8_t>& data);
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+    static uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+};
+
+#endif /* captureEncoder_hpp */
@@ -0,0 +1,311 @@
+#include "clusteredLights.hpp"
+
+namespace {
+    const uint32_t binWorkgroup = 64;
+    // The biggest count the sweep asks for
+    const uint32_t sweepMaximum = 4096;
+    
+    void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess){
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    
+    // Good enough to scatter lights around and the same every run, so sweeps can be compared
+    float nextRandom(uint32_t& state){
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / 16777216.0f;
+    }
+}
+
+void clusteredLights::loadShaders(pipelineManager* initPipelineManager){
+    pPipelineManager = initPipelineManager;
+    pPipelineManager->loadShader("lightbin.spv");
+}
+
+void clusteredLights::initClusteredLights(devices* initDevices, settings* initSettings, uint32_t initFramesInFlight){
+    pDevices = initDevices;
+    pSettings = initSettings;
+    framesInFlight = initFramesInFlight;
+    start = std::chrono::steady_clock::now();
+    
+    // The lights, the grid and the index list get read by the fragment shader too, the counter is only for binning
+    VkDescriptorSetLayoutBinding bindings[4]{};
+    for (uint32_t i = 0; i < 4; i++){
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | (i < 3 ? VK_SHADER_STAGE_FRAGMENT_BIT : 0);
+    }
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = bindings;
+    
+    if (vkCreateDescriptorSetLayout(pDevices->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create light descriptor set layout!");
+    }
+    
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = framesInFlight * 4;
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = framesInFlight;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    
+    if (vkCreateDescriptorPool(pDevices->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create light descriptor pool!");
+    }
+    
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+    
+    std::vector<VkDescriptorSet> sets(framesInFlight);
+    if (vkAllocateDescriptorSets(pDevices->device, &allocInfo, sets.data()) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate light descriptor sets!");
+    }
+    
+    // Room for everything the settings or the sweep could ask for, so the buffers never have to grow
+    sweeping = pSettings->lightSweep;
+    lightCapacity = std::max({pSettings->lights, sweeping ? sweepMaximum : 0u, 1u});
+    clusterBuffer = createBuffer(clusterCount * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryCategory::buffers);
+    indexBuffer = createBuffer(clusterCount * maxLightsPerCluster * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryCategory::buffers);
+    counterBuffer = createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryCategory::buffers);
+    
+    lightBuffers.resize(framesInFlight);
+    for (uint32_t i = 0; i < framesInFlight; i++){
+        lightBuffer& target = lightBuffers[i];
+        target.storage = createBuffer(sizeof(lightHeader) + lightCapacity * sizeof(lightData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memoryCategory::buffers);
+        if (vkMapMemory(pDevices->device, target.storage.memory, 0, VK_WHOLE_SIZE, 0, &target.mapped) != VK_SUCCESS){
+            throw std::runtime_error("Failed to map light buffer!");
+        }
+        target.descriptorSet = sets[i];
+        
+        VkDescriptorBufferInfo bufferInfos[4] = {
+            {target.storage.buffer, 0, VK_WHOLE_SIZE},
+            {clusterBuffer.buffer, 0, VK_WHOLE_SIZE},
+            {indexBuffer.buffer, 0, VK_WHOLE_SIZE},
+            {counterBuffer.buffer, 0, VK_WHOLE_SIZE}
+        };
+        VkWriteDescriptorSet writes[4]{};
+        for (uint32_t binding = 0; binding < 4; binding++){
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = target.descriptorSet;
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[binding].pBufferInfo = &bufferInfos[binding];
+        }
+        vkUpdateDescriptorSets(pDevices->device, 4, writes, 0, nullptr);
+    }
+    
+    setLightCount(sweeping ? sweepCounts[0] : pSettings->lights);
+}
+
+clusteredLights::buffer clusteredLights::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, memoryCategory category){
+    buffer result;
+    
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    
+    if (vkCreateBuffer(pDevices->device, &bufferInfo, nullptr, &result.buffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create light buffer!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(pDevices->device, result.buffer, &memoryRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, properties);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, category, &result.memory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate light memory!");
+    }
+    vkBindBufferMemory(pDevices->device, result.buffer, result.memory, 0);
+    return result;
+}
+
+void clusteredLights::destroyBuffer(buffer& target){
+    vkDestroyBuffer(pDevices->device, target.buffer, nullptr);
+    pDevices->memoryBudget.free(target.memory);
+    target.buffer = VK_NULL_HANDLE;
+    target.memory = VK_NULL_HANDLE;
+}
+
+void clusteredLights::createPipelines(){
+    pushConstantLayout pushConstants;
+    binRange = pushConstants.addRange<binConstants>(VK_SHADER_STAGE_COMPUTE_BIT);
+    pushConstants.checkLimits(pDevices->physicalDevice);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pushConstants.fillLayoutInfo(pipelineLayoutInfo);
+    
+    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &binLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create light binning pipeline layout!");
+    }
+    
+    shaderVariant binVariant{VK_SHADER_STAGE_COMPUTE_BIT, "lightbin.spv", {}};
+    binVariant.constants.set(0, gridX).set(1, gridY).set(2, gridZ).set(3, maxLightsPerCluster);
+    binPipeline = pPipelineManager->getComputePipeline(binVariant, binLayout, pipelineLayoutInfo);
+}
+
+void clusteredLights::setLightCount(uint32_t count){
+    // Scattered over the middle of the scene in front of the triangles, each one circling its own spot
+    uint32_t state = 12345;
+    lights.resize(std::min(count, lightCapacity));
+    for (size_t i = 0; i < lights.size(); i++){
+        lightSource& light = lights[i];
+        light.centerX = nextRandom(state) * 2.4f - 1.2f;
+        light.centerY = nextRandom(state) * 2.0f - 1.0f;
+        light.z = 0.2f + nextRandom(state) * 0.2f;
+        light.orbit = 0.05f + nextRandom(state) * 0.15f;
+        light.speed = 0.5f + nextRandom(state) * 1.5f;
+        light.phase = nextRandom(state) * 6.2831853f;
+        light.radius = 0.08f + nextRandom(state) * 0.12f;
+        // Never all three low, so nothing ends up black
+        for (float& channel : light.color){
+            channel = 0.2f + nextRandom(state) * 0.8f;
+        }
+        if (i < pSettings->shadowLights){
+            light.speed = 0.0f;
+        }
+    }
+}
+
+void clusteredLights::update(uint32_t frame){
+    currentFrame = frame;
+    
+    // Each step holds its count for a while before the next one, and it's back to the settings' count once the sweep is done
+    if (sweeping){
+        if (sweepFrame == sweepFrames){
+            sweepFrame = 0;
+            sweepStep++;
+            if (sweepStep == sweepSteps){
+                sweeping = false;
+                setLightCount(pSettings->lights);
+                std::cout << "Light sweep finished" << std::endl;
+            } else {
+                setLightCount(sweepCounts[sweepStep]);
+            }
+        }
+        sweepFrame++;
+    }
+    
+    std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+    float seconds = elapsed.count();
+    
+    char* mapped = static_cast<char*>(lightBuffers[currentFrame].mapped);
+    lightHeader header{};
+    header.lightCount = static_cast<uint32_t>(lights.size());
+    header.ambient = lights.empty() ? 1.0f : 0.15f;
+    std::memcpy(mapped, &header, sizeof(header));
+    
+    lightData* destination = reinterpret_cast<lightData*>(mapped + sizeof(lightHeader));
+    frameLights.resize(lights.size());
+    for (size_t i = 0; i < lights.size(); i++){
+        const lightSource& light = lights[i];
+        float angle = light.phase + seconds * light.speed;
+        lightData& data = frameLights[i];
+        data.position[0] = light.centerX + std::cos(angle) * light.orbit;
+        data.position[1] = light.centerY + std::sin(angle) * light.orbit;
+        data.position[2] = light.z;
+        data.radius = light.radius;
+        std::copy(light.color, light.color + 3, data.color);
+        data.intensity = 1.5f;
+        std::fill(data.shadowTile, data.shadowTile + 4, 0.0f);
+        destination[i] = data;
+    }
+}
+
+void clusteredLights::recordBinning(VkCommandBuffer commandBuffer, const float* viewProjection){
+    // The last frame's fragments are still reading the grid and the list this is about to rewrite
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdFillBuffer(commandBuffer, counterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    
+    binConstants constants{};
+    std::copy(viewProjection, viewProjection + 16, constants.viewProjection);
+    
+    VkDescriptorSet set = getDescriptorSet();
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, binPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, binLayout, 0, 1, &set, 0, nullptr);
+    commands::pushConstants(commandBuffer, binLayout, binRange, constants);
+    vkCmdDispatch(commandBuffer, (clusterCount + binWorkgroup - 1) / binWorkgroup, 1, 1);
+    
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void clusteredLights::recordGpuTime(double milliseconds){
+    // Nothing to go on without timestamps, and the first frames of a step can still be the last count finishing
+    if (!sweeping || milliseconds < 0.0 || sweepFrame <= sweepWarmup){
+        return;
+    }
+    sweepMilliseconds[sweepStep] += milliseconds;
+    sweepSamples[sweepStep]++;
+}
+
+VkDescriptorSet clusteredLights::getDescriptorSet(){
+    return lightBuffers[currentFrame].descriptorSet;
+}
+
+uint32_t clusteredLights::getLightCount(){
+    return static_cast<uint32_t>(frameLights.size());
+}
+
+const lightData& clusteredLights::getLight(uint32_t light){
+    return frameLights[light];
+}
+
+uint32_t clusteredLights::getShadowLightCount(){
+    return std::min(pSettings->shadowLights, getLightCount());
+}
+
+void clusteredLights::setShadowTile(uint32_t light, const float* tile){
+    lightData& data = frameLights[light];
+    std::copy(tile, tile + 4, data.shadowTile);
+    lightData* destination = reinterpret_cast<lightData*>(static_cast<char*>(lightBuffers[currentFrame].mapped) + sizeof(lightHeader));
+    std::memcpy(destination[light].shadowTile, data.shadowTile, sizeof(data.shadowTile));
+}
+
+void clusteredLights::printSummary(){
+    if (sweepSamples[0] == 0){
+        return;
+    }
+    std::cout << "Light sweep, " << gridX << "x" << gridY << "x" << gridZ << " clusters, at most " << maxLightsPerCluster << " lights each" << std::endl;
+    for (uint32_t step = 0; step < sweepSteps && sweepSamples[step] > 0; step++){
+        std::cout << "  " << sweepCounts[step] << " lights: " << sweepMilliseconds[step] / sweepSamples[step] << " ms gpu over " << sweepSamples[step] << " frames" << std::endl;
+    }
+}
+
+void clusteredLights::destroyClusteredLights(){
+    // The pipeline goes with the pipeline manager
+    for (lightBuffer& target : lightBuffers){
+        vkUnmapMemory(pDevices->device, target.storage.memory);
+        destroyBuffer(target.storage);
+    }
+    lightBuffers.clear();
+    destroyBuffer(clusterBuffer);
+    destroyBuffer(indexBuffer);
+    destroyBuffer(counterBuffer);
+    vkDestroyPipelineLayout(pDevices->device, binLayout, nullptr);
+    vkDestroyDescriptorPool(pDevices->device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(pDevices->device, descriptorSetLayout, nullptr);
+}
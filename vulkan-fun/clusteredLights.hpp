@@ -0,0 +1,146 @@
+#ifndef clusteredLights_hpp
+#define clusteredLights_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "devices.hpp"
+#include "pipelineManager.hpp"
+#include "settings.hpp"
+#include "commands.hpp"
+
+// Lines up with the lights buffer in lightbin.comp and shaderfrag.frag
+struct lightData {
+    float position[3];
+    float radius;
+    float color[3];
+    float intensity;
+    // Where the light's tile is in the shadow atlas as an offset and a size in uv, then the near plane it was drawn with, 0 for no shadow
+    float shadowTile[4];
+};
+
+// Sits in front of the lights in the same buffer
+struct lightHeader {
+    uint32_t lightCount;
+    // Everything gets this much of its own color before any light is added, all of it when there are no lights so the scene looks the same as unlit
+    float ambient;
+    uint32_t padding[2];
+};
+
+// Lines up with the push_constant block in lightbin.comp
+struct binConstants {
+    // Column major, the same transform the main pass pushes
+    float viewProjection[16];
+};
+
+// Lots of point lights for the main pass without every pixel looking at every light
+// Each frame a compute pass sorts the lights into a grid of clusters over the screen and depth, each cluster gets a run of a shared list of light indices
+// The fragment shader works out its cluster and only loops over that run, so the cost per pixel depends on how many lights overlap it and not how many there are
+class clusteredLights{
+public:
+    // The grid, in tiles across, tiles down and slices of depth, the shaders get it as specialization constants
+    // The projection is orthographic, so the depth slices are even instead of growing with distance
+    static constexpr uint32_t gridX = 16;
+    static constexpr uint32_t gridY = 9;
+    static constexpr uint32_t gridZ = 24;
+    static constexpr uint32_t clusterCount = gridX * gridY * gridZ;
+    // Anything past this in one cluster gets dropped, it's what keeps the worst pixel bounded
+    static constexpr uint32_t maxLightsPerCluster = 128;
+    
+    // Only touches the disk, so it can run before there's a device
+    void loadShaders(pipelineManager* initPipelineManager);
+    // The set layout has to exist before the main pipeline gets made, so this makes it straight away
+    void initClusteredLights(devices* initDevices, settings* initSettings, uint32_t initFramesInFlight);
+    void createPipelines();
+    // Once a frame on the render thread once the frame's fence has been waited on, moves the lights and writes them into the frame's buffer
+    void update(uint32_t frame);
+    // Compute, ahead of anything that draws lit
+    void recordBinning(VkCommandBuffer commandBuffer, const float* viewProjection);
+    // Fed the gpu time of every finished frame, only does anything while sweeping
+    void recordGpuTime(double milliseconds);
+    // Set 2 of the main pipeline, the frame's lights and the grid they got binned into
+    VkDescriptorSet getDescriptorSet();
+    // Where the lights are this frame, as of the last update
+    uint32_t getLightCount();
+    const lightData& getLight(uint32_t light);
+    // The first this many lights cast shadows, they hold still so their shadows can stay cached
+    uint32_t getShadowLightCount();
+    // After update, goes straight into this frame's copy of the light
+    void setShadowTile(uint32_t light, const float* tile);
+    void printSummary();
+    void destroyClusteredLights();
+    
+    VkDescriptorSetLayout descriptorSetLayout;
+private:
+    struct buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+    
+    // Written by the cpu every frame, so there's one per frame in flight
+    struct lightBuffer {
+        buffer storage;
+        void* mapped = nullptr;
+        VkDescriptorSet descriptorSet;
+    };
+    
+    // Where each light circles around, update turns these into positions
+    struct lightSource {
+        float centerX;
+        float centerY;
+        float z;
+        float orbit;
+        float speed;
+        float phase;
+        float radius;
+        float color[3];
+    };
+    
+    // Counts the sweep runs through, every one held for sweepFrames frames
+    static constexpr uint32_t sweepCounts[] = {0, 16, 64, 256, 1024, 4096};
+    static constexpr uint32_t sweepSteps = sizeof(sweepCounts) / sizeof(sweepCounts[0]);
+    static constexpr uint32_t sweepFrames = 240;
+    // Frames at the start of a step that still have the last count in flight, their times get thrown away
+    static constexpr uint32_t sweepWarmup = 16;
+    
+    devices* pDevices;
+    pipelineManager* pPipelineManager;
+    settings* pSettings;
+    uint32_t framesInFlight;
+    uint32_t currentFrame = 0;
+    
+    VkDescriptorPool descriptorPool;
+    VkPipelineLayout binLayout;
+    pushConstantRange<binConstants> binRange;
+    VkPipeline binPipeline;
+    
+    std::vector<lightBuffer> lightBuffers;
+    uint32_t lightCapacity;
+    std::vector<lightSource> lights;
+    std::vector<lightData> frameLights;
+    std::chrono::steady_clock::time_point start;
+    
+    // Only ever touched by the gpu, one of each does since every frame's commands run one after the other on the graphics queue
+    // An offset and count per cluster, the light indices they point into, and the counter the binning hands out room in the list with
+    buffer clusterBuffer;
+    buffer indexBuffer;
+    buffer counterBuffer;
+    
+    bool sweeping = false;
+    uint32_t sweepStep = 0;
+    uint32_t sweepFrame = 0;
+    double sweepMilliseconds[sweepSteps] = {};
+    uint32_t sweepSamples[sweepSteps] = {};
+    
+    void setLightCount(uint32_t count);
+    buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, memoryCategory category);
+    void destroyBuffer(buffer& target);
+};
+
+#endif /* clusteredLights_hpp */
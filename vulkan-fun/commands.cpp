@@ -1,74 +1,206 @@
 #include "commands.hpp"
 
-void commands::initCommands(devices* initDevices, swapchain* initSwapchain, framebuffer* initFramebuffer, renderPass* initRenderpass, graphicsPipeline* initGraphicsPipeline){
+void commands::initCommands(devices* initDevices, swapchain* initSwapchain, renderGraph* initRenderGraph, deletionQueue* initDeletionQueue){
     pDevices = initDevices;
     pSwapchain = initSwapchain;
-    pFramebuffer = initFramebuffer;
-    pRenderpass = initRenderpass;
-    pGraphicsPipeline = initGraphicsPipeline;
+    pRenderGraph = initRenderGraph;
+    pDeletionQueue = initDeletionQueue;
     
-    createCommandPool();
+    createCommandPools();
+    createTimestampPool();
     createCommandBuffers();
 }
 
-void commands::createCommandPool(){
-    // Creates the object that stores all of the command buffer objects
+void commands::createCommandPools(){
+    // Creates the objects that store the command buffers, transient since every buffer gets rerecorded each time it's used
     QueueFamilyIndices queueFamilyIndices = pDevices->findQueueFamilies(pDevices->physicalDevice);
     
     VkCommandPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
     
-    if (vkCreateCommandPool(pDevices->device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS){
-        throw std::runtime_error("Failed to create command pool!");
+    commandPools.clear();
+    for (size_t i = 0; i < pSwapchain->swapChainImages.size(); i++){
+        VkCommandPool commandPool;
+        if (vkCreateCommandPool(pDevices->device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create command pool!");
+        }
+        commandPools.emplace_back(pDevices->device, commandPool, vkDestroyCommandPool, pDeletionQueue);
+    }
+    
+    // Pools belong to a queue family, so the async half of the frame needs its own on the compute family
+    asyncCommandPools.clear();
+    if (pRenderGraph->hasAsyncWork()){
+        poolInfo.queueFamilyIndex = pDevices->computeQueueFamily;
+        for (size_t i = 0; i < pSwapchain->swapChainImages.size(); i++){
+            VkCommandPool commandPool;
+            if (vkCreateCommandPool(pDevices->device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS){
+                throw std::runtime_error("Failed to create async compute command pool!");
+            }
+            asyncCommandPools.emplace_back(pDevices->device, commandPool, vkDestroyCommandPool, pDeletionQueue);
+        }
     }
 }
 
-void commands::createCommandBuffers(){
-    // I believe that each command buffer is for each frame becuase each frame contains multiple draw calls for each tri
-    // So this double nested container thing does make some sense I guess
-    // Uses the framebuffer to determine the size that is needed for the command buffer
-    commandBuffers.resize(pFramebuffer->swapChainFramebuffers.size());
+void commands::createTimestampPool(){
+    // Not every queue can do timestamps, without them the frame pacer just goes off cpu timings
+    timestampPool.reset();
     
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
+    QueueFamilyIndices queueFamilyIndices = pDevices->findQueueFamilies(pDevices->physicalDevice);
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(pDevices->physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(pDevices->physicalDevice, &queueFamilyCount, queueFamilies.data());
     
-    if (vkAllocateCommandBuffers(pDevices->device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate command buffers!");
+    // The frame starts on the graphics queue and ends on the compute one when it's split, both have to be able to write them
+    uint32_t validBits = queueFamilies[queueFamilyIndices.graphicsFamily.value()].timestampValidBits;
+    if (pRenderGraph->hasAsyncWork()){
+        validBits = std::min(validBits, queueFamilies[pDevices->computeQueueFamily].timestampValidBits);
+    }
+    if (validBits == 0){
+        return;
     }
+    timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+    
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(pDevices->physicalDevice, &properties);
+    timestampPeriod = properties.limits.timestampPeriod;
+    
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = static_cast<uint32_t>(pSwapchain->swapChainImages.size() * 2);
+    
+    VkQueryPool queryPool;
+    if (vkCreateQueryPool(pDevices->device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create timestamp query pool!");
+    }
+    timestampPool = uniqueHandle<VkQueryPool>(pDevices->device, queryPool, vkDestroyQueryPool, pDeletionQueue);
+}
+
+void commands::createCommandBuffers(){
+    // One per swapchain image since the render graph picks the framebuffers for that image, drawFrame records each one right before it gets submitted
+    commandBuffers.resize(pSwapchain->swapChainImages.size());
+    asyncCommandBuffers.resize(asyncCommandPools.size());
     
     for (size_t i = 0; i < commandBuffers.size(); i++){
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPools[i].get();
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
         
-        if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS){
-            throw std::runtime_error("Failed to being recording command buffer");
+        if (vkAllocateCommandBuffers(pDevices->device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate command buffers!");
         }
         
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = pRenderpass->renderPass;
-        renderPassInfo.framebuffer = pFramebuffer->swapChainFramebuffers[i];
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = pSwapchain->swapChainExtent;
-        
-        VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-        
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pGraphicsPipeline->graphicsPipeline);
-        vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-        vkCmdEndRenderPass(commandBuffers[i]);
-        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS){
+        if (!asyncCommandPools.empty()){
+            allocInfo.commandPool = asyncCommandPools[i].get();
+            if (vkAllocateCommandBuffers(pDevices->device, &allocInfo, &asyncCommandBuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate async compute command buffers!");
+            }
+        }
+    }
+}
+
+VkCommandBuffer commands::beginCommandBuffer(VkCommandPool commandPool, VkCommandBuffer commandBuffer){
+    // Resetting the whole pool is cheaper than resetting the buffer on its own and there's only the one buffer in it
+    vkResetCommandPool(pDevices->device, commandPool, 0);
+    
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS){
+        throw std::runtime_error("Failed to being recording command buffer");
+    }
+    return commandBuffer;
+}
+
+void commands::recordCommandBuffer(uint32_t imageIndex){
+    VkCommandBuffer commandBuffer = beginCommandBuffer(commandPools[imageIndex].get(), commandBuffers[imageIndex]);
+    
+    uint32_t firstQuery = imageIndex * 2;
+    if (timestampPool){
+        vkCmdResetQueryPool(commandBuffer, timestampPool.get(), firstQuery, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool.get(), firstQuery);
+    }
+    
+    // The graph records every pass with its barriers, render passes and draws
+    pRenderGraph->execute(commandBuffer, imageIndex);
+    
+    // The async half goes in its own buffer for the compute queue and the end timestamp goes with it
+    if (!asyncCommandBuffers.empty()){
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
             throw std::runtime_error("Failed to record command buffer!");
         }
+        commandBuffer = beginCommandBuffer(asyncCommandPools[imageIndex].get(), asyncCommandBuffers[imageIndex]);
+        pRenderGraph->executeAsync(commandBuffer, imageIndex);
+    }
+    
+    if (timestampPool){
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool.get(), firstQuery + 1);
+    }
+    
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to record command buffer!");
     }
 }
 
-void commands::destroyCommands(){
-    vkDestroyCommandPool(pDevices->device, commandPool, nullptr);
+double commands::getGpuTime(uint32_t imageIndex){
+    // Only call this once the fence for the image's last submit has signaled, otherwise the results aren't there yet
+    if (!timestampPool){
+        return -1.0;
+    }
+    
+    uint64_t timestamps[2];
+    if (vkGetQueryPoolResults(pDevices->device, timestampPool.get(), imageIndex * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS){
+        return -1.0;
+    }
+    
+    uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+    return ticks * timestampPeriod / 1000000.0;
+}
+
+void commands::submitOnce(devices* pDevices, const std::function<void(VkCommandBuffer)>& record){
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = pDevices->graphicsQueueFamily;
+    
+    // No deletion queue, it's waited on before this returns so it can go straight away however this returns
+    VkCommandPool newPool;
+    if (vkCreateCommandPool(pDevices->device, &poolInfo, nullptr, &newPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create one time command pool!");
+    }
+    uniqueHandle<VkCommandPool> commandPool(pDevices->device, newPool, vkDestroyCommandPool);
+    
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool.get();
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(pDevices->device, &allocInfo, &commandBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate one time command buffer!");
+    }
+    
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    
+    record(commandBuffer);
+    
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS || vkQueueSubmit(pDevices->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS){
+        throw std::runtime_error("Failed to submit one time command buffer!");
+    }
+    vkQueueWaitIdle(pDevices->graphicsQueue);
 }
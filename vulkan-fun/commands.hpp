@@ -5,29 +5,50 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <iostream>
+#include <functional>
 #include "devices.hpp"
 #include "swapchain.hpp"
-#include "frameBuffer.hpp"
-#include "renderPass.hpp"
-#include "graphicsPipeline.hpp"
+#include "renderGraph.hpp"
+#include "pushConstants.hpp"
+#include "vulkanHandle.hpp"
 
+// Calling initCommands again replaces the pools, the old ones and the buffers in them go through the deletion queue
 class commands{
 public:
-    void initCommands(devices* initDevices, swapchain* initSwapchain, framebuffer* initFramebuffer, renderPass* initRenderpass, graphicsPipeline* initGraphicsPipeline);
-    void destroyCommands();
+    void initCommands(devices* initDevices, swapchain* initSwapchain, renderGraph* initRenderGraph, deletionQueue* initDeletionQueue);
+    // Safe to call from any thread as long as no two calls share an image index and the image's last submit has finished
+    void recordCommandBuffer(uint32_t imageIndex);
+    // Gpu time in milliseconds the last submit of that image's command buffer took, negative when it can't be measured
+    double getGpuTime(uint32_t imageIndex);
+    // Writes per draw data straight into the command buffer, the range has to come from the layout the bound pipeline was made with
+    template<typename T>
+    static void pushConstants(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const pushConstantRange<T>& range, const T& data){
+        vkCmdPushConstants(commandBuffer, pipelineLayout, range.stages, range.offset, static_cast<uint32_t>(sizeof(T)), &data);
+    }
+    // Records into a throwaway buffer, submits it on the graphics queue and waits for it, only for setup while nothing else is submitting
+    static void submitOnce(devices* pDevices, const std::function<void(VkCommandBuffer)>& record);
     
     std::vector<VkCommandBuffer> commandBuffers;
+    // Only there when the render graph has passes for the async compute queue, submitted after commandBuffers on the compute queue
+    std::vector<VkCommandBuffer> asyncCommandBuffers;
 private:
-    void createCommandPool();
+    void createCommandPools();
     void createCommandBuffers();
+    VkCommandBuffer beginCommandBuffer(VkCommandPool commandPool, VkCommandBuffer commandBuffer);
+    void createTimestampPool();
     
-    VkCommandPool commandPool;
+    // One pool per swapchain image, pools can't be used from two threads at once so this lets images be recorded in parallel
+    std::vector<uniqueHandle<VkCommandPool>> commandPools;
+    std::vector<uniqueHandle<VkCommandPool>> asyncCommandPools;
+    // Two timestamps per swapchain image, one at the start and one at the end of its frame, which is the async buffer when there is one
+    uniqueHandle<VkQueryPool> timestampPool;
+    double timestampPeriod;
+    uint64_t timestampMask;
     
     devices* pDevices;
     swapchain* pSwapchain;
-    framebuffer* pFramebuffer;
-    renderPass* pRenderpass;
-    graphicsPipeline* pGraphicsPipeline;
+    renderGraph* pRenderGraph;
+    deletionQueue* pDeletionQueue;
 };
 
 #endif /* commands_hpp */
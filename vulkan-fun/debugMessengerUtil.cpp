@@ -22,12 +22,162 @@ VKAPI_ATTR VkBool32 VKAPI_CALL debugMessengerUtil::debugCallback(
     VkDebugUtilsMessageTypeFlagsEXT messageType,
     const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
     void* pUserData){
+#ifndef NDEBUG
+    // Runs on whatever thread made the call the layer is complaining about, so all it does is count the message and hand it off
+    if (pUserData != nullptr){
+        static_cast<debugMessengerUtil*>(pUserData)->handleMessage(messageSeverity, pCallbackData);
+        return VK_FALSE;
+    }
+#endif
     // Whenever the validation layer decided to talk back via the callback just throw it into a cerr 
     std::cerr << "Validation Layer: " << pCallbackData->pMessage << std::endl;
     
     return VK_FALSE;
 }
 
+#ifndef NDEBUG
+void debugMessengerUtil::handleMessage(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData){
+    // Instance creation and destruction report through here before the formatter starts and after it stops, those few just get printed straight away
+    if (!formatterRunning.load(std::memory_order_acquire)){
+        std::cerr << "Validation Layer: " << pCallbackData->pMessage << std::endl;
+        return;
+    }
+    
+    uint32_t key = getKey(pCallbackData);
+    messageCounter* counter = findCounter(key);
+    // A full table means more distinct ids than anyone can read anyway, those just always go through
+    uint64_t occurrence = counter != nullptr ? counter->count.fetch_add(1, std::memory_order_relaxed) + 1 : 1;
+    if (!shouldPrint(occurrence)){
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    validationMessage message;
+    message.severity = messageSeverity;
+    message.key = key;
+    message.occurrence = occurrence;
+    const char* idName = pCallbackData->pMessageIdName != nullptr ? pCallbackData->pMessageIdName : "";
+    std::strncpy(message.idName, idName, sizeof(message.idName) - 1);
+    message.idName[sizeof(message.idName) - 1] = '\0';
+    const char* text = pCallbackData->pMessage != nullptr ? pCallbackData->pMessage : "";
+    std::strncpy(message.text, text, sizeof(message.text) - 1);
+    message.text[sizeof(message.text) - 1] = '\0';
+    
+    if (!log->ring.push(message)){
+        ringDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t debugMessengerUtil::getKey(const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData){
+    // The layers give most messages a number, the ones without get told apart by their name or failing that their text
+    if (pCallbackData->messageIdNumber != 0){
+        return static_cast<uint32_t>(pCallbackData->messageIdNumber);
+    }
+    const char* source = pCallbackData->pMessageIdName != nullptr ? pCallbackData->pMessageIdName : pCallbackData->pMessage;
+    uint32_t hash = 2166136261u;
+    for (const char* c = source; c != nullptr && *c != '\0'; c++){
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    // Zero marks an empty counter slot
+    return hash == 0 ? 1 : hash;
+}
+
+debugMessengerUtil::messageCounter* debugMessengerUtil::findCounter(uint32_t key){
+    // Open addressing, a slot's key is set once and never changes so a match found without the exchange is still good
+    for (size_t probe = 0; probe < counterSlots; probe++){
+        messageCounter& counter = log->counters[(key + probe) & (counterSlots - 1)];
+        uint32_t existing = counter.key.load(std::memory_order_acquire);
+        if (existing == key){
+            return &counter;
+        }
+        if (existing == 0){
+            if (counter.key.compare_exchange_strong(existing, key, std::memory_order_acq_rel) || existing == key){
+                return &counter;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool debugMessengerUtil::shouldPrint(uint64_t occurrence){
+    if (occurrence <= printLimit){
+        return true;
+    }
+    while (occurrence % 10 == 0){
+        occurrence /= 10;
+    }
+    return occurrence == 1;
+}
+
+const char* debugMessengerUtil::getSeverityName(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity){
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT){
+        return "error";
+    }
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT){
+        return "warning";
+    }
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT){
+        return "info";
+    }
+    return "verbose";
+}
+
+void debugMessengerUtil::runFormatter(){
+    // Polls instead of being woken, a wakeup would need a lock in the callback and a few milliseconds late doesn't matter for a log
+    validationMessage message;
+    while (true){
+        bool stop = stopping.load(std::memory_order_acquire);
+        bool printed = false;
+        while (log->ring.pop(message)){
+            printMessage(message);
+            printed = true;
+        }
+        if (stop){
+            return;
+        }
+        if (!printed){
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+}
+
+void debugMessengerUtil::printMessage(const validationMessage& message){
+    if (idNames.count(message.key) == 0){
+        idNames.emplace(message.key, message.idName[0] != '\0' ? message.idName : message.text);
+    }
+    
+    if (message.occurrence <= printLimit){
+        std::cerr << "Validation Layer (" << getSeverityName(message.severity) << "): " << message.text << std::endl;
+        if (message.occurrence == printLimit){
+            std::cerr << "Validation Layer: " << idNames[message.key] << " keeps coming up, only counting it from now on" << std::endl;
+        }
+    } else {
+        std::cerr << "Validation Layer: " << idNames[message.key] << " seen " << message.occurrence << " times" << std::endl;
+    }
+}
+
+void debugMessengerUtil::printSummary(){
+    // Counts for everything that got held back, biggest first
+    std::vector<std::pair<uint64_t, uint32_t>> repeated;
+    for (const auto& counter : log->counters){
+        uint64_t count = counter.count.load(std::memory_order_relaxed);
+        if (count > printLimit){
+            repeated.push_back({count, counter.key.load(std::memory_order_relaxed)});
+        }
+    }
+    if (repeated.empty() && ringDropped.load() == 0){
+        return;
+    }
+    std::sort(repeated.rbegin(), repeated.rend());
+    
+    std::cerr << "Validation Layer: " << suppressed.load() << " repeated messages not printed, " << ringDropped.load() << " lost to a full ring" << std::endl;
+    for (const auto& entry : repeated){
+        auto name = idNames.find(entry.second);
+        std::cerr << "    " << entry.first << "x " << (name != idNames.end() ? name->second : "unnamed message") << std::endl;
+    }
+}
+#endif
+
 void debugMessengerUtil::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo){
     // Broken out to its own function so that it can be reused in multiple places
     // Fill out the settings structure with what we want, maybe this could be moved to a settings.txt file at some point
@@ -36,7 +186,9 @@ void debugMessengerUtil::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerC
     createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
     createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
     createInfo.pfnUserCallback = debugCallback;
-    // Maybe not needed createInfo.pUserData = nullptr;
+#ifndef NDEBUG
+    createInfo.pUserData = this;
+#endif
 }
 
 void debugMessengerUtil::setupDebugMessenger(const bool* pEnableValidationLayers, VkInstance* pInstance){
@@ -45,6 +197,13 @@ void debugMessengerUtil::setupDebugMessenger(const bool* pEnableValidationLayers
     VkDebugUtilsMessengerCreateInfoEXT createInfo;
     populateDebugMessengerCreateInfo(createInfo);
     
+#ifndef NDEBUG
+    log = std::make_unique<messageLog>();
+    stopping.store(false);
+    formatterThread = std::thread(&debugMessengerUtil::runFormatter, this);
+    formatterRunning.store(true, std::memory_order_release);
+#endif
+    
     // Creates the actual messenger mechanism
     if(CreateDebugUtilsMessengerEXT(*pInstance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS){
         throw std::runtime_error("failed to setup debug messenger");
@@ -53,4 +212,14 @@ void debugMessengerUtil::setupDebugMessenger(const bool* pEnableValidationLayers
 
 void debugMessengerUtil::destroyDebugMessengerUtil(VkInstance* pInstance){
     DestoryDebugUtilsMessengerEXT(*pInstance, debugMessenger, nullptr);
+    
+#ifndef NDEBUG
+    // Whatever is still in the ring gets printed before the thread goes, anything after this prints straight from the callback again
+    formatterRunning.store(false, std::memory_order_release);
+    if (formatterThread.joinable()){
+        stopping.store(true, std::memory_order_release);
+        formatterThread.join();
+        printSummary();
+    }
+#endif
 }
@@ -4,7 +4,22 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <iostream>
+#ifndef NDEBUG
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include "mpscQueue.hpp"
+#endif
 
+// Validation layer output, the callback only copies the message into a ring and a thread of its own formats and prints it
+// Each message id is counted and only the first few of each (and then every power of ten) get printed, so a chatty layer can't slow the app down
+// Release builds never turn validation on, so none of the ring or the thread exists in them
 class debugMessengerUtil {
 public:
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
@@ -14,6 +29,52 @@ public:
 private:
     VkDebugUtilsMessengerEXT debugMessenger;
     
+#ifndef NDEBUG
+    // Fixed size so the callback never allocates, anything longer gets cut off
+    struct validationMessage {
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        uint32_t key;
+        uint64_t occurrence;
+        char idName[128];
+        char text[2048];
+    };
+    
+    // One per message id, claimed with a compare exchange the first time the id shows up
+    struct messageCounter {
+        std::atomic<uint32_t> key{0};
+        std::atomic<uint64_t> count{0};
+    };
+    
+    static constexpr size_t ringSize = 256;
+    static constexpr size_t counterSlots = 1024;
+    // How many of each id get printed in full before it drops to every power of ten
+    static constexpr uint64_t printLimit = 3;
+    
+    // Together they're too big for the stack the vulkan object lives on
+    struct messageLog {
+        mpscQueue<validationMessage, ringSize> ring;
+        messageCounter counters[counterSlots];
+    };
+    
+    std::unique_ptr<messageLog> log;
+    std::thread formatterThread;
+    std::atomic<bool> formatterRunning{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> ringDropped{0};
+    std::atomic<uint64_t> suppressed{0};
+    // Formatter thread only, the first name seen for each id so the summary can say what it was
+    std::unordered_map<uint32_t, std::string> idNames;
+    
+    void handleMessage(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+    messageCounter* findCounter(uint32_t key);
+    void runFormatter();
+    void printMessage(const validationMessage& message);
+    void printSummary();
+    static uint32_t getKey(const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+    static bool shouldPrint(uint64_t occurrence);
+    static const char* getSeverityName(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity);
+#endif
+    
     VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
     void DestoryDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator);
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData);
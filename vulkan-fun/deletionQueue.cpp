@@ -0,0 +1,39 @@
+#include "deletionQueue.hpp"
+
+void deletionQueue::initDeletionQueue(uint32_t initFramesToKeep){
+    framesToKeep = initFramesToKeep;
+}
+
+void deletionQueue::push(std::function<void()> destroy){
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back({frame, std::move(destroy)});
+}
+
+void deletionQueue::nextFrame(){
+    // Anything pushed framesToKeep frames ago was last used by a frame whose fence has been waited on by now
+    std::deque<entry> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        frame++;
+        while (!entries.empty() && entries.front().frame + framesToKeep <= frame){
+            ready.push_back(std::move(entries.front()));
+            entries.pop_front();
+        }
+    }
+    
+    // Run outside the lock so a destroy can push something else
+    for (auto& readyEntry : ready){
+        readyEntry.destroy();
+    }
+}
+
+void deletionQueue::flush(){
+    std::deque<entry> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(entries);
+    }
+    for (auto& readyEntry : ready){
+        readyEntry.destroy();
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef deletionQueue_hpp
+#define deletionQueue_hpp
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+// Destroying something a frame in flight still uses is undefined, so anything swapped out while running goes in here instead
+// Each entry runs once enough frames have gone by that every frame that could have used it has finished
+class deletionQueue{
+public:
+    // framesToKeep is how many frames can be in flight at once
+    void initDeletionQueue(uint32_t initFramesToKeep);
+    void push(std::function<void()> destroy);
+    // Called once a frame right after waiting on that frame's fence
+    void nextFrame();
+    // Runs everything left, only once the device is idle
+    void flush();
+private:
+    struct entry {
+        uint64_t frame;
+        std::function<void()> destroy;
+    };
+    
+    std::mutex mutex;
+    std::deque<entry> entries;
+    uint64_t frame = 0;
+    uint32_t framesToKeep;
+};
+
+#endif /* deletionQueue_hpp */
@@ -4,12 +4,13 @@ bool QueueFamilyIndices::isComplete(){
    return graphicsFamily.has_value() && presentFamily.has_value();
 }
 
-void devices::initDeviceSetup(VkSurfaceKHR* initSurface, const std::vector<const char*>* initDeviceExtensions, const bool* initEnableValidationLayers, const std::vector<const char*>* initValidationLayers){
+void devices::initDeviceSetup(VkSurfaceKHR* initSurface, const std::vector<const char*>* initDeviceExtensions, const bool* initEnableValidationLayers, const std::vector<const char*>* initValidationLayers, settings* initSettings){
     //Sets some pointers that are used by private functions and through the rest of the class
     pSurface = initSurface;
     pDeviceExtensions = initDeviceExtensions;
     pEnableValidationLayers = initEnableValidationLayers;
     pValidationLayers = initValidationLayers;
+    pSettings = initSettings;
 }
 
 void devices::pickPhysicalDevice(VkInstance* pInstance) {
@@ -24,16 +25,195 @@ void devices::pickPhysicalDevice(VkInstance* pInstance) {
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(*pInstance, &deviceCount, devices.data());
     
+    // Every suitable device gets a score and the best one wins, so a hybrid laptop or a box with llvmpipe installed still lands on the real gpu
+    std::vector<deviceScore> scores;
     for (const auto& device : devices){
-        if(isDeviceSuitable(device)){
-            physicalDevice = device;
-            break;
+        scores.push_back(scoreDevice(device));
+    }
+    
+    const std::string& deviceOverride = pSettings->deviceOverride;
+    bool overrideFound = false;
+    for (const auto& score : scores){
+        overrideFound = overrideFound || (score.suitable && score.overrideMatch);
+    }
+    if (!deviceOverride.empty() && !overrideFound){
+        std::cerr << "No suitable device matches VKFUN_DEVICE " << deviceOverride << ", picking by score instead" << std::endl;
+    }
+    
+    const deviceScore* best = nullptr;
+    for (const auto& score : scores){
+        if (!score.suitable || (overrideFound && !score.overrideMatch)){
+            continue;
+        }
+        if (best == nullptr || score.total > best->total){
+            best = &score;
         }
     }
     
-    if (physicalDevice == VK_NULL_HANDLE){
+    std::cout << "Device candidates:" << std::endl;
+    for (const auto& score : scores){
+        std::cout << "  " << (&score == best ? "* " : "  ") << score.name << " [" << score.uuid << "]";
+        if (!score.suitable){
+            std::cout << " (not suitable)" << std::endl;
+            continue;
+        }
+        std::cout << " score " << score.total << (score.overrideMatch ? " (matches VKFUN_DEVICE)" : "") << std::endl << "     ";
+        for (const auto& part : score.breakdown){
+            std::cout << " " << part.first << " " << part.second;
+        }
+        std::cout << std::endl;
+    }
+    
+    if (best == nullptr){
         throw std::runtime_error("Failed to find suitable GPU!");
     }
+    physicalDevice = best->device;
+    std::cout << "Using " << best->name << std::endl;
+}
+
+deviceScore devices::scoreDevice(VkPhysicalDevice device){
+    // Points are loosely "how much would this help", device type dominates and the rest mostly breaks ties between similar cards
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(device, &features);
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+    
+    deviceScore score{};
+    score.device = device;
+    score.name = properties.deviceName;
+    score.uuid = getDeviceUUID(device);
+    score.suitable = isDeviceSuitable(device);
+    score.overrideMatch = !pSettings->deviceOverride.empty() && matchesOverride(device, pSettings->deviceOverride);
+    if (!score.suitable){
+        return score;
+    }
+    
+    // Software rasterizers like llvmpipe report as cpu and should only ever be the last resort
+    int64_t typeScore = 0;
+    switch (properties.deviceType){
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            typeScore = 10000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            typeScore = 5000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            typeScore = 2000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            typeScore = 0;
+            break;
+        default:
+            typeScore = 100;
+            break;
+    }
+    score.breakdown.push_back({"type", typeScore});
+    
+    // A point per 16MB of device local memory, capped so a huge card doesn't outweigh the device type
+    VkDeviceSize deviceLocal = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++){
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT){
+            deviceLocal += memoryProperties.memoryHeaps[i].size;
+        }
+    }
+    score.breakdown.push_back({"vram", std::min<int64_t>(static_cast<int64_t>(deviceLocal / (16 * 1024 * 1024)), 2000)});
+    
+    // Separate compute and transfer families mean async work can actually run alongside graphics
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+    
+    bool dedicatedCompute = false;
+    bool dedicatedTransfer = false;
+    for (const auto& family : queueFamilies){
+        if ((family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT)){
+            dedicatedCompute = true;
+        }
+        if ((family.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))){
+            dedicatedTransfer = true;
+        }
+    }
+    QueueFamilyIndices indices = findQueueFamilies(device);
+    int64_t queueScore = (dedicatedCompute ? 300 : 0) + (dedicatedTransfer ? 200 : 0) + (indices.graphicsFamily == indices.presentFamily ? 200 : 0);
+    score.breakdown.push_back({"queues", queueScore});
+    
+    int64_t limitScore = properties.limits.maxImageDimension2D / 64 + properties.limits.maxComputeSharedMemorySize / 1024 + properties.limits.maxPushConstantsSize / 2;
+    score.breakdown.push_back({"limits", limitScore});
+    
+    int64_t featureScore = (features.samplerAnisotropy ? 100 : 0) + (features.multiDrawIndirect ? 100 : 0) + (features.drawIndirectFirstInstance ? 50 : 0);
+    if (pSettings->backend == renderBackend::dynamicRendering && supportsDynamicRendering(device)){
+        featureScore += 200;
+    }
+    score.breakdown.push_back({"features", featureScore});
+    
+    for (const auto& part : score.breakdown){
+        score.total += part.second;
+    }
+    return score;
+}
+
+bool devices::matchesOverride(VkPhysicalDevice device, const std::string& deviceOverride){
+    // Everything is compared lowercase, and uuids with or without the dashes
+    auto lowercase = [](std::string text){
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){ return std::tolower(c); });
+        return text;
+    };
+    
+    std::string kind = "name";
+    std::string value = lowercase(deviceOverride);
+    size_t colon = value.find(':');
+    if (colon != std::string::npos){
+        kind = value.substr(0, colon);
+        value = value.substr(colon + 1);
+    }
+    
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    
+    if (kind == "name"){
+        return lowercase(properties.deviceName).find(value) != std::string::npos;
+    }
+    
+    if (kind == "vendor"){
+        const std::pair<const char*, uint32_t> vendors[] = {
+            {"nvidia", 0x10DE}, {"amd", 0x1002}, {"intel", 0x8086}, {"apple", 0x106B}, {"arm", 0x13B5}, {"qualcomm", 0x5143}, {"mesa", 0x10005}
+        };
+        for (const auto& vendor : vendors){
+            if (value == vendor.first){
+                return properties.vendorID == vendor.second;
+            }
+        }
+        return properties.vendorID == static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 16));
+    }
+    
+    if (kind == "uuid"){
+        value.erase(std::remove(value.begin(), value.end(), '-'), value.end());
+        return getDeviceUUID(device) == value;
+    }
+    
+    std::cerr << "Unknown VKFUN_DEVICE kind " << kind << ", expected name, vendor or uuid" << std::endl;
+    return false;
+}
+
+std::string devices::getDeviceUUID(VkPhysicalDevice device){
+    // Stays the same across driver updates and reboots unlike the enumeration order, so it's the most reliable way to pin a device
+    VkPhysicalDeviceIDProperties idProperties{};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties2(device, &properties);
+    
+    std::string uuid;
+    char hex[3];
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++){
+        std::snprintf(hex, sizeof(hex), "%02x", idProperties.deviceUUID[i]);
+        uuid += hex;
+    }
+    return uuid;
 }
 
 bool devices::isDeviceSuitable(VkPhysicalDevice device){
@@ -68,8 +248,8 @@ bool devices::checkDeviceExtensionSupport(VkPhysicalDevice device){
     return requiredExtensions.empty();
 }
 
-bool devices::isPortableSpec(VkPhysicalDevice device){
-    // Gets extensions and checks if VK_KHR_portability_subset is around and if it is return true
+bool devices::hasDeviceExtension(VkPhysicalDevice device, const char* extensionName){
+    // Gets extensions and checks if the one asked for is around
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
     
@@ -77,13 +257,65 @@ bool devices::isPortableSpec(VkPhysicalDevice device){
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
     
     for (const auto& extension : availableExtensions){
-        if (strcmp(extension.extensionName, "VK_KHR_portability_subset") == 0){
+        if (strcmp(extension.extensionName, extensionName) == 0){
             return true;
         }
     }
     return false;
 }
 
+bool devices::isPortableSpec(VkPhysicalDevice device){
+    // If VK_KHR_portability_subset is around it has to be turned on
+    return hasDeviceExtension(device, "VK_KHR_portability_subset");
+}
+
+bool devices::supportsDynamicRendering(VkPhysicalDevice device){
+    // Needs the extension (plus the ones it depends on since we're on 1.1) and the feature bit actually set
+#ifdef VK_KHR_dynamic_rendering
+    if (!hasDeviceExtension(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) || !hasDeviceExtension(device, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) || !hasDeviceExtension(device, VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME)){
+        return false;
+    }
+    
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &dynamicRenderingFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    
+    return dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+#else
+    // Headers are too old to know about it
+    return false;
+#endif
+}
+
+bool devices::supportsPresentWait(VkPhysicalDevice device){
+    // Present wait hangs off present id, both extensions and both feature bits have to be there
+#if defined(VK_KHR_present_id) && defined(VK_KHR_present_wait)
+    if (!hasDeviceExtension(device, VK_KHR_PRESENT_ID_EXTENSION_NAME) || !hasDeviceExtension(device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)){
+        return false;
+    }
+    
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.pNext = &presentIdFeatures;
+    
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &presentWaitFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    
+    return presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+#else
+    return false;
+#endif
+}
+
 QueueFamilyIndices devices::findQueueFamilies(VkPhysicalDevice device){
     // Sorts through the queues that the device supports and makes sure it supports VK_QUEUE_GRAPHICS_BIT
     QueueFamilyIndices indices;
@@ -94,46 +326,104 @@ QueueFamilyIndices devices::findQueueFamilies(VkPhysicalDevice device){
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
     
-    int i = 0;
-    for (const auto& queueFamily : queueFamilies){
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT){
+    // Graphics takes the first family that has it, present prefers the graphics family so they can share a queue
+    // Compute and transfer take the first family dedicated to them
+    for (uint32_t i = 0; i < queueFamilyCount; i++){
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        
+        if ((flags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()){
             indices.graphicsFamily = i;
         }
         
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, *pSurface, &presentSupport);
         
-        if(presentSupport){
+        if (presentSupport && (!indices.presentFamily.has_value() || indices.graphicsFamily == i)){
             indices.presentFamily = i;
         }
         
-        if (indices.isComplete()){
-            break;
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && !indices.computeFamily.has_value()){
+            indices.computeFamily = i;
         }
         
-        i++;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && !indices.transferFamily.has_value()){
+            indices.transferFamily = i;
+        }
     }
     
     return indices;
 }
 
-void devices::createLogicalDevice(){
-    // Filling out some structs for eventual logical device creation
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+void devices::pickQueues(const QueueFamilyIndices& indices, std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos){
+    // Best case every kind of work gets its own family, next best is a second queue in a family that's already used, last resort is sharing the graphics queue
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
     
-    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    graphicsSlot = {indices.graphicsFamily.value(), 0};
+    presentSlot = {indices.presentFamily.value(), 0};
+    
+    if (indices.computeFamily.has_value()){
+        computeSlot = {indices.computeFamily.value(), 0};
+    } else if (queueFamilies[graphicsSlot.family].queueCount > 1){
+        computeSlot = {graphicsSlot.family, 1};
+    } else {
+        computeSlot = graphicsSlot;
+    }
+    
+    // Compute queues can always do transfers, so with no transfer family the uploads go next to compute instead
+    if (indices.transferFamily.has_value()){
+        transferSlot = {indices.transferFamily.value(), 0};
+    } else if (queueFamilies[computeSlot.family].queueCount > computeSlot.index + 1){
+        transferSlot = {computeSlot.family, computeSlot.index + 1};
+    } else {
+        transferSlot = computeSlot;
+    }
+    
+    computeAliasesGraphics = computeSlot.family == graphicsSlot.family && computeSlot.index == graphicsSlot.index;
+    transferAliasesGraphics = transferSlot.family == graphicsSlot.family && transferSlot.index == graphicsSlot.index;
+    graphicsQueueFamily = graphicsSlot.family;
+    computeQueueFamily = computeSlot.family;
+    transferQueueFamily = transferSlot.family;
+    
+    // One create info per family asking for as many queues as the highest index used in it
+    std::map<uint32_t, uint32_t> queueCounts;
+    for (const queueSlot& slot : {graphicsSlot, presentSlot, computeSlot, transferSlot}){
+        queueCounts[slot.family] = std::max(queueCounts[slot.family], slot.index + 1);
+    }
     
-    float queuePriority = 1.0f;
-    for (uint32_t queueFamily : uniqueQueueFamilies){
+    queuePriorities.clear();
+    for (const auto& family : queueCounts){
+        queuePriorities.push_back(std::vector<float>(family.second, 1.0f));
+        
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.queueFamilyIndex = family.first;
+        queueCreateInfo.queueCount = family.second;
+        queueCreateInfo.pQueuePriorities = queuePriorities.back().data();
         queueCreateInfos.push_back(queueCreateInfo);
     }
     
+    auto describe = [this](const queueSlot& slot, bool aliased){
+        std::string description = "family " + std::to_string(slot.family) + " queue " + std::to_string(slot.index);
+        if (aliased){
+            description += " (shared with graphics)";
+        } else if (slot.family == graphicsSlot.family){
+            description += " (second queue in the graphics family)";
+        }
+        return description;
+    };
+    std::cout << "Queues: graphics " << describe(graphicsSlot, false) << ", compute " << describe(computeSlot, computeAliasesGraphics) << ", transfer " << describe(transferSlot, transferAliasesGraphics) << std::endl;
+}
+
+void devices::createLogicalDevice(){
+    // Filling out some structs for eventual logical device creation
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    pickQueues(indices, queueCreateInfos);
+    
     // Might be used layer to get other features like a swap chain
     VkPhysicalDeviceFeatures deviceFeatures{};
     
@@ -147,14 +437,57 @@ void devices::createLogicalDevice(){
     // Check if the spec is in portable mode then activates portability subset
     std::vector<const char*> updatedDeviceExtensions = *pDeviceExtensions;
     if (isPortableSpec(physicalDevice)) {
-        std::string portablityExt = "VK_KHR_portability_subset";
-        updatedDeviceExtensions.push_back(portablityExt.c_str());
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(pDeviceExtensions->size()) + 1;
-        createInfo.ppEnabledExtensionNames = updatedDeviceExtensions.data();
-    } else {
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(pDeviceExtensions->size());
-        createInfo.ppEnabledExtensionNames = pDeviceExtensions->data();
+        updatedDeviceExtensions.push_back("VK_KHR_portability_subset");
+    }
+    
+    // Dynamic rendering is optional, if it was asked for and isn't there we just stay on render passes
+    dynamicRenderingEnabled = pSettings->backend == renderBackend::dynamicRendering && supportsDynamicRendering(physicalDevice);
+#ifdef VK_KHR_dynamic_rendering
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+    
+    if (dynamicRenderingEnabled){
+        updatedDeviceExtensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+        updatedDeviceExtensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+        updatedDeviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        createInfo.pNext = &dynamicRenderingFeatures;
+    }
+#endif
+    if (pSettings->backend == renderBackend::dynamicRendering && !dynamicRenderingEnabled){
+        std::cout << "Dynamic rendering isn't supported, falling back to render passes" << std::endl;
+    }
+    
+    // Chained in front of whatever is already there so dynamic rendering keeps its features
+    presentWaitEnabled = supportsPresentWait(physicalDevice);
+#if defined(VK_KHR_present_id) && defined(VK_KHR_present_wait)
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.presentId = VK_TRUE;
+    
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.presentWait = VK_TRUE;
+    
+    if (presentWaitEnabled){
+        updatedDeviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        updatedDeviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        presentIdFeatures.pNext = const_cast<void*>(createInfo.pNext);
+        presentWaitFeatures.pNext = &presentIdFeatures;
+        createInfo.pNext = &presentWaitFeatures;
+    }
+#endif
+    
+#ifdef VK_EXT_memory_budget
+    // Only adds numbers to a query, nothing changes if it isn't there
+    memoryBudgetEnabled = hasDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudgetEnabled){
+        updatedDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
     }
+#endif
+    
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(updatedDeviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = updatedDeviceExtensions.data();
 
     // Validation Layers for the logical device if they are enabled to begin with
     if(*pEnableValidationLayers){
@@ -168,10 +501,50 @@ void devices::createLogicalDevice(){
         throw std::runtime_error("Failed to create logical device!");
     }
     
-    vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-    vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    vkGetDeviceQueue(device, graphicsSlot.family, graphicsSlot.index, &graphicsQueue);
+    vkGetDeviceQueue(device, presentSlot.family, presentSlot.index, &presentQueue);
+    vkGetDeviceQueue(device, computeSlot.family, computeSlot.index, &computeQueue);
+    vkGetDeviceQueue(device, transferSlot.family, transferSlot.index, &transferQueue);
+    memoryBudget.initMemoryBudget(physicalDevice, device, memoryBudgetEnabled);
+    
+#ifdef VK_KHR_dynamic_rendering
+    // Extension functions aren't exported by the loader so they have to be looked up
+    if (dynamicRenderingEnabled){
+        cmdBeginRendering = (PFN_vkCmdBeginRenderingKHR) vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR");
+        cmdEndRendering = (PFN_vkCmdEndRenderingKHR) vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR");
+        
+        if (cmdBeginRendering == nullptr || cmdEndRendering == nullptr){
+            throw std::runtime_error("Failed to load dynamic rendering functions!");
+        }
+    }
+#endif
+    
+#ifdef VK_KHR_present_wait
+    if (presentWaitEnabled){
+        waitForPresent = (PFN_vkWaitForPresentKHR) vkGetDeviceProcAddr(device, "vkWaitForPresentKHR");
+        
+        if (waitForPresent == nullptr){
+            throw std::runtime_error("Failed to load present wait function!");
+        }
+    }
+#endif
+}
+
+uint32_t devices::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties){
+    // Each resource says which memory types it can live in with a bitmask, pick the first one that also has the properties we want
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++){
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties){
+            return i;
+        }
+    }
+    
+    throw std::runtime_error("Failed to find suitable memory type!");
 }
 
 void devices::destroyDevices(){
+    memoryBudget.destroyMemoryBudget();
     vkDestroyDevice(device, nullptr);
 }
@@ -8,37 +8,105 @@
 #include <stdexcept>
 #include <optional>
 #include <set>
+#include <map>
 #include <string>
+#include <utility>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include "querySwapchainSupport.hpp"
+#include "settings.hpp"
+#include "memoryBudget.hpp"
 
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Only families without graphics count here, those are the ones that can actually run next to the graphics queue
+    std::optional<uint32_t> computeFamily;
+    std::optional<uint32_t> transferFamily;
     
     bool isComplete();
 };
 
+// Why a device scored what it did, kept around so the choice can be logged
+struct deviceScore {
+    VkPhysicalDevice device;
+    std::string name;
+    std::string uuid;
+    bool suitable;
+    bool overrideMatch;
+    int64_t total;
+    std::vector<std::pair<std::string, int64_t>> breakdown;
+};
+
 class devices{
 public:
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    // For work that should overlap graphics, culling, post processing, particles and uploads
+    // When there's no separate queue to be had these are just the graphics queue again, check the aliases flags before submitting from another thread
+    VkQueue computeQueue;
+    VkQueue transferQueue;
+    uint32_t graphicsQueueFamily;
+    uint32_t computeQueueFamily;
+    uint32_t transferQueueFamily;
+    bool computeAliasesGraphics = true;
+    bool transferAliasesGraphics = true;
     
-    void initDeviceSetup(VkSurfaceKHR* initSurface, const std::vector<const char*>* initDeviceExtensions, const bool* initEnableValidationLayers, const std::vector<const char*>* initValidationLayers);
+    // Only true when it was asked for in the settings and the device actually supports it
+    bool dynamicRenderingEnabled = false;
+    // Every allocation goes through this, it reads the driver's budget when VK_EXT_memory_budget is there and guesses from the heap sizes when it isn't
+    memoryBudget memoryBudget;
+    bool memoryBudgetEnabled = false;
+#ifdef VK_KHR_dynamic_rendering
+    PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+#endif
+    // Lets the cpu see when a present actually reached the screen, only for measuring latency so nothing breaks without it
+    bool presentWaitEnabled = false;
+#ifdef VK_KHR_present_wait
+    PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+#endif
+    
+    void initDeviceSetup(VkSurfaceKHR* initSurface, const std::vector<const char*>* initDeviceExtensions, const bool* initEnableValidationLayers, const std::vector<const char*>* initValidationLayers, settings* initSettings);
     void pickPhysicalDevice(VkInstance* pInstance);
     void createLogicalDevice();
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     void destroyDevices();
 private:
     VkSurfaceKHR* pSurface;
     const std::vector<const char*>* pDeviceExtensions;
     const bool* pEnableValidationLayers;
     const std::vector<const char*>* pValidationLayers;
+    settings* pSettings;
+    
+    // Where each queue comes from, filled out by pickQueues before the device exists
+    struct queueSlot {
+        uint32_t family;
+        uint32_t index;
+    };
+    queueSlot graphicsSlot;
+    queueSlot presentSlot;
+    queueSlot computeSlot;
+    queueSlot transferSlot;
+    std::vector<std::vector<float>> queuePriorities;
     
     bool isDeviceSuitable(VkPhysicalDevice device);
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool hasDeviceExtension(VkPhysicalDevice device, const char* extensionName);
     bool isPortableSpec(VkPhysicalDevice);
+    bool supportsDynamicRendering(VkPhysicalDevice device);
+    bool supportsPresentWait(VkPhysicalDevice device);
+    deviceScore scoreDevice(VkPhysicalDevice device);
+    bool matchesOverride(VkPhysicalDevice device, const std::string& deviceOverride);
+    std::string getDeviceUUID(VkPhysicalDevice device);
+    void pickQueues(const QueueFamilyIndices& indices, std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos);
 };
 
 #endif /* devices_hpp */
@@ -0,0 +1,63 @@
+#include "dynamicResolution.hpp"
+
+void dynamicResolution::initDynamicResolution(double initTargetMilliseconds, float initMinScale){
+    targetMilliseconds = initTargetMilliseconds;
+    minScale = std::min(std::max(initMinScale, 0.1f), 1.0f);
+    scale = 1.0f;
+    integral = 1.0;
+    frames = 0;
+    changes = 0;
+    scaleTotal = 0.0;
+}
+
+void dynamicResolution::recordGpuTime(double milliseconds){
+    if (milliseconds < 0.0 || targetMilliseconds <= 0.0){
+        return;
+    }
+    frames++;
+    scaleTotal += scale;
+    
+    // Positive when there's time to spare, one missed frame can't ask for more than everything back
+    double error = std::min(std::max((targetMilliseconds - milliseconds) / targetMilliseconds, -1.0), 1.0);
+    if (std::abs(error) < deadband){
+        error = 0.0;
+    }
+    
+    integral = std::min(std::max(integral + integralGain * error, static_cast<double>(minScale)), 1.0);
+    float wanted = static_cast<float>(std::min(std::max(integral + proportionalGain * error, static_cast<double>(minScale)), 1.0));
+    
+    // Hitting a limit always goes through, otherwise a scale a little under 1 could never get back to full resolution
+    bool atLimit = (wanted == 1.0f || wanted == minScale) && wanted != scale;
+    if (std::abs(wanted - scale) >= minimumStep || atLimit){
+        scale = wanted;
+        changes++;
+    }
+}
+
+float dynamicResolution::getScale(){
+    return scale;
+}
+
+VkExtent2D dynamicResolution::getRenderExtent(VkExtent2D fullExtent){
+    VkExtent2D extent;
+    extent.width = std::max(1u, static_cast<uint32_t>(fullExtent.width * scale + 0.5f));
+    extent.height = std::max(1u, static_cast<uint32_t>(fullExtent.height * scale + 0.5f));
+    extent.width = std::min(extent.width, fullExtent.width);
+    extent.height = std::min(extent.height, fullExtent.height);
+    return extent;
+}
+
+void dynamicResolution::printSummary(){
+    if (frames == 0){
+        return;
+    }
+    
+    std::cout << "Dynamic resolution: " << targetMilliseconds << " ms gpu target, average scale " << scaleTotal / frames << ", now " << scale << ", " << changes << " changes over " << frames << " frames" << std::endl;
+}
+
+bool dynamicResolution::supportsFormat(VkPhysicalDevice physicalDevice, VkFormat format){
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & needed) == needed;
+}
@@ -0,0 +1,42 @@
+#ifndef dynamicResolution_hpp
+#define dynamicResolution_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+// Picks how much of the swapchain's resolution the scene renders at so the gpu stays inside its frame time budget
+// A PI controller on the measured gpu time moves the scale, a deadband around the target and a minimum step keep it from hunting back and forth
+class dynamicResolution{
+public:
+    void initDynamicResolution(double initTargetMilliseconds, float initMinScale);
+    // Fed from the timestamp queries once a frame is done, negative means there was nothing to read
+    void recordGpuTime(double milliseconds);
+    float getScale();
+    // The corner of a full size image the scene should draw into right now, never smaller than one pixel
+    VkExtent2D getRenderExtent(VkExtent2D fullExtent);
+    void printSummary();
+    // Scaling up is a linear filtered blit, which not every format can do
+    static bool supportsFormat(VkPhysicalDevice physicalDevice, VkFormat format);
+private:
+    double targetMilliseconds;
+    float minScale;
+    float scale;
+    // Where the scale would settle with no error, kept inside the scale limits so it can't wind up while pinned at one of them
+    double integral;
+    uint64_t frames;
+    uint64_t changes;
+    double scaleTotal;
+    
+    // Proportional and integral gains, the error is relative to the target so they don't depend on the frame rate
+    static constexpr double proportionalGain = 0.25;
+    static constexpr double integralGain = 0.05;
+    // Errors under 5% of the target count as on target
+    static constexpr double deadband = 0.05;
+    // The scale only moves once the controller wants it this far from where it is, each change is a visible jump in sharpness
+    static constexpr float minimumStep = 0.05f;
+};
+
+#endif /* dynamicResolution_hpp */
@@ -1,4 +1,8 @@
 #include "file.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 std::vector<char> File::readFile(const std::string& filename){
     //Basic File Reader
@@ -17,3 +21,90 @@ std::vector<char> File::readFile(const std::string& filename){
     
     return buffer;
 }
+
+void File::writeFile(const std::string& filename, const std::vector<char>& data){
+    // Overwrites whatever was there
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    
+    if (!file.is_open()){
+        throw std::runtime_error("Failed to write file!");
+    }
+    
+    file.write(data.data(), data.size());
+}
+
+bool File::exists(const std::string& filename){
+    std::ifstream file(filename, std::ios::binary);
+    return file.is_open();
+}
+
+mappedFile File::mapFile(const std::string& filename){
+    return mappedFile(filename);
+}
+
+mappedFile::mappedFile(const std::string& filename){
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0){
+        throw std::runtime_error("Failed to open file!");
+    }
+    
+    struct stat fileStat;
+    if (fstat(descriptor, &fileStat) != 0){
+        close(descriptor);
+        throw std::runtime_error("Failed to open file!");
+    }
+    mappingSize = static_cast<size_t>(fileStat.st_size);
+    
+    // Mapping nothing is an error, an empty file just has no data
+    if (mappingSize > 0){
+        void* mapped = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped == MAP_FAILED){
+            close(descriptor);
+            throw std::runtime_error("Failed to map file!");
+        }
+        // It all gets read front to back, so the kernel can read ahead as far as it likes
+        posix_madvise(mapped, mappingSize, POSIX_MADV_SEQUENTIAL);
+        posix_madvise(mapped, mappingSize, POSIX_MADV_WILLNEED);
+        mapping = static_cast<const char*>(mapped);
+    }
+    // The mapping keeps the file alive on its own
+    close(descriptor);
+}
+
+mappedFile::mappedFile(mappedFile&& other){
+    mapping = other.mapping;
+    mappingSize = other.mappingSize;
+    other.mapping = nullptr;
+    other.mappingSize = 0;
+}
+
+mappedFile& mappedFile::operator=(mappedFile&& other){
+    if (this != &other){
+        unmap();
+        mapping = other.mapping;
+        mappingSize = other.mappingSize;
+        other.mapping = nullptr;
+        other.mappingSize = 0;
+    }
+    return *this;
+}
+
+mappedFile::~mappedFile(){
+    unmap();
+}
+
+const char* mappedFile::data() const{
+    return mapping;
+}
+
+size_t mappedFile::size() const{
+    return mappingSize;
+}
+
+void mappedFile::unmap(){
+    if (mapping != nullptr){
+        munmap(const_cast<char*>(mapping), mappingSize);
+        mapping = nullptr;
+    }
+    mappingSize = 0;
+}
@@ -5,10 +5,34 @@
 #include <vector>
 #include <iostream>
 #include <string>
+#include <stdexcept>
+
+// A whole file mapped read only, the bytes come straight out of the page cache with nothing read into a buffer first
+// Unmapped when it goes away, can be moved but not copied
+class mappedFile {
+public:
+    mappedFile() = default;
+    explicit mappedFile(const std::string& filename);
+    mappedFile(mappedFile&& other);
+    mappedFile& operator=(mappedFile&& other);
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+    ~mappedFile();
+    
+    const char* data() const;
+    size_t size() const;
+    void unmap();
+private:
+    const char* mapping = nullptr;
+    size_t mappingSize = 0;
+};
 
 class File {
 public:
     static std::vector<char> readFile(const std::string& filename);
+    static void writeFile(const std::string& filename, const std::vector<char>& data);
+    static bool exists(const std::string& filename);
+    static mappedFile mapFile(const std::string& filename);
 private:
 };
 
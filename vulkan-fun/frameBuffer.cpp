@@ -1,36 +1,29 @@
 #include "frameBuffer.hpp"
 
-void framebuffer::createFramebuffers(devices* initDevices, swapchain* initSwapchain, renderPass* initRenderpass){
+void framebuffer::createFramebuffers(devices* initDevices, deletionQueue* initDeletionQueue, renderPass* initRenderpass, const std::vector<std::vector<VkImageView>>* attachmentsPerFramebuffer, VkExtent2D extent){
     pDevices = initDevices;
-    pSwapchain = initSwapchain;
     pRenderpass = initRenderpass;
     
     // Framebuffer reference all the VkImageView objects that represent the attachments
-    // I belive this is what feeds from the swapchain into the window if im not mistaken
-    swapChainFramebuffers.resize(pSwapchain->swapChainImageViews.size());
+    // There's one per swapchain image when the pass draws into the swapchain, otherwise the render graph only hands over one set of views
+    swapChainFramebuffers.clear();
     
-    for (size_t i = 0; i < pSwapchain->swapChainImageViews.size(); i++){
-        VkImageView attachments[] = {
-          pSwapchain->swapChainImageViews[i]
-        };
+    for (size_t i = 0; i < attachmentsPerFramebuffer->size(); i++){
+        const std::vector<VkImageView>& attachments = (*attachmentsPerFramebuffer)[i];
         
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = pRenderpass->renderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = pSwapchain->swapChainExtent.width;
-        framebufferInfo.height = pSwapchain->swapChainExtent.height;
+        framebufferInfo.renderPass = pRenderpass->renderPass.get();
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
         framebufferInfo.layers = 1;
         
-        if (vkCreateFramebuffer(pDevices->device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS){
+        VkFramebuffer newFramebuffer;
+        if (vkCreateFramebuffer(pDevices->device, &framebufferInfo, nullptr, &newFramebuffer) != VK_SUCCESS){
             throw std::runtime_error("Failed to create framebuffer");
         }
-    }
-}
-
-void framebuffer::destroyFramebuffers(){
-    for (auto framebuffer : swapChainFramebuffers){
-        vkDestroyFramebuffer(pDevices->device, framebuffer, nullptr);
+        swapChainFramebuffers.emplace_back(pDevices->device, newFramebuffer, vkDestroyFramebuffer, initDeletionQueue);
     }
 }
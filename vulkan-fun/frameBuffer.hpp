@@ -7,19 +7,17 @@
 #include <iostream>
 #include <stdexcept>
 #include "devices.hpp"
-#include "swapchain.hpp"
 #include "renderPass.hpp"
-#include "frameBuffer.hpp"
+#include "vulkanHandle.hpp"
 
+// Creating them again or clearing the list sends the old framebuffers through the deletion queue
 class framebuffer{
 public:
-    void createFramebuffers(devices* initDevices, swapchain* initSwapchain, renderPass* initRenderpass);
-    void destroyFramebuffers();
+    void createFramebuffers(devices* initDevices, deletionQueue* initDeletionQueue, renderPass* initRenderpass, const std::vector<std::vector<VkImageView>>* attachmentsPerFramebuffer, VkExtent2D extent);
     
-    std::vector<VkFramebuffer> swapChainFramebuffers;
+    std::vector<uniqueHandle<VkFramebuffer>> swapChainFramebuffers;
 private:
     devices* pDevices;
-    swapchain* pSwapchain;
     renderPass* pRenderpass;
 };
 
@@ -0,0 +1,247 @@
+#include "frameCapture.hpp"
+
+void frameCapture::initFrameCapture(devices* initDevices, swapchain* initSwapchain, settings* initSettings){
+    pDevices = initDevices;
+    pSwapchain = initSwapchain;
+    pSettings = initSettings;
+    currentSlot = UINT32_MAX;
+    
+    // Y4m needs a rate for its header, the target is the best guess at what the frames are paced to
+    uint32_t fps = pSettings->targetFps > 0 ? pSettings->targetFps : 60;
+    encoder.initCaptureEncoder(pSettings->capture, pSettings->capturePath, fps);
+}
+
+bool frameCapture::isSupported(){
+    VkFormat format = pSwapchain->swapChainImageFormat;
+    bool eightBit = format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    bgra = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    return eightBit && (pSwapchain->supportedUsage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+}
+
+void frameCapture::createBuffers(){
+    // Cached memory first, the encoder reads every byte and reading uncached memory from the cpu is painfully slow
+    extent = pSwapchain->swapChainExtent;
+    VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+    slotCount = std::min(pSettings->captureBuffers, maxSlots);
+    slots.reset(new readbackSlot[slotCount]);
+    
+    // The copy runs on the compute queue when the post chain does
+    std::vector<uint32_t> families = {pDevices->graphicsQueueFamily};
+    if (!pDevices->computeAliasesGraphics && pDevices->computeQueueFamily != pDevices->graphicsQueueFamily){
+        families.push_back(pDevices->computeQueueFamily);
+    }
+    
+    for (uint32_t i = 0; i < slotCount; i++){
+        readbackSlot& slot = slots[i];
+        
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        if (families.size() > 1){
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+            bufferInfo.pQueueFamilyIndices = families.data();
+        } else {
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+        
+        if (vkCreateBuffer(pDevices->device, &bufferInfo, nullptr, &slot.buffer) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create capture buffer!");
+        }
+        
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(pDevices->device, slot.buffer, &memoryRequirements);
+        
+        uint32_t memoryType;
+        try {
+            memoryType = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        } catch (const std::runtime_error&){
+            memoryType = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(pDevices->physicalDevice, &memoryProperties);
+        coherent = (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+        
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memoryRequirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+        
+        if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::staging, &slot.memory) != VK_SUCCESS){
+            throw std::runtime_error("Failed to allocate capture memory!");
+        }
+        vkBindBufferMemory(pDevices->device, slot.buffer, slot.memory, 0);
+        
+        // Mapped for as long as the buffer lives, the encoder reads straight out of it
+        if (vkMapMemory(pDevices->device, slot.memory, 0, VK_WHOLE_SIZE, 0, &slot.mapped) != VK_SUCCESS){
+            throw std::runtime_error("Failed to map capture memory!");
+        }
+    }
+    
+    if (!encoderThread.joinable()){
+        encoderThread = std::thread(&frameCapture::runEncoder, this);
+    }
+}
+
+void frameCapture::destroyBuffers(){
+    // The device is idle so whatever is still pending is done, it gets encoded rather than lost
+    handOff(UINT64_MAX);
+    for (uint32_t i = 0; i < slotCount; i++){
+        while (slots[i].state.load(std::memory_order_acquire) != slotState::free){
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
+    for (uint32_t i = 0; i < slotCount; i++){
+        vkUnmapMemory(pDevices->device, slots[i].memory);
+        vkDestroyBuffer(pDevices->device, slots[i].buffer, nullptr);
+        pDevices->memoryBudget.free(slots[i].memory);
+    }
+    slots.reset();
+    slotCount = 0;
+    currentSlot = UINT32_MAX;
+}
+
+void frameCapture::beginFrame(uint64_t frame, uint64_t completedFrame){
+    handOff(completedFrame);
+    
+    // Never waits for a buffer to come back from the encoder, a frame that can't get one just isn't captured
+    currentSlot = UINT32_MAX;
+    if (encoderFailed.load(std::memory_order_relaxed)){
+        return;
+    }
+    uint32_t inUse = 0;
+    for (uint32_t i = 0; i < slotCount; i++){
+        if (slots[i].state.load(std::memory_order_acquire) != slotState::free){
+            inUse++;
+        } else if (currentSlot == UINT32_MAX){
+            currentSlot = i;
+        }
+    }
+    
+    if (currentSlot == UINT32_MAX){
+        reportBackPressure(frame);
+        return;
+    }
+    peakInUse = std::max(peakInUse, inUse + 1);
+    slots[currentSlot].frame = frame;
+    slots[currentSlot].state.store(slotState::pending, std::memory_order_relaxed);
+    pendingSlots.push_back(currentSlot);
+}
+
+void frameCapture::handOff(uint64_t completedFrame){
+    // Frames finish in the order they were submitted so only the front of the list needs checking
+    size_t handed = 0;
+    while (handed < pendingSlots.size() && slots[pendingSlots[handed]].frame <= completedFrame){
+        uint32_t slot = pendingSlots[handed];
+        if (!coherent){
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = slots[slot].memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges(pDevices->device, 1, &range);
+        }
+        
+        slots[slot].state.store(slotState::encoding, std::memory_order_relaxed);
+        // There are never more slots than the queue holds, so this can't fail
+        encodeQueue.push(slot);
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            queued++;
+        }
+        wakeCondition.notify_one();
+        handed++;
+    }
+    pendingSlots.erase(pendingSlots.begin(), pendingSlots.begin() + handed);
+}
+
+void frameCapture::recordCopy(VkCommandBuffer commandBuffer, VkImage image){
+    if (currentSlot == UINT32_MAX){
+        return;
+    }
+    
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slots[currentSlot].buffer, 1, &region);
+    
+    // The fence makes the copy finished but not visible, this is what lets the host read it
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slots[currentSlot].buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void frameCapture::reportBackPressure(uint64_t frame){
+    // Once when it starts and then every so often, printing every dropped frame would only slow things down further
+    framesDropped++;
+    if (framesDropped == 1 || framesDropped % 100 == 0){
+        std::cout << "Capture can't keep up, dropped frame " << frame << " (" << framesDropped << " dropped so far, all " << slotCount << " readback buffers busy)" << std::endl;
+    }
+}
+
+void frameCapture::runEncoder(){
+    while (true){
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait(lock, [this](){
+                return queued > 0 || stopping;
+            });
+            if (queued == 0){
+                return;
+            }
+            queued--;
+        }
+        
+        uint32_t index;
+        encodeQueue.pop(index);
+        readbackSlot& slot = slots[index];
+        
+        // A failed write stops the capture, the buffers still get freed so the render thread never ends up waiting on them
+        auto start = std::chrono::steady_clock::now();
+        if (!encoderFailed.load()){
+            try {
+                encoder.encodeFrame(static_cast<const uint8_t*>(slot.mapped), extent.width, extent.height, bgra, slot.frame);
+                framesWritten++;
+            } catch (const std::exception& error){
+                std::cerr << "Capture stopped: " << error.what() << std::endl;
+                encoderFailed.store(true);
+            }
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        encodeMilliseconds += elapsed.count();
+        slowestEncode = std::max(slowestEncode, elapsed.count());
+        
+        slot.state.store(slotState::free, std::memory_order_release);
+    }
+}
+
+void frameCapture::destroyFrameCapture(){
+    if (encoderThread.joinable()){
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_one();
+        encoderThread.join();
+    }
+    encoder.closeEncoder();
+    
+    double average = framesWritten > 0 ? encodeMilliseconds / framesWritten : 0.0;
+    std::cout << "Capture: " << framesWritten << " frames written, " << framesDropped << " dropped, " << average << " ms average encode (slowest " << slowestEncode << " ms), peak " << peakInUse << " of " << std::min(pSettings->captureBuffers, maxSlots) << " readback buffers in use" << std::endl;
+}
@@ -0,0 +1,94 @@
+#ifndef frameCapture_hpp
+#define frameCapture_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "devices.hpp"
+#include "swapchain.hpp"
+#include "settings.hpp"
+#include "spscQueue.hpp"
+#include "captureEncoder.hpp"
+
+// Records the finished frames without the render thread ever waiting on a readback or the disk
+// Each frame copies the swapchain image into the next free buffer of a host visible ring, the buffer only gets looked at once that frame's fence has signaled anyway
+// A thread of its own does the encoding, and when it falls behind and the ring is full frames get dropped and counted instead of holding the next one up
+class frameCapture{
+public:
+    void initFrameCapture(devices* initDevices, swapchain* initSwapchain, settings* initSettings);
+    // False for swapchain formats the encoder can't take or images that can't be copied out of
+    bool isSupported();
+    // Sized off the swapchain so they get remade with it, the encoder thread starts with the first ones
+    void createBuffers();
+    // Waits for the encoder to finish with everything already read back, only once the device is idle
+    void destroyBuffers();
+    // Once a frame on the render thread once the frame is certain to be submitted
+    // Everything copied by frames up to completedFrame is finished on the gpu and goes to the encoder, then a buffer gets picked for this frame if there's one free
+    void beginFrame(uint64_t frame, uint64_t completedFrame);
+    // The image has to be in transfer source layout, records nothing when beginFrame couldn't get a buffer
+    void recordCopy(VkCommandBuffer commandBuffer, VkImage image);
+    void destroyFrameCapture();
+private:
+    enum class slotState {
+        free,
+        // Copied into by a frame that hasn't finished yet
+        pending,
+        // Handed to the encoder, it sets it back to free once it's done reading
+        encoding
+    };
+    
+    struct readbackSlot {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        uint64_t frame = 0;
+        std::atomic<slotState> state{slotState::free};
+    };
+    
+    devices* pDevices;
+    swapchain* pSwapchain;
+    settings* pSettings;
+    
+    std::unique_ptr<readbackSlot[]> slots;
+    uint32_t slotCount = 0;
+    uint32_t currentSlot;
+    // Pending slots in the order their frames were submitted, only touched by the render thread
+    std::vector<uint32_t> pendingSlots;
+    VkExtent2D extent;
+    bool bgra;
+    bool coherent;
+    
+    static constexpr uint32_t maxSlots = 64;
+    spscQueue<uint32_t, maxSlots> encodeQueue;
+    captureEncoder encoder;
+    std::thread encoderThread;
+    // Only so the encoder can sleep while there's nothing queued, the render thread never waits on it for long
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    uint32_t queued = 0;
+    bool stopping = false;
+    
+    // Written by the encoder thread, read for the summary once it's stopped
+    uint64_t framesWritten = 0;
+    double encodeMilliseconds = 0.0;
+    double slowestEncode = 0.0;
+    std::atomic<bool> encoderFailed{false};
+    // Render thread only
+    uint64_t framesDropped = 0;
+    uint32_t peakInUse = 0;
+    
+    void runEncoder();
+    void handOff(uint64_t completedFrame);
+    void reportBackPressure(uint64_t frame);
+};
+
+#endif /* frameCapture_hpp */
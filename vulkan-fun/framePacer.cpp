@@ -0,0 +1,111 @@
+#include "framePacer.hpp"
+
+namespace {
+    // Extra room on top of the predicted frame cost for the os waking us up late and frames that run long
+    const double safetyMargin = 1.0;
+    // How much each new sample moves the smoothed cpu and gpu times
+    const double smoothing = 0.1;
+    
+    double toMilliseconds(std::chrono::steady_clock::duration duration){
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+    
+    std::chrono::steady_clock::duration fromMilliseconds(double milliseconds){
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(milliseconds));
+    }
+}
+
+void framePacer::initFramePacer(double initRefreshInterval, uint32_t initTargetFps, bool initEnabled){
+    refreshInterval = initRefreshInterval;
+    targetFps = initTargetFps;
+    enabled = initEnabled;
+    active = false;
+    
+    cpuTime = 0.0;
+    gpuTime = 0.0;
+    deadline = clock::time_point();
+    pacedFrames = 0;
+    missedDeadlines = 0;
+    totalSleep = 0.0;
+    
+    // A cap wins over the display rate, otherwise there's no point going faster than the screen can show
+    frameInterval = targetFps > 0 ? 1000.0 / targetFps : refreshInterval;
+}
+
+void framePacer::setPresentMode(VkPresentModeKHR presentMode){
+    bool displayPaced = presentMode == VK_PRESENT_MODE_FIFO_KHR || presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    active = enabled && (!displayPaced || frameInterval > refreshInterval);
+    
+    // Start the schedule over, the old deadlines mean nothing after a swapchain change
+    deadline = clock::time_point();
+}
+
+void framePacer::sleepUntil(clock::time_point wakeTime){
+    // The os sleep is only good to about a millisecond, so sleep most of the way and yield for the rest
+    auto sleepStart = clock::now();
+    if (wakeTime <= sleepStart){
+        return;
+    }
+    
+    auto coarseWake = wakeTime - std::chrono::milliseconds(1);
+    if (coarseWake > sleepStart){
+        std::this_thread::sleep_until(coarseWake);
+    }
+    while (clock::now() < wakeTime){
+        std::this_thread::yield();
+    }
+    
+    totalSleep += toMilliseconds(clock::now() - sleepStart);
+}
+
+void framePacer::waitForNextFrame(){
+    // Called right before polling input, wakes up just early enough for the cpu and gpu to finish by the deadline
+    if (active){
+        auto now = clock::now();
+        if (deadline <= now){
+            // First frame or a long stall, no point sleeping to catch a deadline that's already gone
+            deadline = now + fromMilliseconds(frameInterval);
+        } else {
+            double predictedCost = cpuTime + gpuTime + safetyMargin;
+            sleepUntil(deadline - fromMilliseconds(predictedCost));
+        }
+    }
+    
+    frameStart = clock::now();
+}
+
+void framePacer::frameSubmitted(){
+    auto now = clock::now();
+    cpuTime += (toMilliseconds(now - frameStart) - cpuTime) * smoothing;
+    
+    if (!active){
+        return;
+    }
+    pacedFrames++;
+    
+    // The gpu still has its part to do after the submit, if that lands past the deadline the frame is late
+    if (now + fromMilliseconds(gpuTime) > deadline){
+        missedDeadlines++;
+    }
+    
+    // Keep the cadence, skipping whole intervals when a frame was late rather than trying to catch up
+    auto interval = fromMilliseconds(frameInterval);
+    deadline += interval;
+    while (deadline <= now){
+        deadline += interval;
+    }
+}
+
+void framePacer::recordGpuTime(double milliseconds){
+    if (milliseconds >= 0.0){
+        gpuTime += (milliseconds - gpuTime) * smoothing;
+    }
+}
+
+void framePacer::printSummary(){
+    if (pacedFrames == 0){
+        return;
+    }
+    
+    std::cout << "Frame pacer: " << pacedFrames << " paced frames at " << frameInterval << " ms, " << missedDeadlines << " missed deadlines, cpu " << cpuTime << " ms, gpu " << gpuTime << " ms, avg sleep " << totalSleep / pacedFrames << " ms" << std::endl;
+}
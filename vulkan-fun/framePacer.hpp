@@ -0,0 +1,46 @@
+#ifndef framePacer_hpp
+#define framePacer_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <algorithm>
+
+// Sleeps before input gets polled so a frame starts as late as it can while still making its deadline
+// Less time between polling input and the frame hitting the screen, and no frames rendered just to be thrown away
+class framePacer {
+public:
+    void initFramePacer(double initRefreshInterval, uint32_t initTargetFps, bool initEnabled);
+    // FIFO already blocks on the display, so pacing only kicks in for modes that render as fast as they can or when there's a cap under the refresh rate
+    void setPresentMode(VkPresentModeKHR presentMode);
+    void waitForNextFrame();
+    void frameSubmitted();
+    // Fed from the timestamp queries once a frame is done, negative means there was nothing to read
+    void recordGpuTime(double milliseconds);
+    void printSummary();
+    
+private:
+    typedef std::chrono::steady_clock clock;
+    
+    bool enabled;
+    bool active;
+    uint32_t targetFps;
+    double refreshInterval;
+    double frameInterval;
+    
+    // Smoothed so one odd frame doesn't throw the schedule off
+    double cpuTime;
+    double gpuTime;
+    
+    clock::time_point frameStart;
+    clock::time_point deadline;
+    uint64_t pacedFrames;
+    uint64_t missedDeadlines;
+    double totalSleep;
+    
+    void sleepUntil(clock::time_point wakeTime);
+};
+
+#endif /* framePacer_hpp */
@@ -0,0 +1,101 @@
+#include "frameStats.hpp"
+
+namespace {
+    // Set during static initialization, which is as close to the process starting as we can get without the os
+    const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+}
+
+void frameStats::sampleRing::push(double sample){
+    // Fills up first, then writes over the oldest one
+    if (samples.size() < capacity){
+        samples.push_back(sample);
+    } else {
+        samples[next] = sample;
+    }
+    next = (next + 1) % capacity;
+    total++;
+}
+
+void frameStats::sampleRing::clear(){
+    samples.clear();
+    next = 0;
+    total = 0;
+}
+
+void frameStats::initFrameStats(const std::string& initLabel){
+    label = initLabel;
+    frameCount = 0;
+    frameTimes.clear();
+    latencies.clear();
+    timings.clear();
+}
+
+void frameStats::setLabel(const std::string& newLabel){
+    label = newLabel;
+}
+
+double frameStats::sinceStartup(){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+}
+
+void frameStats::beginFrame(){
+    frameStart = std::chrono::steady_clock::now();
+}
+
+void frameStats::endFrame(){
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - frameStart;
+    frameTimes.push(elapsed.count());
+    if (frameCount == 0){
+        recordTiming("time to first frame", sinceStartup());
+    }
+    frameCount++;
+}
+
+void frameStats::recordTiming(const std::string& name, double milliseconds){
+    timings.push_back({name, milliseconds});
+}
+
+void frameStats::recordLatency(double milliseconds){
+    latencies.push(milliseconds);
+}
+
+void frameStats::setLatencyMethod(const std::string& method){
+    latencyMethod = method;
+}
+
+void frameStats::printLatency(const std::string& name){
+    printDistribution(name + " input to present (" + latencyMethod + ")", latencies);
+    latencies.clear();
+}
+
+void frameStats::printSummary(){
+    std::cout << "Frame stats (" << label << ")" << std::endl;
+    
+    for (const auto& entry : timings){
+        std::cout << "  " << entry.name << ": " << entry.milliseconds << " ms" << std::endl;
+    }
+    
+    printDistribution("frames", frameTimes);
+    printDistribution("input to present (" + latencyMethod + ")", latencies);
+}
+
+void frameStats::printDistribution(const std::string& name, const sampleRing& ring){
+    // Average plus the median and 99th percentile since a couple of slow frames are easy to hide in an average
+    if (ring.samples.empty()){
+        return;
+    }
+    
+    std::vector<double> sorted = ring.samples;
+    std::sort(sorted.begin(), sorted.end());
+    
+    double total = 0.0;
+    for (double time : sorted){
+        total += time;
+    }
+    
+    std::cout << "  " << name << ": " << sorted.size() << " samples";
+    if (ring.total > sorted.size()){
+        std::cout << " (last of " << ring.total << ")";
+    }
+    std::cout << ", avg " << total / sorted.size() << " ms, median " << sorted[sorted.size() / 2] << " ms, p99 " << sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)] << " ms" << std::endl;
+}
@@ -0,0 +1,55 @@
+#ifndef frameStats_hpp
+#define frameStats_hpp
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+// Keeps CPU side timings around so different code paths can be compared against each other
+class frameStats {
+public:
+    void initFrameStats(const std::string& initLabel);
+    void setLabel(const std::string& newLabel);
+    void beginFrame();
+    void endFrame();
+    void recordTiming(const std::string& name, double milliseconds);
+    // Milliseconds since the program started, for startup timings
+    double sinceStartup();
+    void recordLatency(double milliseconds);
+    // How the latency samples were taken, printed next to them since the methods aren't equally exact
+    void setLatencyMethod(const std::string& method);
+    // Prints and clears the latency samples, used when switching latency policy so each one gets its own numbers
+    void printLatency(const std::string& name);
+    void printSummary();
+    
+    uint64_t frameCount = 0;
+private:
+    struct timing {
+        std::string name;
+        double milliseconds;
+    };
+    
+    // Only the most recent samples are kept so a long run doesn't keep growing, the distributions cover the last few thousand
+    struct sampleRing {
+        static const size_t capacity = 8192;
+        std::vector<double> samples;
+        size_t next = 0;
+        uint64_t total = 0;
+        
+        void push(double sample);
+        void clear();
+    };
+    
+    std::string label;
+    std::string latencyMethod;
+    std::chrono::steady_clock::time_point frameStart;
+    sampleRing frameTimes;
+    sampleRing latencies;
+    std::vector<timing> timings;
+    
+    void printDistribution(const std::string& name, const sampleRing& ring);
+};
+
+#endif /* frameStats_hpp */
@@ -1,33 +1,130 @@
 #include "graphicsPipeline.hpp"
 
-void graphicsPipeline::createGraphicsPipeline(devices* initDevices, swapchain* initSwapchain, renderPass* initRenderpass){
+namespace {
+    // Render passes with the same formats are compatible, so a pipeline made against an old one still works with its replacement
+    std::string getTargetKey(const passTarget& target){
+        std::string key = std::string(target.renderPass != VK_NULL_HANDLE ? "pass" : "dynamic") + ":" + std::to_string(target.depthFormat);
+        for (VkFormat format : target.colorFormats){
+            key += "," + std::to_string(format);
+        }
+        return key;
+    }
+}
+
+void graphicsPipeline::loadShaders(pipelineManager* initPipelineManager){
+    pPipelineManager = initPipelineManager;
+    pPipelineManager->loadShader("shadervert.spv");
+    pPipelineManager->loadShader("shaderfrag.spv");
+    pPipelineManager->loadShader("shadowvert.spv");
+    pPipelineManager->loadShader("particlevert.spv");
+    pPipelineManager->loadShader("particlefrag.spv");
+}
+
+void graphicsPipeline::createGraphicsPipeline(devices* initDevices, swapchain* initSwapchain, deletionQueue* initDeletionQueue, const passTarget* initTarget, const std::vector<VkDescriptorSetLayout>& initSetLayouts){
     pDevices = initDevices;
     pSwapchain = initSwapchain;
-    pRenderpass = initRenderpass;
+    pDeletionQueue = initDeletionQueue;
+    target = *initTarget;
+    
+    // Per draw data goes in push constants so changing it never needs a descriptor or buffer write
+    pushConstantLayout pushConstants;
+    drawRange = pushConstants.addRange<drawConstants>(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+    pushConstants.checkLimits(pDevices->physicalDevice);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(initSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = initSetLayouts.data();
+    pushConstants.fillLayoutInfo(pipelineLayoutInfo);
+    
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pipeline layout!");
+    }
+    pipelineLayout = uniqueHandle<VkPipelineLayout>(pDevices->device, layout, vkDestroyPipelineLayout, pDeletionQueue);
+    
+    // Feature switches go in as specialization constants on the one spirv file instead of a file per combination
+    // An hdr target gets the scene pushed past 1 so the post chain's bloom has something to pick up
+    bool hdrTarget = !target.colorFormats.empty() && target.colorFormats[0] == VK_FORMAT_R16G16B16A16_SFLOAT;
+    shaderVariant vertVariant{VK_SHADER_STAGE_VERTEX_BIT, "shadervert.spv", {}};
+    shaderVariant fragVariant{VK_SHADER_STAGE_FRAGMENT_BIT, "shaderfrag.spv", {}};
+    fragVariant.constants.set(0, hdrTarget ? 4.0f : 1.0f);
+    fragVariant.constants.set(1, clusteredLights::gridX).set(2, clusteredLights::gridY).set(3, clusteredLights::gridZ);
+    
+    // Anything createPipeline bakes in from the target or layout has to be in the key, the shader variants get added by the manager
+    std::string stateKey = "main:" + pipelineManager::getLayoutKey(pipelineLayoutInfo) + ":" + getTargetKey(target);
+    
+    graphicsPipeline = pPipelineManager->getGraphicsPipeline({vertVariant, fragVariant}, stateKey, [this](const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages, VkPipelineCache pipelineCache){
+        return createPipeline(shaderStages, pipelineCache, target, pipelineLayout.get(), pipelineKind::main);
+    });
+}
+
+void graphicsPipeline::createDepthOnlyPipeline(VkRenderPass initRenderPass, VkFormat initDepthFormat, const std::vector<VkDescriptorSetLayout>& initSetLayouts){
+    pushConstantLayout pushConstants;
+    shadowRange = pushConstants.addRange<shadowConstants>(VK_SHADER_STAGE_VERTEX_BIT);
+    pushConstants.checkLimits(pDevices->physicalDevice);
     
-    // Setup and filling structs for the shader modules into the larger graphics pipeline struct
-    auto vertShaderCode = file.readFile("shadervert.spv");
-    auto fragShaderCode = file.readFile("shaderfrag.spv");
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(initSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = initSetLayouts.data();
+    pushConstants.fillLayoutInfo(pipelineLayoutInfo);
     
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create depth only pipeline layout!");
+    }
+    depthOnlyLayout = uniqueHandle<VkPipelineLayout>(pDevices->device, layout, vkDestroyPipelineLayout, pDeletionQueue);
+    
+    // Only a vertex shader, the depth is all that gets written
+    passTarget depthTarget{};
+    depthTarget.renderPass = initRenderPass;
+    depthTarget.depthFormat = initDepthFormat;
+    shaderVariant vertVariant{VK_SHADER_STAGE_VERTEX_BIT, "shadowvert.spv", {}};
+    std::string stateKey = "depth:" + pipelineManager::getLayoutKey(pipelineLayoutInfo) + ":" + getTargetKey(depthTarget);
+    
+    depthOnlyPipeline = pPipelineManager->getGraphicsPipeline({vertVariant}, stateKey, [this, depthTarget](const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages, VkPipelineCache pipelineCache){
+        return createPipeline(shaderStages, pipelineCache, depthTarget, depthOnlyLayout.get(), pipelineKind::depthOnly);
+    });
+}
+
+void graphicsPipeline::createParticlePipeline(const std::vector<VkDescriptorSetLayout>& initSetLayouts){
+    pushConstantLayout pushConstants;
+    particleRange = pushConstants.addRange<particleDrawConstants>(VK_SHADER_STAGE_VERTEX_BIT);
+    pushConstants.checkLimits(pDevices->physicalDevice);
     
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
-    // Can insert pSpecializationInfo to insert constants into the shader files
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(initSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = initSetLayouts.data();
+    pushConstants.fillLayoutInfo(pipelineLayoutInfo);
     
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-    // Can insert pSpecializationInfo to insert constants into the shader files
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create particle pipeline layout!");
+    }
+    particleLayout = uniqueHandle<VkPipelineLayout>(pDevices->device, layout, vkDestroyPipelineLayout, pDeletionQueue);
     
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+    // Same target as the main pipeline, it draws inside the main passes
+    bool hdrTarget = !target.colorFormats.empty() && target.colorFormats[0] == VK_FORMAT_R16G16B16A16_SFLOAT;
+    shaderVariant vertVariant{VK_SHADER_STAGE_VERTEX_BIT, "particlevert.spv", {}};
+    shaderVariant fragVariant{VK_SHADER_STAGE_FRAGMENT_BIT, "particlefrag.spv", {}};
+    fragVariant.constants.set(0, hdrTarget ? 4.0f : 1.0f);
     
+    std::string stateKey = "particles:" + pipelineManager::getLayoutKey(pipelineLayoutInfo) + ":" + getTargetKey(target);
+    
+    particlePipeline = pPipelineManager->getGraphicsPipeline({vertVariant, fragVariant}, stateKey, [this](const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages, VkPipelineCache pipelineCache){
+        return createPipeline(shaderStages, pipelineCache, target, particleLayout.get(), pipelineKind::particles);
+    });
+}
+
+VkPipeline graphicsPipeline::createPipeline(const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages, VkPipelineCache pipelineCache, const passTarget& pipelineTarget, VkPipelineLayout layout, pipelineKind kind){
+    // The shadow variant sees triangles from both sides and pushes its depth back a little so surfaces don't shadow themselves
+    bool depthOnly = kind == pipelineKind::depthOnly;
+    // Particles are see through, they get blended in over the scene back to front and leave the depth alone for the ones behind them
+    bool particles = kind == pipelineKind::particles;
+    
+    // Setup and filling structs for everything around the shaders into the larger graphics pipeline struct
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInputInfo.vertexBindingDescriptionCount = 0;
@@ -40,25 +137,18 @@ void graphicsPipeline::createGraphicsPipeline(devices* initDevices, swapchain* i
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
     
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float) pSwapchain->swapChainExtent.width;
-    viewport.height = (float) pSwapchain->swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    
-    // Scissors could be used for multigpu rendering, maybe?
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = pSwapchain->swapChainExtent;
-    
+    // Viewport and scissor get set when recording so the pipeline doesn't care about the swapchain size
+    // That way it can be built before the swapchain exists and survives resizes
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
     
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -67,81 +157,86 @@ void graphicsPipeline::createGraphicsPipeline(devices* initDevices, swapchain* i
     // Could be used for a point/edge overview mode
     rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.cullMode = depthOnly || particles ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
     rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
+    rasterizer.depthBiasEnable = depthOnly ? VK_TRUE : VK_FALSE;
+    rasterizer.depthBiasConstantFactor = depthOnly ? 1.25f : 0.0f;
+    rasterizer.depthBiasSlopeFactor = depthOnly ? 1.75f : 0.0f;
     
     VkPipelineMultisampleStateCreateInfo multisampling{};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisampling.sampleShadingEnable = VK_FALSE;
     multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
     
-    //Depth and stencil testing could go here
+    // Only when the target has a depth attachment, nearer or equal wins so objects drawn again in a later pass don't fight themselves
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = particles ? VK_FALSE : VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
     
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
+    colorBlendAttachment.blendEnable = particles ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
     
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlending.logicOpEnable = VK_FALSE;
     colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
+    colorBlending.attachmentCount = depthOnly ? 0 : 1;
     colorBlending.pAttachments = &colorBlendAttachment;
     colorBlending.blendConstants[0] = 0.0f;
     colorBlending.blendConstants[1] = 0.0f;
     colorBlending.blendConstants[2] = 0.0f;
     colorBlending.blendConstants[3] = 0.0f;
     
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    
-    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS){
-        throw std::runtime_error("Failed to create pipeline layout!");
-    }
-    
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages = shaderStages.data();
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &inputAssembly;
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = pipelineTarget.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencil : nullptr;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = pRenderpass->renderPass;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = pipelineTarget.renderPass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     
-    if(vkCreateGraphicsPipelines(pDevices->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS){
-        throw std::runtime_error("Failed to create graphics pipeline!");
+#ifdef VK_KHR_dynamic_rendering
+    // Without a render pass the pipeline only gets told what formats it's going to be drawing into
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(pipelineTarget.colorFormats.size());
+    renderingInfo.pColorAttachmentFormats = pipelineTarget.colorFormats.data();
+    renderingInfo.depthAttachmentFormat = pipelineTarget.depthFormat;
+    renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+    
+    if (pipelineTarget.renderPass == VK_NULL_HANDLE){
+        pipelineInfo.pNext = &renderingInfo;
     }
+#else
+    if (pipelineTarget.renderPass == VK_NULL_HANDLE){
+        throw std::runtime_error("Pipeline has no render pass and the Vulkan headers don't support dynamic rendering!");
+    }
+#endif
     
-    vkDestroyShaderModule(pDevices->device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(pDevices->device, vertShaderModule, nullptr);
-}
-
-VkShaderModule graphicsPipeline::createShaderModule(const std::vector<char>& code){
-    // Little Helper functions for added reusablity in filling out these structs that never end
-    // This struct is actually pretty simple considering some of the other ones
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-    
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(pDevices->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS){
-        throw std::runtime_error("Failed to create shader module!");
+    VkPipeline pipeline;
+    if(vkCreateGraphicsPipelines(pDevices->device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create graphics pipeline!");
     }
-        
-    return shaderModule;;
-}
-
-void graphicsPipeline::destroyGraphicsPipeline(){
-    vkDestroyPipeline(pDevices->device, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(pDevices->device, pipelineLayout, nullptr);
+    
+    return pipeline;
 }
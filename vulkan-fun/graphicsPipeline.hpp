@@ -9,23 +9,75 @@
 #include "file.hpp"
 #include "devices.hpp"
 #include "swapchain.hpp"
-#include "renderPass.hpp"
+#include "renderGraph.hpp"
+#include "pipelineManager.hpp"
+#include "pushConstants.hpp"
+#include "clusteredLights.hpp"
+#include "vulkanHandle.hpp"
+
+// Per draw data for the main pipeline, lines up with the push_constant block in shadervert.vert and shaderfrag.frag
+struct drawConstants {
+    // Column major like glsl's mat4
+    float transform[16];
+    // Anything but 0 overrides the material of every instance in the draw
+    uint32_t materialId;
+    // Where the draw's entries in the culled list of visible objects start
+    uint32_t firstVisible;
+};
+
+// Per tile data for the depth only pipeline, lines up with the push_constant block in shadowvert.vert
+struct shadowConstants {
+    // Column major, from world space to the light's clip space
+    float lightViewProjection[16];
+    // Where the tile's entries in the list of caster ids start
+    uint32_t firstCaster;
+};
+
+// Per draw data for the particle pipeline, lines up with the push_constant block in particlevert.vert
+struct particleDrawConstants {
+    float viewProjection[16];
+    // Half the width of a particle's quad in world units
+    float size;
+};
 
 class graphicsPipeline{
 public:
-    void createGraphicsPipeline(devices* initDevices, swapchain* initSwapchain, renderPass* initRenderpass);
-    void destroyGraphicsPipeline();
+    // Only touches the disk, so it can run before there's a device or anything else to go with it
+    void loadShaders(pipelineManager* initPipelineManager);
+    // Set 0 is the scene's instance buffer the vertex shader reads transforms from, set 1 culling's ids of what's visible and set 2 the clustered lights
+    void createGraphicsPipeline(devices* initDevices, swapchain* initSwapchain, deletionQueue* initDeletionQueue, const passTarget* initTarget, const std::vector<VkDescriptorSetLayout>& initSetLayouts);
+    // The variant shadow maps get drawn with, only depth and no fragment shader, set 0 is the scene again and set 1 the shadow atlas's caster ids
+    // Made after createGraphicsPipeline since it shares its device
+    void createDepthOnlyPipeline(VkRenderPass initRenderPass, VkFormat initDepthFormat, const std::vector<VkDescriptorSetLayout>& initSetLayouts);
+    // Blended camera facing quads into the main target, depth tested against the scene but never written, set 0 is the particle system's state
+    void createParticlePipeline(const std::vector<VkDescriptorSetLayout>& initSetLayouts);
     
+    // Owned by the pipeline manager, it goes away with the manager, the layouts are ours and go through the deletion queue
     VkPipeline graphicsPipeline;
+    uniqueHandle<VkPipelineLayout> pipelineLayout;
+    // Pushed once per draw with commands::pushConstants, the vertex shader takes the transform and the fragment shader the material
+    pushConstantRange<drawConstants> drawRange;
+    VkPipeline depthOnlyPipeline;
+    uniqueHandle<VkPipelineLayout> depthOnlyLayout;
+    pushConstantRange<shadowConstants> shadowRange;
+    VkPipeline particlePipeline = VK_NULL_HANDLE;
+    uniqueHandle<VkPipelineLayout> particleLayout;
+    pushConstantRange<particleDrawConstants> particleRange;
 private:
-    File file;
     devices* pDevices;
     swapchain* pSwapchain;
-    renderPass* pRenderpass;
+    deletionQueue* pDeletionQueue;
+    pipelineManager* pPipelineManager;
+    passTarget target;
     
-    VkPipelineLayout pipelineLayout;
+    // What createPipeline changes from the main pipeline's state
+    enum class pipelineKind {
+        main,
+        depthOnly,
+        particles
+    };
     
-    VkShaderModule createShaderModule(const std::vector<char>& code);
+    VkPipeline createPipeline(const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages, VkPipelineCache pipelineCache, const passTarget& pipelineTarget, VkPipelineLayout layout, pipelineKind kind);
 };
 
 #endif /* graphicsPipeline_hpp */
@@ -0,0 +1,293 @@
+#include "jobSystem.hpp"
+
+namespace {
+    // Which deque the current thread owns, anything that isn't a worker uses the shared slot 0
+    thread_local uint32_t threadQueueIndex = 0;
+    thread_local jobSystem* threadJobSystem = nullptr;
+}
+
+void jobSystem::initJobSystem(uint32_t workerCount){
+    if (workerCount == 0){
+        uint32_t cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 1;
+    }
+    
+    stopping = false;
+    queuedJobs = 0;
+    
+    queues.clear();
+    for (uint32_t i = 0; i < workerCount + 1; i++){
+        queues.push_back(std::make_unique<workQueue>());
+    }
+    
+    for (uint32_t i = 0; i < workerCount; i++){
+        workers.emplace_back(&jobSystem::workerLoop, this, i + 1);
+    }
+}
+
+void jobSystem::destroyJobSystem(){
+    // Whatever is still queued never gets run, callers are expected to have waited on their counters
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    
+    for (auto& worker : workers){
+        worker.join();
+    }
+    workers.clear();
+    queues.clear();
+}
+
+uint32_t jobSystem::getWorkerCount(){
+    return static_cast<uint32_t>(workers.size());
+}
+
+uint32_t jobSystem::currentQueue(){
+    return threadJobSystem == this ? threadQueueIndex : 0;
+}
+
+void jobSystem::push(job newJob, bool background){
+    {
+        workQueue& queue = background ? backgroundQueue : *queues[currentQueue()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(newJob));
+    }
+    
+    // Taking the sleep lock makes sure a worker that just checked for work and found none can't miss this wake up
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queuedJobs++;
+    }
+    wakeWorkers.notify_one();
+}
+
+void jobSystem::run(std::function<void()> function, jobCounter* counter){
+    if (counter != nullptr){
+        counter->value++;
+    }
+    push({std::move(function), counter});
+}
+
+void jobSystem::runAfter(jobCounter* dependency, std::function<void()> function, jobCounter* counter){
+    if (counter != nullptr){
+        counter->value++;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(dependency->continuationMutex);
+        if (dependency->value > 0){
+            dependency->continuations.push_back(std::move(function));
+            dependency->continuationCounters.push_back(counter);
+            return;
+        }
+    }
+    
+    // Dependency already finished so there's nothing to wait for
+    push({std::move(function), counter});
+}
+
+void jobSystem::runBackground(std::function<void()> function, jobCounter* counter){
+    if (counter != nullptr){
+        counter->value++;
+    }
+    push({std::move(function), counter}, true);
+}
+
+void jobSystem::parallelFor(uint32_t count, uint32_t batchSize, std::function<void(uint32_t, uint32_t)> function, jobCounter* counter){
+    batchSize = std::max(batchSize, 1u);
+    for (uint32_t start = 0; start < count; start += batchSize){
+        uint32_t end = std::min(start + batchSize, count);
+        run([function, start, end](){
+            function(start, end);
+        }, counter);
+    }
+}
+
+void jobSystem::finishJob(jobCounter* counter){
+    if (counter == nullptr){
+        return;
+    }
+    
+    // The last job out releases anything that was waiting on this counter
+    // Done under the lock so a waiter can't see zero and free the counter while it's still being used here
+    std::vector<std::function<void()>> continuations;
+    std::vector<jobCounter*> continuationCounters;
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter->continuationMutex);
+        if (--counter->value != 0){
+            return;
+        }
+        continuations.swap(counter->continuations);
+        continuationCounters.swap(counter->continuationCounters);
+        error = counter->error;
+    }
+    
+    // Whatever was waiting on a failed counter would only work off of half done results, so it's skipped and fails the same way
+    for (size_t i = 0; i < continuations.size(); i++){
+        if (!error){
+            push({std::move(continuations[i]), continuationCounters[i]});
+            continue;
+        }
+        if (continuationCounters[i] != nullptr){
+            {
+                std::lock_guard<std::mutex> lock(continuationCounters[i]->continuationMutex);
+                if (!continuationCounters[i]->error){
+                    continuationCounters[i]->error = error;
+                }
+            }
+            finishJob(continuationCounters[i]);
+        }
+    }
+}
+
+bool jobSystem::popJob(uint32_t index, bool takeBackground, job& found){
+    // Own deque first from the back since that's what's most likely still in cache
+    {
+        workQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()){
+            found = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            return true;
+        }
+    }
+    
+    // Then steal the oldest job from someone else, starting next door so the thieves spread out
+    for (size_t offset = 1; offset < queues.size(); offset++){
+        workQueue& queue = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()){
+            found = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+    
+    // Background work last, and only for threads that aren't waiting on something
+    if (takeBackground){
+        std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+        if (!backgroundQueue.jobs.empty()){
+            found = std::move(backgroundQueue.jobs.front());
+            backgroundQueue.jobs.pop_front();
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool jobSystem::tryRunJob(uint32_t index, bool takeBackground){
+    job found;
+    if (!popJob(index, takeBackground, found)){
+        return false;
+    }
+    
+    queuedJobs--;
+    // Thrown out of a worker it would take the whole program down, so it goes on the counter for whoever waits on it
+    // Without a counter nobody would ever hear about it, so that still gets thrown
+    try {
+        found.function();
+    } catch (...) {
+        if (found.counter == nullptr){
+            throw;
+        }
+        std::lock_guard<std::mutex> lock(found.counter->continuationMutex);
+        if (!found.counter->error){
+            found.counter->error = std::current_exception();
+        }
+    }
+    finishJob(found.counter);
+    return true;
+}
+
+void jobSystem::workerLoop(uint32_t index){
+    threadQueueIndex = index;
+    threadJobSystem = this;
+    
+    while (true){
+        if (tryRunJob(index, true)){
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeWorkers.wait(lock, [this](){
+            return stopping || queuedJobs > 0;
+        });
+        if (stopping){
+            return;
+        }
+    }
+}
+
+void jobSystem::wait(jobCounter* counter){
+    // Helping out instead of sleeping, so waiting on a counter never leaves a core idle while its jobs sit in a queue
+    // Background jobs are left to the workers, a file read picked up here would hold up whatever is waiting
+    uint32_t index = currentQueue();
+    while (counter->value > 0){
+        if (!tryRunJob(index, false)){
+            std::this_thread::yield();
+        }
+    }
+    
+    // The last job may still be holding the lock after dropping the count, wait for it to let go before the counter can go away
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter->continuationMutex);
+        error = counter->error;
+    }
+    if (error){
+        std::rethrow_exception(error);
+    }
+}
+
+void jobSystem::runBenchmark(){
+    // Every job here does nothing so the time is all scheduling, run from the owning thread with the workers going
+    typedef std::chrono::steady_clock clock;
+    const uint32_t jobCount = 100000;
+    std::atomic<uint32_t> sink{0};
+    
+    std::cout << "Job system benchmark (" << getWorkerCount() << " workers)" << std::endl;
+    
+    auto start = clock::now();
+    jobCounter single;
+    for (uint32_t i = 0; i < jobCount; i++){
+        run([&sink](){
+            sink.fetch_add(1, std::memory_order_relaxed);
+        }, &single);
+    }
+    wait(&single);
+    std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+    std::cout << "  run + wait: " << elapsed.count() / jobCount << " ns per job" << std::endl;
+    
+    start = clock::now();
+    jobCounter batched;
+    parallelFor(jobCount * 64, 64, [&sink](uint32_t first, uint32_t last){
+        sink.fetch_add(last - first, std::memory_order_relaxed);
+    }, &batched);
+    wait(&batched);
+    elapsed = clock::now() - start;
+    std::cout << "  parallelFor (batches of 64): " << elapsed.count() / jobCount << " ns per batch" << std::endl;
+    
+    // Each step only becomes runnable once the one before it finishes, so this is the worst case of nothing running in parallel
+    const uint32_t chainLength = 10000;
+    std::vector<std::unique_ptr<jobCounter>> chain;
+    for (uint32_t i = 0; i < chainLength; i++){
+        chain.push_back(std::make_unique<jobCounter>());
+    }
+    
+    start = clock::now();
+    run([&sink](){
+        sink.fetch_add(1, std::memory_order_relaxed);
+    }, chain[0].get());
+    for (uint32_t i = 1; i < chainLength; i++){
+        runAfter(chain[i - 1].get(), [&sink](){
+            sink.fetch_add(1, std::memory_order_relaxed);
+        }, chain[i].get());
+    }
+    wait(chain[chainLength - 1].get());
+    elapsed = clock::now() - start;
+    std::cout << "  dependency chain: " << elapsed.count() / chainLength << " ns per job" << std::endl;
+}
@@ -0,0 +1,82 @@
+#ifndef jobSystem_hpp
+#define jobSystem_hpp
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+class jobSystem;
+
+// Counts jobs that haven't finished yet, anything can wait on it or be set to run once it hits zero
+struct jobCounter {
+    std::atomic<int> value{0};
+    
+    // Jobs waiting for this counter, guarded by the mutex so one can't be added just as the last job finishes
+    std::mutex continuationMutex;
+    std::vector<std::function<void()>> continuations;
+    std::vector<jobCounter*> continuationCounters;
+    // The first exception one of its jobs threw, wait throws it again and nothing held back on this counter gets to run
+    std::exception_ptr error;
+};
+
+// Pool of worker threads each with their own deque, a worker takes from the back of its own and steals from the front of everyone else's
+// The thread that owns the job system gets a deque too and helps run jobs whenever it waits on a counter
+// Background jobs sit in their own queue that only the workers take from, so nobody waiting on a counter ends up stuck behind one
+class jobSystem {
+public:
+    // Zero workers means one per core, leaving one for the thread that created it
+    void initJobSystem(uint32_t workerCount = 0);
+    void destroyJobSystem();
+    
+    void run(std::function<void()> function, jobCounter* counter = nullptr);
+    // Held back until the dependency counter reaches zero, the counter passed in still counts it from right now
+    void runAfter(jobCounter* dependency, std::function<void()> function, jobCounter* counter = nullptr);
+    // For slow work nothing is in a hurry for, like reading files off the disk
+    void runBackground(std::function<void()> function, jobCounter* counter = nullptr);
+    // Splits [0, count) into batches, each batch is one job given its start and end
+    void parallelFor(uint32_t count, uint32_t batchSize, std::function<void(uint32_t, uint32_t)> function, jobCounter* counter);
+    // Runs other jobs instead of blocking until the counter is done, then throws whatever one of its jobs threw
+    void wait(jobCounter* counter);
+    
+    uint32_t getWorkerCount();
+    // Prints the scheduling cost per job for a few common patterns
+    void runBenchmark();
+    
+private:
+    struct job {
+        std::function<void()> function;
+        jobCounter* counter;
+    };
+    
+    struct workQueue {
+        std::mutex mutex;
+        std::deque<job> jobs;
+    };
+    
+    // Slot 0 belongs to any thread that isn't a worker, workers get 1 and up
+    std::vector<std::unique_ptr<workQueue>> queues;
+    workQueue backgroundQueue;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping;
+    std::atomic<int> queuedJobs;
+    std::mutex sleepMutex;
+    std::condition_variable wakeWorkers;
+    
+    void workerLoop(uint32_t index);
+    void push(job newJob, bool background = false);
+    bool tryRunJob(uint32_t index, bool takeBackground);
+    bool popJob(uint32_t index, bool takeBackground, job& found);
+    void finishJob(jobCounter* counter);
+    uint32_t currentQueue();
+};
+
+#endif /* jobSystem_hpp */
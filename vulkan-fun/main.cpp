@@ -5,8 +5,12 @@
 #include <stdexcept>
 #include <cstdlib>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
 #include "windowManager.hpp"
 #include "vulkan.hpp"
+#include "settings.hpp"
 
 //TODO
 // Move some of the class starter function that take in inits to a new init function that calls everything that way
@@ -18,7 +22,7 @@
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
-// Defines how many frames can be processed concurrently
+// Upper limit on how many frames can be processed concurrently, the latency policy picks how many are actually used
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
 const std::vector<const char*> validationLayers = {
@@ -42,27 +46,124 @@ class HelloTriangleApplication{
 public:
     void run() {
         // Overall progression of big events
+        // The main thread only looks after the window, everything vulkan lives on the render thread so a slow window system can't hold up frames
+        settings.loadSettings();
         window.init(&enableValidationLayers, &WIDTH, &HEIGHT);
-        vulkan.initVulkan(&enableValidationLayers, &validationLayers, &deviceExtensions, &window, &MAX_FRAMES_IN_FLIGHT);
+        
+        // The render thread starts on the instance while the window is still being made, unless startup is being run the old serial way
+        if (settings.serialInit){
+            window.createWindow();
+        }
+        rendering = true;
+        std::thread renderThread(&HelloTriangleApplication::renderLoop, this);
+        if (!settings.serialInit){
+            window.createWindow();
+        }
         mainLoop();
+        renderThread.join();
+        
         cleanup();
+        
+        // Anything that went wrong on the render thread gets thrown again here so main still reports it
+        if (renderError){
+            std::rethrow_exception(renderError);
+        }
     }
 private:
     // Starts out the modules
+    settings settings;
     windowManager window;
     vulkan vulkan;
+    
+    std::atomic<bool> rendering;
+    std::exception_ptr renderError;
 
     void mainLoop() {
-        while(!glfwWindowShouldClose(window.window)){
-            glfwPollEvents();
-            vulkan.drawFrame();
+        // Dragging and resizing can block in here for as long as the os likes, the render thread just keeps going
+        // A dropped close has nothing to wake this up again, so it gets retried on a short timeout until the render thread has room for it
+        while (rendering){
+            if (window.retryClose()){
+                glfwWaitEventsTimeout(0.005);
+            } else {
+                glfwWaitEvents();
+            }
+        }
+    }
+    
+    void renderLoop() {
+        try {
+            vulkan.initVulkan(&enableValidationLayers, &validationLayers, &deviceExtensions, &window, &MAX_FRAMES_IN_FLIGHT, &settings);
+            
+            bool running = true;
+            while (running){
+                // Sleeping goes before reading the events so the input is as fresh as it can be when the frame gets built
+                vulkan.framePacer.waitForNextFrame();
+                running = processEvents();
+                if (!running){
+                    break;
+                }
+                vulkan.drawFrame();
+                
+                // Benchmark runs stop on their own so the two backends get compared over the same number of frames
+                if (settings.benchmarkFrames > 0 && vulkan.frameStats.frameCount >= settings.benchmarkFrames){
+                    running = false;
+                }
+            }
+            
+            vkDeviceWaitIdle(vulkan.devices.device);
+            vulkan.destroyVulkan();
+        } catch (...) {
+            renderError = std::current_exception();
+            // Workers might still be running init steps, they have to be finished and joined before anything goes away
+            vulkan.jobSystem.destroyJobSystem();
         }
         
-        vkDeviceWaitIdle(vulkan.devices.device);
+        // Wakes the main thread out of glfwWaitEvents so it notices rendering has stopped
+        rendering = false;
+        glfwPostEmptyEvent();
+    }
+
+    bool processEvents() {
+        // Drains everything the main thread queued up since the last frame, returns false once the window wants to close
+        inputEvent event;
+        while (window.events.pop(event)){
+            switch (event.type){
+                case inputEvent::key:
+                    if (event.action == GLFW_PRESS){
+                        vulkan.noteInput(event.time);
+                        handleKey(event.code);
+                    }
+                    break;
+                case inputEvent::mouseButton:
+                    if (event.action == GLFW_PRESS){
+                        vulkan.noteInput(event.time);
+                    }
+                    break;
+                case inputEvent::resize:
+                    vulkan.notifyResized();
+                    break;
+                case inputEvent::close:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void handleKey(int key) {
+        // 1, 2 and 3 switch between the latency policies so they can be compared without restarting
+        if (key == GLFW_KEY_1){
+            vulkan.setLatencyPolicy(latencyPolicy::lowestLatency);
+        } else if (key == GLFW_KEY_2){
+            vulkan.setLatencyPolicy(latencyPolicy::balanced);
+        } else if (key == GLFW_KEY_3){
+            vulkan.setLatencyPolicy(latencyPolicy::powerSave);
+        }
     }
 
     void cleanup() {
-        vulkan.destroyVulkan();
+        if (window.droppedEvents > 0){
+            std::cout << window.droppedEvents << " input events dropped because the render thread fell behind" << std::endl;
+        }
         window.destroyWindow();
     }
 };
@@ -0,0 +1,214 @@
+#include "memoryBudget.hpp"
+
+namespace {
+    double toMegabytes(VkDeviceSize bytes){
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+void memoryBudget::initMemoryBudget(VkPhysicalDevice initPhysicalDevice, VkDevice initDevice, bool initBudgetExtension){
+    physicalDevice = initPhysicalDevice;
+    device = initDevice;
+    budgetExtension = initBudgetExtension;
+    
+    // Allocations only say which memory type they want, the heap behind each type is what the budget is kept for
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    typeHeaps.resize(memoryProperties.memoryTypeCount);
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++){
+        typeHeaps[i] = memoryProperties.memoryTypes[i].heapIndex;
+    }
+    heaps.resize(memoryProperties.memoryHeapCount);
+    underPressure.assign(memoryProperties.memoryHeapCount, false);
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    queryBudget();
+    std::cout << "Memory budget " << (budgetExtension ? "from the driver" : "estimated from heap sizes") << ":";
+    for (uint32_t i = 0; i < heaps.size(); i++){
+        std::cout << " heap " << i << (heaps[i].deviceLocal ? " (device local) " : " ") << toMegabytes(heaps[i].budget) << " of " << toMegabytes(heaps[i].size) << " MB";
+    }
+    std::cout << std::endl;
+}
+
+void memoryBudget::queryBudget(){
+    // Cheap enough to do every frame, the driver keeps these numbers up to date itself
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+#ifdef VK_EXT_memory_budget
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (budgetExtension){
+        properties.pNext = &budgetProperties;
+    }
+#endif
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties);
+    
+    for (uint32_t i = 0; i < heaps.size(); i++){
+        const VkMemoryHeap& memoryHeap = properties.memoryProperties.memoryHeaps[i];
+        heapBudget& heap = heaps[i];
+        heap.size = memoryHeap.size;
+        heap.deviceLocal = (memoryHeap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+#ifdef VK_EXT_memory_budget
+        if (budgetExtension){
+            heap.budget = budgetProperties.heapBudget[i];
+            heap.usage = budgetProperties.heapUsage[i];
+            continue;
+        }
+#endif
+        heap.budget = static_cast<VkDeviceSize>(memoryHeap.size * fallbackBudget);
+        heap.usage = heap.tracked;
+    }
+}
+
+VkResult memoryBudget::allocate(const VkMemoryAllocateInfo& allocInfo, memoryCategory category, VkDeviceMemory* memory){
+    uint32_t heap = typeHeaps[allocInfo.memoryTypeIndex];
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, memory);
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    if (result != VK_SUCCESS){
+        // The next update treats the heap as over budget whatever the numbers say, the caller decides what to do about this one
+        failedAllocations++;
+        allocationFailed = true;
+        underPressure[heap] = true;
+        std::cerr << "Allocating " << toMegabytes(allocInfo.allocationSize) << " MB of " << getCategoryName(category) << " from heap " << heap << " failed" << std::endl;
+        return result;
+    }
+    
+    allocations[*memory] = {allocInfo.allocationSize, heap, category};
+    heaps[heap].tracked += allocInfo.allocationSize;
+    categoryUsage[static_cast<size_t>(category)] += allocInfo.allocationSize;
+    return result;
+}
+
+void memoryBudget::free(VkDeviceMemory memory){
+    if (memory == VK_NULL_HANDLE){
+        return;
+    }
+    // The record goes first, once it's freed the driver can hand the same handle to another thread's allocation
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto record = allocations.find(memory);
+        if (record != allocations.end()){
+            heaps[record->second.heap].tracked -= record->second.size;
+            categoryUsage[static_cast<size_t>(record->second.category)] -= record->second.size;
+            allocations.erase(record);
+        }
+    }
+    vkFreeMemory(device, memory, nullptr);
+}
+
+void memoryBudget::update(){
+    std::vector<memoryPressure> events;
+    std::vector<std::function<void(const memoryPressure&)>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queryBudget();
+        
+        for (uint32_t i = 0; i < heaps.size(); i++){
+            const heapBudget& heap = heaps[i];
+            VkDeviceSize high = static_cast<VkDeviceSize>(heap.budget * highWatermark);
+            VkDeviceSize low = static_cast<VkDeviceSize>(heap.budget * lowWatermark);
+            
+            if (heap.usage > high && !underPressure[i]){
+                underPressure[i] = true;
+                std::cout << "Memory pressure on heap " << i << ", " << toMegabytes(heap.usage) << " of " << toMegabytes(heap.budget) << " MB budget in use" << std::endl;
+            } else if (underPressure[i] && heap.usage <= low && !allocationFailed){
+                underPressure[i] = false;
+                events.push_back({i, heap.deviceLocal, heap.usage, heap.budget, 0});
+                continue;
+            }
+            
+            // A failed allocation can happen under the low mark, the driver's idea of free memory isn't always the budget's, so ask for a little back anyway
+            if (underPressure[i]){
+                VkDeviceSize bytesToFree = heap.usage > low ? heap.usage - low : heap.budget / 20;
+                events.push_back({i, heap.deviceLocal, heap.usage, heap.budget, bytesToFree});
+            }
+        }
+        allocationFailed = false;
+        
+        if (events.empty()){
+            return;
+        }
+        for (const auto& subscriber : subscribers){
+            callbacks.push_back(subscriber.second);
+        }
+    }
+    
+    // Outside the lock, freeing memory from a callback comes back in through free
+    for (const auto& event : events){
+        for (const auto& callback : callbacks){
+            callback(event);
+        }
+    }
+}
+
+uint32_t memoryBudget::subscribe(std::function<void(const memoryPressure&)> callback){
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t id = nextSubscriber++;
+    subscribers.push_back({id, callback});
+    return id;
+}
+
+void memoryBudget::unsubscribe(uint32_t id){
+    std::lock_guard<std::mutex> lock(mutex);
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [id](const std::pair<uint32_t, std::function<void(const memoryPressure&)>>& subscriber){
+        return subscriber.first == id;
+    }), subscribers.end());
+}
+
+std::vector<heapBudget> memoryBudget::getHeaps(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return heaps;
+}
+
+VkDeviceSize memoryBudget::getCategoryUsage(memoryCategory category){
+    std::lock_guard<std::mutex> lock(mutex);
+    return categoryUsage[static_cast<size_t>(category)];
+}
+
+const char* memoryBudget::getCategoryName(memoryCategory category){
+    switch (category){
+        case memoryCategory::buffers:
+            return "buffers";
+        case memoryCategory::images:
+            return "images";
+        case memoryCategory::staging:
+            return "staging";
+        case memoryCategory::attachments:
+            return "attachments";
+        case memoryCategory::count:
+            break;
+    }
+    return "unknown";
+}
+
+void memoryBudget::printReport(){
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < heaps.size(); i++){
+        const heapBudget& heap = heaps[i];
+        if (heap.tracked == 0 && heap.usage == 0){
+            continue;
+        }
+        std::cout << "Heap " << i << (heap.deviceLocal ? " (device local)" : "") << ": " << toMegabytes(heap.usage) << " of " << toMegabytes(heap.budget) << " MB budget in use, " << toMegabytes(heap.tracked) << " MB allocated here" << std::endl;
+    }
+    
+    std::cout << "Memory by category:";
+    for (size_t category = 0; category < static_cast<size_t>(memoryCategory::count); category++){
+        std::cout << " " << getCategoryName(static_cast<memoryCategory>(category)) << " " << toMegabytes(categoryUsage[category]) << " MB";
+    }
+    std::cout << ", " << allocations.size() << " allocations, " << failedAllocations << " failed" << std::endl;
+}
+
+void memoryBudget::destroyMemoryBudget(){
+    // Everything should be gone by the time the device is, anything left over is a leak
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!allocations.empty()){
+        VkDeviceSize leaked = 0;
+        for (const auto& record : allocations){
+            leaked += record.second.size;
+        }
+        std::cerr << allocations.size() << " allocations (" << toMegabytes(leaked) << " MB) were never freed" << std::endl;
+    }
+    allocations.clear();
+    subscribers.clear();
+}
@@ -0,0 +1,93 @@
+#ifndef memoryBudget_hpp
+#define memoryBudget_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <iostream>
+#include <algorithm>
+
+// What an allocation is for, so the totals can say where the memory went
+enum class memoryCategory {
+    buffers,
+    images,
+    staging,
+    attachments,
+    count
+};
+
+// Where a heap stands, usage and budget come from the driver when it has VK_EXT_memory_budget
+struct heapBudget {
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+    // Only what went through allocate, the driver's usage also has everything it made on its own
+    VkDeviceSize tracked = 0;
+    bool deviceLocal = false;
+};
+
+// Handed to subscribers when a heap gets close to its budget, and once more with nothing to free when it's back under
+struct memoryPressure {
+    uint32_t heap;
+    bool deviceLocal;
+    VkDeviceSize usage;
+    VkDeviceSize budget;
+    VkDeviceSize bytesToFree;
+};
+
+// Every vkAllocateMemory goes through here so each heap's usage is known by category
+// Once a frame the budget gets read back and anything that can give memory up is told to before the driver has to start paging or failing allocations
+class memoryBudget{
+public:
+    void initMemoryBudget(VkPhysicalDevice initPhysicalDevice, VkDevice initDevice, bool initBudgetExtension);
+    // Safe from any thread, same results as vkAllocateMemory
+    VkResult allocate(const VkMemoryAllocateInfo& allocInfo, memoryCategory category, VkDeviceMemory* memory);
+    void free(VkDeviceMemory memory);
+    // Once a frame on the render thread, the callbacks run from in here
+    void update();
+    // Returns an id to unsubscribe with, the callback has to be fine being called every frame for as long as a heap stays over
+    uint32_t subscribe(std::function<void(const memoryPressure&)> callback);
+    void unsubscribe(uint32_t id);
+    std::vector<heapBudget> getHeaps();
+    VkDeviceSize getCategoryUsage(memoryCategory category);
+    void printReport();
+    void destroyMemoryBudget();
+    
+    static const char* getCategoryName(memoryCategory category);
+private:
+    struct allocationRecord {
+        VkDeviceSize size;
+        uint32_t heap;
+        memoryCategory category;
+    };
+    
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    bool budgetExtension;
+    std::vector<uint32_t> typeHeaps;
+    
+    // Allocations come from init jobs and streaming as well as the render thread
+    std::mutex mutex;
+    std::unordered_map<VkDeviceMemory, allocationRecord> allocations;
+    std::vector<heapBudget> heaps;
+    std::vector<bool> underPressure;
+    VkDeviceSize categoryUsage[static_cast<size_t>(memoryCategory::count)] = {};
+    uint64_t failedAllocations = 0;
+    bool allocationFailed = false;
+    
+    std::vector<std::pair<uint32_t, std::function<void(const memoryPressure&)>>> subscribers;
+    uint32_t nextSubscriber = 0;
+    
+    // Pressure starts over the high mark and ends under the low one, subscribers get asked to free down to the low mark
+    static constexpr double highWatermark = 0.9;
+    static constexpr double lowWatermark = 0.8;
+    // Without the extension the driver's view of the budget is unknown, so only this much of each heap is counted on
+    static constexpr double fallbackBudget = 0.8;
+    
+    void queryBudget();
+};
+
+#endif /* memoryBudget_hpp */
@@ -0,0 +1,164 @@
+#include "meshFile.hpp"
+
+namespace {
+    const char meshMagic[4] = {'V', 'K', 'F', 'M'};
+    
+    uint64_t alignUp(uint64_t value){
+        return (value + meshStreamAlignment - 1) / meshStreamAlignment * meshStreamAlignment;
+    }
+    
+    // Whether count elements of size bytes starting at offset end by limit
+    // The header comes straight off the disk, so this divides instead of adding or multiplying so nothing can wrap around and pass
+    bool blockFits(uint64_t offset, uint64_t count, uint64_t size, uint64_t limit){
+        if (offset > limit){
+            return false;
+        }
+        return size == 0 || count <= (limit - offset) / size;
+    }
+}
+
+void meshFile::writeMesh(const std::string& filename, const meshData& mesh){
+    // Header, vertices, indices, lods, meshlets, each block aligned, zero padding in between
+    meshHeader fileHeader{};
+    std::memcpy(fileHeader.magic, meshMagic, sizeof(meshMagic));
+    fileHeader.version = meshFileVersion;
+    fileHeader.vertexStride = sizeof(meshVertex);
+    fileHeader.indexSize = mesh.vertices.size() <= 0xFFFF ? 2 : 4;
+    fileHeader.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    fileHeader.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    fileHeader.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    fileHeader.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+    
+    for (int axis = 0; axis < 3; axis++){
+        fileHeader.boundsMin[axis] = mesh.vertices.empty() ? 0.0f : mesh.vertices[0].position[axis];
+        fileHeader.boundsMax[axis] = fileHeader.boundsMin[axis];
+    }
+    for (const auto& vertex : mesh.vertices){
+        for (int axis = 0; axis < 3; axis++){
+            fileHeader.boundsMin[axis] = std::min(fileHeader.boundsMin[axis], vertex.position[axis]);
+            fileHeader.boundsMax[axis] = std::max(fileHeader.boundsMax[axis], vertex.position[axis]);
+        }
+    }
+    
+    fileHeader.vertexOffset = alignUp(sizeof(meshHeader));
+    fileHeader.indexOffset = alignUp(fileHeader.vertexOffset + mesh.vertices.size() * sizeof(meshVertex));
+    fileHeader.lodOffset = alignUp(fileHeader.indexOffset + mesh.indices.size() * fileHeader.indexSize);
+    fileHeader.meshletOffset = alignUp(fileHeader.lodOffset + mesh.lods.size() * sizeof(meshLod));
+    fileHeader.fileSize = fileHeader.meshletOffset + mesh.meshlets.size() * sizeof(meshlet);
+    
+    std::vector<char> data(fileHeader.fileSize, 0);
+    std::memcpy(data.data(), &fileHeader, sizeof(fileHeader));
+    if (!mesh.vertices.empty()){
+        std::memcpy(data.data() + fileHeader.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(meshVertex));
+    }
+    if (fileHeader.indexSize == 2){
+        for (size_t i = 0; i < mesh.indices.size(); i++){
+            uint16_t index = static_cast<uint16_t>(mesh.indices[i]);
+            std::memcpy(data.data() + fileHeader.indexOffset + i * 2, &index, 2);
+        }
+    } else if (!mesh.indices.empty()){
+        std::memcpy(data.data() + fileHeader.indexOffset, mesh.indices.data(), mesh.indices.size() * 4);
+    }
+    if (!mesh.lods.empty()){
+        std::memcpy(data.data() + fileHeader.lodOffset, mesh.lods.data(), mesh.lods.size() * sizeof(meshLod));
+    }
+    if (!mesh.meshlets.empty()){
+        std::memcpy(data.data() + fileHeader.meshletOffset, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(meshlet));
+    }
+    
+    writeFile(filename, data);
+}
+
+void meshFile::openMesh(const std::string& filename){
+    // Only the header gets looked at, the streams are used straight out of the mapping
+    mapping = mapFile(filename);
+    header = nullptr;
+    
+    if (mapping.size() < sizeof(meshHeader)){
+        throw std::runtime_error("Mesh file is too small to have a header!");
+    }
+    const meshHeader* fileHeader = reinterpret_cast<const meshHeader*>(mapping.data());
+    if (std::memcmp(fileHeader->magic, meshMagic, sizeof(meshMagic)) != 0){
+        throw std::runtime_error("Not a mesh file!");
+    }
+    if (fileHeader->version != meshFileVersion){
+        throw std::runtime_error("Mesh file is version " + std::to_string(fileHeader->version) + ", convert it again for version " + std::to_string(meshFileVersion) + "!");
+    }
+    if (fileHeader->vertexStride != sizeof(meshVertex) || (fileHeader->indexSize != 2 && fileHeader->indexSize != 4)){
+        throw std::runtime_error("Mesh file has a vertex or index layout this build doesn't know!");
+    }
+    
+    // Every block has to sit inside the file in order, otherwise a bad file would have us reading past the mapping
+    // Each block is checked against where the next one starts, the last one against the end of the file
+    bool fits = fileHeader->fileSize == mapping.size() &&
+        fileHeader->vertexOffset >= sizeof(meshHeader) &&
+        blockFits(fileHeader->vertexOffset, fileHeader->vertexCount, fileHeader->vertexStride, fileHeader->indexOffset) &&
+        blockFits(fileHeader->indexOffset, fileHeader->indexCount, fileHeader->indexSize, fileHeader->lodOffset) &&
+        blockFits(fileHeader->lodOffset, fileHeader->lodCount, sizeof(meshLod), fileHeader->meshletOffset) &&
+        blockFits(fileHeader->meshletOffset, fileHeader->meshletCount, sizeof(meshlet), fileHeader->fileSize);
+    if (!fits){
+        throw std::runtime_error("Mesh file is truncated or its offsets are wrong!");
+    }
+    header = fileHeader;
+}
+
+void meshFile::closeMesh(){
+    header = nullptr;
+    mapping.unmap();
+}
+
+const meshHeader& meshFile::getHeader(){
+    return *header;
+}
+
+size_t meshFile::getStreamSize(){
+    return static_cast<size_t>(header->indexOffset - header->vertexOffset) + static_cast<size_t>(header->indexCount) * header->indexSize;
+}
+
+size_t meshFile::getIndexStreamOffset(){
+    return static_cast<size_t>(header->indexOffset - header->vertexOffset);
+}
+
+void meshFile::copyStreams(void* destination){
+    // The whole load is this one copy, straight from the page cache into the staging memory
+    std::memcpy(destination, mapping.data() + header->vertexOffset, getStreamSize());
+}
+
+const meshLod* meshFile::getLods(){
+    return reinterpret_cast<const meshLod*>(mapping.data() + header->lodOffset);
+}
+
+const meshlet* meshFile::getMeshlets(){
+    return reinterpret_cast<const meshlet*>(mapping.data() + header->meshletOffset);
+}
+
+void meshFile::runBenchmark(const std::string& filename, uint32_t iterations){
+    // Warm page cache on purpose, this is measuring the load path and not the disk
+    meshFile mesh;
+    mesh.openMesh(filename);
+    size_t streamSize = mesh.getStreamSize();
+    mesh.closeMesh();
+    std::vector<char> staging(streamSize);
+    
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++){
+        mesh.openMesh(filename);
+        mesh.copyStreams(staging.data());
+        mesh.closeMesh();
+    }
+    std::chrono::duration<double> mapped = std::chrono::steady_clock::now() - start;
+    
+    // The same bytes going through readFile first, which is what a parsing loader would start from anyway
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++){
+        std::vector<char> data = readFile(filename);
+        const meshHeader* fileHeader = reinterpret_cast<const meshHeader*>(data.data());
+        std::memcpy(staging.data(), data.data() + fileHeader->vertexOffset, streamSize);
+    }
+    std::chrono::duration<double> read = std::chrono::steady_clock::now() - start;
+    
+    double gigabytes = static_cast<double>(streamSize) * iterations / 1e9;
+    std::cout << "Mesh load of " << filename << ", " << streamSize / 1024 << " KB of streams, " << iterations << " times" << std::endl;
+    std::cout << "  mmap + copy: " << gigabytes / mapped.count() << " GB/s, " << mapped.count() * 1000.0 / iterations << " ms each" << std::endl;
+    std::cout << "  readFile + copy: " << gigabytes / read.count() << " GB/s, " << read.count() * 1000.0 / iterations << " ms each" << std::endl;
+}
@@ -0,0 +1,97 @@
+#ifndef meshFile_hpp
+#define meshFile_hpp
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "file.hpp"
+
+// Goes up whenever the layout changes, older files have to be run through the converter again
+const uint32_t meshFileVersion = 1;
+// Every stream starts on this boundary so the copy into a staging buffer lands aligned as well
+const uint32_t meshStreamAlignment = 64;
+
+struct meshVertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+// A level of detail, a range of the index stream using the same vertices as every other level
+struct meshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // How far off this level can be from the full mesh, in model units
+    float error;
+    uint32_t reserved;
+};
+
+// A small group of triangles with its own bounds so it can be culled on its own
+struct meshlet {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float center[3];
+    float radius;
+};
+
+// The very start of the file, everything else is found through the offsets in here
+struct meshHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexStride;
+    // 2 or 4, meshes with few enough vertices get 16 bit indices
+    uint32_t indexSize;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    uint32_t meshletCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    // Byte offsets from the start of the file, the vertex stream is followed directly by the index stream
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t lodOffset;
+    uint64_t meshletOffset;
+    uint64_t fileSize;
+};
+static_assert(sizeof(meshHeader) == 96, "meshHeader is written to disk as is");
+
+// Binary mesh container, written offline by tools/meshConvert and mapped with nothing parsed
+// Loading is mapping the file, checking the header and one copy of the streams into wherever they're going
+// The renderer still draws generated triangles, so for now this only builds into the meshconvert target, which is where the benchmark lives too
+class meshFile : public File {
+public:
+    // What the converter builds before writing, indices are always 32 bit here and get narrowed on write when they fit
+    struct meshData {
+        std::vector<meshVertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<meshLod> lods;
+        std::vector<meshlet> meshlets;
+    };
+    
+    static void writeMesh(const std::string& filename, const meshData& mesh);
+    
+    // Throws if the header doesn't match this version or the offsets run past the end of the file
+    void openMesh(const std::string& filename);
+    void closeMesh();
+    const meshHeader& getHeader();
+    // Both streams as one block, the index stream starts getIndexStreamOffset bytes in
+    size_t getStreamSize();
+    size_t getIndexStreamOffset();
+    void copyStreams(void* destination);
+    const meshLod* getLods();
+    const meshlet* getMeshlets();
+    
+    // Maps and copies the file over and over, prints GB/s next to reading it the ordinary way
+    static void runBenchmark(const std::string& filename, uint32_t iterations = 50);
+private:
+    mappedFile mapping;
+    const meshHeader* header = nullptr;
+};
+
+#endif /* meshFile_hpp */
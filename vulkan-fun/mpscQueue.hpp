@@ -0,0 +1,72 @@
+#ifndef mpscQueue_hpp
+#define mpscQueue_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed size ring buffer any number of threads can push into and exactly one thread pops from, no locks so a pushing thread never waits on another
+// Every cell carries a sequence number saying whose turn it is, pushers claim a cell with one compare exchange and publish it by bumping the sequence
+// Capacity has to be a power of two so the indices can just wrap with a mask
+template <typename T, size_t capacity>
+class mpscQueue {
+    static_assert((capacity & (capacity - 1)) == 0, "mpscQueue capacity must be a power of two");
+public:
+    mpscQueue(){
+        for (size_t i = 0; i < capacity; i++){
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    // Producer side, from any thread, returns false when the queue is full instead of waiting
+    bool push(const T& item){
+        size_t position = enqueueIndex.load(std::memory_order_relaxed);
+        cell* target;
+        while (true){
+            target = &cells[position & (capacity - 1)];
+            size_t sequence = target->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0){
+                // The cell is free for this position, whoever wins the exchange gets to fill it
+                if (enqueueIndex.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                    break;
+                }
+            } else if (difference < 0){
+                return false;
+            } else {
+                position = enqueueIndex.load(std::memory_order_relaxed);
+            }
+        }
+        
+        target->item = item;
+        target->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side, only ever one thread, returns false when there's nothing to take
+    bool pop(T& item){
+        cell& target = cells[dequeueIndex & (capacity - 1)];
+        size_t sequence = target.sequence.load(std::memory_order_acquire);
+        if (sequence != dequeueIndex + 1){
+            return false;
+        }
+        
+        item = target.item;
+        target.sequence.store(dequeueIndex + capacity, std::memory_order_release);
+        dequeueIndex++;
+        return true;
+    }
+
+private:
+    struct cell {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+    
+    cell cells[capacity];
+    // Kept on their own cache lines, pushers hammer the first and only the consumer touches the second
+    alignas(64) std::atomic<size_t> enqueueIndex{0};
+    alignas(64) size_t dequeueIndex = 0;
+};
+
+#endif /* mpscQueue_hpp */
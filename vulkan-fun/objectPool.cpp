@@ -0,0 +1,155 @@
+#include "objectPool.hpp"
+
+void objectPool::initObjectPool(VkDevice initDevice, deletionQueue* initDeletionQueue){
+    device = initDevice;
+    pDeletionQueue = initDeletionQueue;
+}
+
+void objectPool::countAcquire(objectKind kind, bool reused){
+    acquired[kind]++;
+    if (!reused){
+        created[kind]++;
+        lastCreatedFrame = frame;
+    }
+}
+
+VkFence objectPool::acquireFence(){
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!freeFences.empty()){
+        VkFence fence = freeFences.back();
+        freeFences.pop_back();
+        countAcquire(fenceKind, true);
+        return fence;
+    }
+    
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    
+    VkFence fence;
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pooled fence!");
+    }
+    fences.emplace_back(device, fence, vkDestroyFence);
+    countAcquire(fenceKind, false);
+    return fence;
+}
+
+VkSemaphore objectPool::acquireSemaphore(){
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!freeSemaphores.empty()){
+        VkSemaphore semaphore = freeSemaphores.back();
+        freeSemaphores.pop_back();
+        countAcquire(semaphoreKind, true);
+        return semaphore;
+    }
+    
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    
+    VkSemaphore semaphore;
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pooled semaphore!");
+    }
+    semaphores.emplace_back(device, semaphore, vkDestroySemaphore);
+    countAcquire(semaphoreKind, false);
+    return semaphore;
+}
+
+objectPool::familyPool& objectPool::getFamilyPool(uint32_t queueFamily){
+    // Only ever one or two families, a search is plenty
+    for (auto& pool : familyPools){
+        if (pool.queueFamily == queueFamily){
+            return pool;
+        }
+    }
+    
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+    
+    VkCommandPool commandPool;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pooled command pool!");
+    }
+    familyPools.push_back({queueFamily, uniqueHandle<VkCommandPool>(device, commandPool, vkDestroyCommandPool), {}});
+    return familyPools.back();
+}
+
+VkCommandBuffer objectPool::acquireCommandBuffer(uint32_t queueFamily){
+    std::lock_guard<std::mutex> lock(mutex);
+    familyPool& pool = getFamilyPool(queueFamily);
+    if (!pool.free.empty()){
+        VkCommandBuffer commandBuffer = pool.free.back();
+        pool.free.pop_back();
+        countAcquire(commandBufferKind, true);
+        return commandBuffer;
+    }
+    
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = pool.commandPool.get();
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    
+    // Freed along with the pool, so nothing else needs to own it
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate pooled command buffer!");
+    }
+    countAcquire(commandBufferKind, false);
+    return commandBuffer;
+}
+
+void objectPool::releaseFence(VkFence fence){
+    pDeletionQueue->push([this, fence](){
+        vkResetFences(device, 1, &fence);
+        std::lock_guard<std::mutex> lock(mutex);
+        freeFences.push_back(fence);
+    });
+}
+
+void objectPool::releaseSemaphore(VkSemaphore semaphore){
+    pDeletionQueue->push([this, semaphore](){
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSemaphores.push_back(semaphore);
+    });
+}
+
+void objectPool::releaseCommandBuffer(uint32_t queueFamily, VkCommandBuffer commandBuffer){
+    pDeletionQueue->push([this, queueFamily, commandBuffer](){
+        vkResetCommandBuffer(commandBuffer, 0);
+        std::lock_guard<std::mutex> lock(mutex);
+        getFamilyPool(queueFamily).free.push_back(commandBuffer);
+    });
+}
+
+void objectPool::nextFrame(){
+    std::lock_guard<std::mutex> lock(mutex);
+    frame++;
+}
+
+void objectPool::printCounters(){
+    // Once things have warmed up every acquire should be a reuse, the last creation frame says when that happened
+    std::lock_guard<std::mutex> lock(mutex);
+    const char* names[kindCount] = {"fences", "semaphores", "command buffers"};
+    std::cout << "Object pool:";
+    for (uint32_t kind = 0; kind < kindCount; kind++){
+        std::cout << " " << names[kind] << " " << created[kind] << " created for " << acquired[kind] << " acquires" << (kind + 1 < kindCount ? "," : "");
+    }
+    std::cout << ", nothing created after frame " << lastCreatedFrame << " of " << frame << ", " << handleCounters::deferred.load() << " handles destroyed through the deletion queue" << std::endl;
+}
+
+void objectPool::destroyObjectPool(){
+    // The command buffers go with their pools
+    std::lock_guard<std::mutex> lock(mutex);
+    freeFences.clear();
+    freeSemaphores.clear();
+    fences.clear();
+    semaphores.clear();
+    familyPools.clear();
+    
+    if (handleCounters::live.load() != 0){
+        std::cerr << handleCounters::live.load() << " owned handles were never destroyed" << std::endl;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef objectPool_hpp
+#define objectPool_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <mutex>
+#include <iostream>
+#include <stdexcept>
+#include <cstdint>
+#include "deletionQueue.hpp"
+#include "vulkanHandle.hpp"
+
+// Hands out fences, semaphores and command buffers and takes them back once the frames using them are done, so nothing gets created or destroyed while running
+// The pool owns everything it ever made and destroys it all at the end, what's handed out is only borrowed
+class objectPool{
+public:
+    void initObjectPool(VkDevice initDevice, deletionQueue* initDeletionQueue);
+    // Unsignaled and ready to submit with
+    VkFence acquireFence();
+    VkSemaphore acquireSemaphore();
+    // A primary command buffer from a resettable pool for that family, already reset
+    VkCommandBuffer acquireCommandBuffer(uint32_t queueFamily);
+    // These go through the deletion queue, so they can be released the same frame the gpu is still told to use them
+    // A fence has to be signaled or never submitted, a semaphore can't have a signal nobody waits on
+    void releaseFence(VkFence fence);
+    void releaseSemaphore(VkSemaphore semaphore);
+    void releaseCommandBuffer(uint32_t queueFamily, VkCommandBuffer commandBuffer);
+    // Once a frame, only so the counters can say when the last object got made
+    void nextFrame();
+    void printCounters();
+    // Only once the device is idle and the deletion queue is flushed
+    void destroyObjectPool();
+private:
+    enum objectKind {
+        fenceKind,
+        semaphoreKind,
+        commandBufferKind,
+        kindCount
+    };
+    
+    struct familyPool {
+        uint32_t queueFamily;
+        uniqueHandle<VkCommandPool> commandPool;
+        std::vector<VkCommandBuffer> free;
+    };
+    
+    VkDevice device;
+    deletionQueue* pDeletionQueue;
+    
+    // Batches get started by the render thread but released from the deletion queue, and init jobs can ask for things too
+    std::mutex mutex;
+    std::vector<uniqueHandle<VkFence>> fences;
+    std::vector<uniqueHandle<VkSemaphore>> semaphores;
+    std::vector<VkFence> freeFences;
+    std::vector<VkSemaphore> freeSemaphores;
+    std::vector<familyPool> familyPools;
+    
+    uint64_t created[kindCount] = {};
+    uint64_t acquired[kindCount] = {};
+    uint64_t frame = 0;
+    uint64_t lastCreatedFrame = 0;
+    
+    familyPool& getFamilyPool(uint32_t queueFamily);
+    void countAcquire(objectKind kind, bool reused);
+};
+
+#endif /* objectPool_hpp */
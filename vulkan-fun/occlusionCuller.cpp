@@ -0,0 +1,542 @@
+#include "occlusionCuller.hpp"
+#include "commands.hpp"
+
+namespace {
+    const uint32_t cullWorkgroup = 64;
+    const uint32_t pyramidWorkgroup = 8;
+    
+    // The draw for each phase, instanceCount gets counted up by the cull shader
+    const uint32_t emptyDraws[8] = {3, 0, 0, 0, 3, 0, 0, 0};
+    
+    uint32_t previousPowerOfTwo(uint32_t value){
+        uint32_t result = 1;
+        while (result * 2 <= value){
+            result *= 2;
+        }
+        return result;
+    }
+    
+    void computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess){
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+void occlusionCuller::loadShaders(pipelineManager* initPipelineManager){
+    pPipelineManager = initPipelineManager;
+    pPipelineManager->loadShader("cullobjects.spv");
+    pPipelineManager->loadShader("hizbuild.spv");
+}
+
+VkFormat occlusionCuller::findDepthFormat(VkPhysicalDevice physicalDevice){
+    // 16 bit depth has to be drawable and sampleable everywhere, 32 bit float is nicer when it's there
+    VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM};
+    VkFormatFeatureFlags neededFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    for (VkFormat format : candidates){
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+        if ((properties.optimalTilingFeatures & neededFeatures) == neededFeatures){
+            return format;
+        }
+    }
+    throw std::runtime_error("Failed to find a depth format that can be sampled!");
+}
+
+void occlusionCuller::initOcclusionCuller(devices* initDevices, renderGraph* initRenderGraph, scene* initScene, settings* initSettings, uint32_t initFramesInFlight){
+    pDevices = initDevices;
+    pRenderGraph = initRenderGraph;
+    pScene = initScene;
+    pSettings = initSettings;
+    framesInFlight = initFramesInFlight;
+    
+    // The pyramid, both draws, the visible ids the vertex shader reads too, and the early phase's verdicts
+    VkDescriptorSetLayoutBinding bindings[4]{};
+    for (uint32_t i = 0; i < 4; i++){
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[2].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = bindings;
+    
+    if (vkCreateDescriptorSetLayout(pDevices->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create culling descriptor set layout!");
+    }
+    
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = 3;
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    
+    if (vkCreateDescriptorPool(pDevices->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create culling descriptor pool!");
+    }
+    
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+    
+    if (vkAllocateDescriptorSets(pDevices->device, &allocInfo, &descriptorSet) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate culling descriptor set!");
+    }
+    
+    // Building the pyramid reads one level and writes the next
+    VkDescriptorSetLayoutBinding pyramidBindings[2]{};
+    for (uint32_t i = 0; i < 2; i++){
+        pyramidBindings[i].binding = i;
+        pyramidBindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        pyramidBindings[i].descriptorCount = 1;
+        pyramidBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = pyramidBindings;
+    
+    if (vkCreateDescriptorSetLayout(pDevices->device, &layoutInfo, nullptr, &pyramidSetLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create depth pyramid descriptor set layout!");
+    }
+    
+    // Everything gets read with texelFetch, the sampler is only there because the descriptors need one
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    
+    if (vkCreateSampler(pDevices->device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create culling sampler!");
+    }
+    
+    readbackBuffers.resize(framesInFlight);
+    readbackCounts.resize(framesInFlight);
+    submittedObjects.assign(framesInFlight, 0);
+    for (uint32_t i = 0; i < framesInFlight; i++){
+        readbackBuffers[i] = createBuffer(2 * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memoryCategory::staging);
+        void* mapped;
+        if (vkMapMemory(pDevices->device, readbackBuffers[i].memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS){
+            throw std::runtime_error("Failed to map culling readback memory!");
+        }
+        readbackCounts[i] = static_cast<uint32_t*>(mapped);
+        readbackCounts[i][0] = 0;
+        readbackCounts[i][1] = 0;
+    }
+    createBuffers(std::max(pScene->getEntityCount(), 1024u));
+}
+
+occlusionCuller::buffer occlusionCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, memoryCategory category){
+    buffer result;
+    
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    
+    if (vkCreateBuffer(pDevices->device, &bufferInfo, nullptr, &result.buffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create culling buffer!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(pDevices->device, result.buffer, &memoryRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, properties);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, category, &result.memory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate culling memory!");
+    }
+    vkBindBufferMemory(pDevices->device, result.buffer, result.memory, 0);
+    return result;
+}
+
+void occlusionCuller::destroyBuffer(buffer& target){
+    vkDestroyBuffer(pDevices->device, target.buffer, nullptr);
+    pDevices->memoryBudget.free(target.memory);
+    target.buffer = VK_NULL_HANDLE;
+    target.memory = VK_NULL_HANDLE;
+}
+
+void occlusionCuller::createBuffers(uint32_t newCapacity){
+    capacity = newCapacity;
+    drawBuffer = createBuffer(sizeof(emptyDraws), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryCategory::buffers);
+    visibleBuffer = createBuffer(static_cast<VkDeviceSize>(capacity) * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryCategory::buffers);
+    occludedBuffer = createBuffer(static_cast<VkDeviceSize>(capacity) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryCategory::buffers);
+    writeDescriptorSet();
+}
+
+void occlusionCuller::destroyBuffers(){
+    destroyBuffer(drawBuffer);
+    destroyBuffer(visibleBuffer);
+    destroyBuffer(occludedBuffer);
+}
+
+void occlusionCuller::writeDescriptorSet(){
+    // The pyramid only exists once the graph is compiled, until then the set only gets its buffers
+    VkDescriptorImageInfo imageInfo{sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorBufferInfo bufferInfos[3] = {
+        {drawBuffer.buffer, 0, VK_WHOLE_SIZE},
+        {visibleBuffer.buffer, 0, VK_WHOLE_SIZE},
+        {occludedBuffer.buffer, 0, VK_WHOLE_SIZE}
+    };
+    
+    VkWriteDescriptorSet writes[4]{};
+    for (uint32_t i = 0; i < 4; i++){
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pImageInfo = i == 0 ? &imageInfo : nullptr;
+        writes[i].pBufferInfo = i == 0 ? nullptr : &bufferInfos[i - 1];
+    }
+    uint32_t first = pyramidView == VK_NULL_HANDLE ? 1 : 0;
+    vkUpdateDescriptorSets(pDevices->device, 4 - first, writes + first, 0, nullptr);
+}
+
+void occlusionCuller::createPipelines(){
+    // Culling sees the scene's instances as set 0, same as the main pipeline, so the one scene set works for both
+    pushConstantLayout cullPushConstants;
+    cullRange = cullPushConstants.addRange<cullConstants>(VK_SHADER_STAGE_COMPUTE_BIT);
+    cullPushConstants.checkLimits(pDevices->physicalDevice);
+    
+    VkDescriptorSetLayout cullSetLayouts[2] = {pScene->descriptorSetLayout, descriptorSetLayout};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = cullSetLayouts;
+    cullPushConstants.fillLayoutInfo(pipelineLayoutInfo);
+    
+    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &cullLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create culling pipeline layout!");
+    }
+    cullPipeline = pPipelineManager->getComputePipeline({VK_SHADER_STAGE_COMPUTE_BIT, "cullobjects.spv", {}}, cullLayout, pipelineLayoutInfo);
+    
+    pushConstantLayout pyramidPushConstants;
+    pyramidRange = pyramidPushConstants.addRange<pyramidConstants>(VK_SHADER_STAGE_COMPUTE_BIT);
+    
+    pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &pyramidSetLayout;
+    pyramidPushConstants.fillLayoutInfo(pipelineLayoutInfo);
+    
+    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &pyramidLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create depth pyramid pipeline layout!");
+    }
+    pyramidPipeline = pPipelineManager->getComputePipeline({VK_SHADER_STAGE_COMPUTE_BIT, "hizbuild.spv", {}}, pyramidLayout, pipelineLayoutInfo);
+}
+
+void occlusionCuller::createResources(uint32_t initDepthImage, uint32_t imageCount){
+    // A power of two at or under the depth image in each direction, so every level is exactly half the one before
+    // Each texel of the first level covers at most a 3x3 patch of depth, the build shader reads all of it
+    depthImage = initDepthImage;
+    VkExtent2D depthExtent = pRenderGraph->getExtent(depthImage);
+    pyramidExtent = {previousPowerOfTwo(depthExtent.width), previousPowerOfTwo(depthExtent.height)};
+    pyramidLevels = 1;
+    while ((std::max(pyramidExtent.width, pyramidExtent.height) >> pyramidLevels) > 0){
+        pyramidLevels++;
+    }
+    
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.extent = {pyramidExtent.width, pyramidExtent.height, 1};
+    imageInfo.mipLevels = pyramidLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    
+    if (vkCreateImage(pDevices->device, &imageInfo, nullptr, &pyramid) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create depth pyramid!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(pDevices->device, pyramid, &memoryRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::images, &pyramidMemory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate depth pyramid memory!");
+    }
+    vkBindImageMemory(pDevices->device, pyramid, pyramidMemory, 0);
+    
+    // The whole chain for culling to pick a level from, and one view per level for building it
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramidLevels, 0, 1};
+    
+    if (vkCreateImageView(pDevices->device, &viewInfo, nullptr, &pyramidView) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create depth pyramid view!");
+    }
+    levelViews.resize(pyramidLevels);
+    for (uint32_t level = 0; level < pyramidLevels; level++){
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+        if (vkCreateImageView(pDevices->device, &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create depth pyramid level view!");
+        }
+    }
+    
+    uint32_t setCount = imageCount + pyramidLevels - 1;
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = setCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = setCount;
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = setCount;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    
+    if (vkCreateDescriptorPool(pDevices->device, &poolInfo, nullptr, &pyramidPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create depth pyramid descriptor pool!");
+    }
+    
+    std::vector<VkDescriptorSetLayout> layouts(setCount, pyramidSetLayout);
+    VkDescriptorSetAllocateInfo setAllocInfo{};
+    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocInfo.descriptorPool = pyramidPool;
+    setAllocInfo.descriptorSetCount = setCount;
+    setAllocInfo.pSetLayouts = layouts.data();
+    
+    std::vector<VkDescriptorSet> sets(setCount);
+    if (vkAllocateDescriptorSets(pDevices->device, &setAllocInfo, sets.data()) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate depth pyramid descriptor sets!");
+    }
+    depthSets.assign(sets.begin(), sets.begin() + imageCount);
+    levelSets.assign(sets.begin() + imageCount, sets.end());
+    
+    // The depth image is in shader read layout while the build runs, every level of the pyramid is always general
+    for (uint32_t i = 0; i < setCount; i++){
+        bool fromDepth = i < imageCount;
+        uint32_t level = fromDepth ? 0 : i - imageCount + 1;
+        VkDescriptorImageInfo imageInfos[2]{};
+        if (fromDepth){
+            imageInfos[0] = {sampler, pRenderGraph->getImageView(depthImage, i), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        } else {
+            imageInfos[0] = {sampler, levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL};
+        }
+        imageInfos[1] = {VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+        
+        VkWriteDescriptorSet writes[2]{};
+        for (uint32_t binding = 0; binding < 2; binding++){
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = sets[i];
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[binding].pImageInfo = &imageInfos[binding];
+        }
+        vkUpdateDescriptorSets(pDevices->device, 2, writes, 0, nullptr);
+    }
+    
+    // Freshly made pyramids hold garbage, they get cleared to the far plane so nothing gets culled by them and moved to general for good
+    commands::submitOnce(pDevices, [this](VkCommandBuffer commandBuffer){
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = pyramid;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramidLevels, 0, 1};
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        
+        VkClearColorValue farPlane = {{1.0f, 1.0f, 1.0f, 1.0f}};
+        vkCmdClearColorImage(commandBuffer, pyramid, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &barrier.subresourceRange);
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    });
+    
+    writeDescriptorSet();
+    pyramidUvScale[0] = 1.0f;
+    pyramidUvScale[1] = 1.0f;
+    uvScale[0] = 1.0f;
+    uvScale[1] = 1.0f;
+}
+
+void occlusionCuller::destroyResources(){
+    // Freeing the pool frees every set in it
+    if (pyramidPool != VK_NULL_HANDLE){
+        vkDestroyDescriptorPool(pDevices->device, pyramidPool, nullptr);
+        pyramidPool = VK_NULL_HANDLE;
+    }
+    depthSets.clear();
+    levelSets.clear();
+    for (VkImageView view : levelViews){
+        vkDestroyImageView(pDevices->device, view, nullptr);
+    }
+    levelViews.clear();
+    if (pyramid != VK_NULL_HANDLE){
+        vkDestroyImageView(pDevices->device, pyramidView, nullptr);
+        vkDestroyImage(pDevices->device, pyramid, nullptr);
+        pDevices->memoryBudget.free(pyramidMemory);
+        pyramidView = VK_NULL_HANDLE;
+        pyramid = VK_NULL_HANDLE;
+        pyramidMemory = VK_NULL_HANDLE;
+    }
+}
+
+void occlusionCuller::beginFrame(uint32_t frame, VkExtent2D renderExtent){
+    // The fence for this slot has been waited on, so the counts its last frame copied out are there to read
+    currentFrame = frame;
+    if (submittedObjects[currentFrame] > 0){
+        framesCounted++;
+        objectsSubmitted += submittedObjects[currentFrame];
+        earlyDraws += readbackCounts[currentFrame][0];
+        lateDraws += readbackCounts[currentFrame][1];
+    }
+    submittedObjects[currentFrame] = pScene->getEntityCount();
+    
+    // Every frame's culling shares the same buffers, so growing them means waiting until nothing is using them, it only happens when the scene gets bigger
+    if (pScene->getEntityCount() > capacity){
+        vkDeviceWaitIdle(pDevices->device);
+        destroyBuffers();
+        createBuffers(std::max(pScene->getEntityCount(), capacity * 2));
+    }
+    
+    // The pyramid the last frame built is what this frame's early phase tests against
+    VkExtent2D fullExtent = pRenderGraph->getExtent(depthImage);
+    pyramidUvScale[0] = uvScale[0];
+    pyramidUvScale[1] = uvScale[1];
+    uvScale[0] = static_cast<float>(renderExtent.width) / fullExtent.width;
+    uvScale[1] = static_cast<float>(renderExtent.height) / fullExtent.height;
+}
+
+void occlusionCuller::recordCull(VkCommandBuffer commandBuffer, uint32_t phase, const float* viewProjection){
+    uint32_t objectCount = pScene->getEntityCount();
+    
+    if (phase == 0){
+        // The last frame's draws and late phase are still reading these when this frame starts
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        vkCmdUpdateBuffer(commandBuffer, drawBuffer.buffer, 0, sizeof(emptyDraws), emptyDraws);
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+    
+    cullConstants constants{};
+    std::copy(viewProjection, viewProjection + 16, constants.viewProjection);
+    // The early phase reads the pyramid the last frame built, at the scale it was drawn at
+    constants.uvScale[0] = phase == 0 ? pyramidUvScale[0] : uvScale[0];
+    constants.uvScale[1] = phase == 0 ? pyramidUvScale[1] : uvScale[1];
+    constants.objectCount = objectCount;
+    constants.phase = phase;
+    constants.occlusionEnabled = pSettings->occlusionCulling ? 1 : 0;
+    constants.lateOffset = capacity;
+    
+    VkDescriptorSet sets[2] = {pScene->getDescriptorSet(), descriptorSet};
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 2, sets, 0, nullptr);
+    commands::pushConstants(commandBuffer, cullLayout, cullRange, constants);
+    vkCmdDispatch(commandBuffer, (objectCount + cullWorkgroup - 1) / cullWorkgroup, 1, 1);
+    
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+    
+    if (phase == 1){
+        // Both counts are final now, they go out for the summary once the frame is done
+        VkBufferCopy regions[2] = {
+            {offsetof(VkDrawIndirectCommand, instanceCount), 0, sizeof(uint32_t)},
+            {sizeof(VkDrawIndirectCommand) + offsetof(VkDrawIndirectCommand, instanceCount), sizeof(uint32_t), sizeof(uint32_t)}
+        };
+        vkCmdCopyBuffer(commandBuffer, drawBuffer.buffer, readbackBuffers[currentFrame].buffer, 2, regions);
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    }
+}
+
+void occlusionCuller::recordPyramid(VkCommandBuffer commandBuffer, uint32_t imageIndex){
+    if (!pSettings->occlusionCulling){
+        return;
+    }
+    
+    // The early phase was reading the old pyramid a moment ago
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipeline);
+    
+    // Each level is the farthest depth of the texels under it in the level before, starting from the depth image itself
+    VkExtent2D source = pRenderGraph->getExtent(depthImage);
+    for (uint32_t level = 0; level < pyramidLevels; level++){
+        VkExtent2D destination = {std::max(pyramidExtent.width >> level, 1u), std::max(pyramidExtent.height >> level, 1u)};
+        VkDescriptorSet set = level == 0 ? depthSets[imageIndex] : levelSets[level - 1];
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidLayout, 0, 1, &set, 0, nullptr);
+        
+        pyramidConstants constants{};
+        constants.sourceSize[0] = static_cast<int32_t>(source.width);
+        constants.sourceSize[1] = static_cast<int32_t>(source.height);
+        constants.destinationSize[0] = static_cast<int32_t>(destination.width);
+        constants.destinationSize[1] = static_cast<int32_t>(destination.height);
+        commands::pushConstants(commandBuffer, pyramidLayout, pyramidRange, constants);
+        vkCmdDispatch(commandBuffer, (destination.width + pyramidWorkgroup - 1) / pyramidWorkgroup, (destination.height + pyramidWorkgroup - 1) / pyramidWorkgroup, 1);
+        
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        source = destination;
+    }
+}
+
+void occlusionCuller::recordDraw(VkCommandBuffer commandBuffer, uint32_t phase){
+    vkCmdDrawIndirect(commandBuffer, drawBuffer.buffer, phase * sizeof(VkDrawIndirectCommand), 1, sizeof(VkDrawIndirectCommand));
+}
+
+uint32_t occlusionCuller::getFirstVisible(uint32_t phase){
+    return phase * capacity;
+}
+
+void occlusionCuller::printSummary(){
+    if (framesCounted == 0){
+        return;
+    }
+    double objects = static_cast<double>(objectsSubmitted) / framesCounted;
+    double early = static_cast<double>(earlyDraws) / framesCounted;
+    double late = static_cast<double>(lateDraws) / framesCounted;
+    std::cout << "Culling: " << objects << " objects a frame before culling, " << early + late << " drawn after (" << early << " early, " << late << " late), " << (objects > 0.0 ? 100.0 * (1.0 - (early + late) / objects) : 0.0) << "% culled" << (pSettings->occlusionCulling ? "" : ", occlusion off") << std::endl;
+}
+
+void occlusionCuller::destroyOcclusionCuller(){
+    // The pipelines go with the pipeline manager
+    destroyResources();
+    destroyBuffers();
+    for (auto& readback : readbackBuffers){
+        vkUnmapMemory(pDevices->device, readback.memory);
+        destroyBuffer(readback);
+    }
+    readbackBuffers.clear();
+    vkDestroyPipelineLayout(pDevices->device, cullLayout, nullptr);
+    vkDestroyPipelineLayout(pDevices->device, pyramidLayout, nullptr);
+    vkDestroyDescriptorPool(pDevices->device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(pDevices->device, descriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(pDevices->device, pyramidSetLayout, nullptr);
+    vkDestroySampler(pDevices->device, sampler, nullptr);
+}
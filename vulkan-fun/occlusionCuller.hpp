@@ -0,0 +1,132 @@
+#ifndef occlusionCuller_hpp
+#define occlusionCuller_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "devices.hpp"
+#include "renderGraph.hpp"
+#include "pipelineManager.hpp"
+#include "settings.hpp"
+#include "scene.hpp"
+#include "commands.hpp"
+
+// Lines up with the push_constant block in cullobjects.comp
+struct cullConstants {
+    // Column major, the same transform the main pass pushes
+    float viewProjection[16];
+    // How much of the depth image the scene actually drew into, under 1 with dynamic resolution
+    float uvScale[2];
+    uint32_t objectCount;
+    uint32_t phase;
+    uint32_t occlusionEnabled;
+    // Where the second phase's visible ids start
+    uint32_t lateOffset;
+};
+
+// Lines up with the push_constant block in hizbuild.comp
+struct pyramidConstants {
+    int32_t sourceSize[2];
+    int32_t destinationSize[2];
+};
+
+// Two phase occlusion culling on the gpu, nothing about visibility ever comes back to the cpu except the counts for the summary
+// The early phase tests every object against the depth pyramid left by the last frame and draws what passes, then the pyramid gets rebuilt from that depth
+// The late phase tests only what the early phase called hidden against the new pyramid and draws whatever turned out to be visible after all, so nothing pops in a frame late
+// Both phases append to one indirect buffer, one draw each, instanced over a list of visible object ids
+class occlusionCuller{
+public:
+    // Only touches the disk, so it can run before there's a device
+    void loadShaders(pipelineManager* initPipelineManager);
+    // The draw set layout has to exist before the main pipeline gets made, so this makes it straight away
+    void initOcclusionCuller(devices* initDevices, renderGraph* initRenderGraph, scene* initScene, settings* initSettings, uint32_t initFramesInFlight);
+    // The first format out of these that can be drawn to and sampled, every device has one of them
+    static VkFormat findDepthFormat(VkPhysicalDevice physicalDevice);
+    void createPipelines();
+    // The pyramid is sized off the depth image, so these get remade every time the graph is compiled
+    void createResources(uint32_t initDepthImage, uint32_t imageCount);
+    void destroyResources();
+    // Once a frame once the frame's fence has been waited on, collects the counts that frame left behind and makes sure there's room for every object
+    // The render extent is how much of the depth image this frame draws into
+    void beginFrame(uint32_t frame, VkExtent2D renderExtent);
+    // Compute, on the graphics queue ahead of the phase's draw
+    void recordCull(VkCommandBuffer commandBuffer, uint32_t phase, const float* viewProjection);
+    // Compute, the depth image has to be in shader read layout
+    void recordPyramid(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    // Inside the phase's pass with the main pipeline bound, the vertex shader takes its ids from firstVisible on
+    void recordDraw(VkCommandBuffer commandBuffer, uint32_t phase);
+    uint32_t getFirstVisible(uint32_t phase);
+    void printSummary();
+    void destroyOcclusionCuller();
+    
+    // Set 1 of the main pipeline and the cull pipeline
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorSet descriptorSet;
+private:
+    struct buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+    
+    devices* pDevices;
+    renderGraph* pRenderGraph;
+    pipelineManager* pPipelineManager;
+    scene* pScene;
+    settings* pSettings;
+    uint32_t framesInFlight;
+    uint32_t currentFrame = 0;
+    
+    VkPipelineLayout cullLayout;
+    pushConstantRange<cullConstants> cullRange;
+    VkPipeline cullPipeline;
+    VkDescriptorSetLayout pyramidSetLayout;
+    VkPipelineLayout pyramidLayout;
+    pushConstantRange<pyramidConstants> pyramidRange;
+    VkPipeline pyramidPipeline;
+    VkSampler sampler;
+    VkDescriptorPool descriptorPool;
+    
+    // Both phases' draws, visible ids for the early phase then the late one, and a flag per object the early phase leaves for the late one
+    // Only ever touched by the gpu, one of each does since every frame's commands run one after the other on the graphics queue
+    buffer drawBuffer;
+    buffer visibleBuffer;
+    buffer occludedBuffer;
+    uint32_t capacity = 0;
+    // The draw counts get copied here at the end of each frame's culling, read once the frame's fence says they're there
+    std::vector<buffer> readbackBuffers;
+    std::vector<uint32_t*> readbackCounts;
+    std::vector<uint32_t> submittedObjects;
+    
+    // Every level stays in general layout so it can be written by one dispatch and read by the next without a transition
+    VkImage pyramid = VK_NULL_HANDLE;
+    VkDeviceMemory pyramidMemory = VK_NULL_HANDLE;
+    VkImageView pyramidView = VK_NULL_HANDLE;
+    std::vector<VkImageView> levelViews;
+    VkExtent2D pyramidExtent;
+    uint32_t pyramidLevels = 0;
+    uint32_t depthImage;
+    VkDescriptorPool pyramidPool = VK_NULL_HANDLE;
+    // One per swapchain image for the first level since that reads the graph's depth image, then one per level after
+    std::vector<VkDescriptorSet> depthSets;
+    std::vector<VkDescriptorSet> levelSets;
+    // Both picked by beginFrame, the early phase reads the pyramid the last frame built at whatever scale that frame drew at, the late phase reads this frame's
+    float pyramidUvScale[2] = {1.0f, 1.0f};
+    float uvScale[2] = {1.0f, 1.0f};
+    
+    // For the summary
+    uint64_t framesCounted = 0;
+    uint64_t objectsSubmitted = 0;
+    uint64_t earlyDraws = 0;
+    uint64_t lateDraws = 0;
+    
+    void createBuffers(uint32_t newCapacity);
+    void destroyBuffers();
+    buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, memoryCategory category);
+    void destroyBuffer(buffer& target);
+    void writeDescriptorSet();
+};
+
+#endif /* occlusionCuller_hpp */
@@ -0,0 +1,290 @@
+#include "particleSystem.hpp"
+
+namespace {
+    // The fountain, in the same space as the scene, it sprays up from the bottom of the screen in front of everything
+    const float particleLifetime = 3.0f;
+    const float particleSize = 0.006f;
+    
+    void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess){
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+static_assert(sizeof(particleData) == 32, "particleData has to match the shaders' particle struct");
+
+void particleSystem::loadShaders(pipelineManager* initPipelineManager){
+    pPipelineManager = initPipelineManager;
+    pPipelineManager->loadShader("particlesim.spv");
+    pPipelineManager->loadShader("particleemit.spv");
+    pPipelineManager->loadShader("particleprefix.spv");
+    pPipelineManager->loadShader("particlescatter.spv");
+}
+
+void particleSystem::initParticleSystem(devices* initDevices, settings* initSettings, uint32_t initMaxFramesInFlight){
+    pDevices = initDevices;
+    pSettings = initSettings;
+    maxFramesInFlight = initMaxFramesInFlight;
+    capacity = std::max(pSettings->particles, 1u);
+    start = std::chrono::steady_clock::now();
+    lastUpdate = start;
+    static_assert(sizeof(stateHeader) == 48, "stateHeader has to match the shaders' state buffer");
+    static_assert(sizeof(scratchHeader) == 32, "scratchHeader has to match the shaders' scratch buffer");
+    
+    // Only binding 1 gets drawn from, it's the state the set's compute wrote
+    VkDescriptorSetLayoutBinding bindings[4]{};
+    for (uint32_t i = 0; i < 4; i++){
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | (i == 1 ? VK_SHADER_STAGE_VERTEX_BIT : 0);
+    }
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = bindings;
+    
+    if (vkCreateDescriptorSetLayout(pDevices->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create particle descriptor set layout!");
+    }
+    
+    // The compute half can run on its own queue and the draw reads what it wrote, so both families get to share the buffers
+    std::vector<uint32_t> families = {pDevices->graphicsQueueFamily};
+    if (!pDevices->computeAliasesGraphics && pDevices->computeQueueFamily != pDevices->graphicsQueueFamily){
+        families.push_back(pDevices->computeQueueFamily);
+    }
+    
+    uint32_t stateCount = maxFramesInFlight + 1;
+    VkDeviceSize particleBytes = static_cast<VkDeviceSize>(capacity) * sizeof(particleData);
+    stateBuffers.resize(stateCount);
+    for (buffer& state : stateBuffers){
+        state = createBuffer(sizeof(stateHeader) + particleBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, families);
+    }
+    scratchBuffer = createBuffer(sizeof(scratchHeader) + particleBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, families);
+    bucketBuffer = createBuffer(bucketCount * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, families);
+    
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = stateCount * 4;
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = stateCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    
+    if (vkCreateDescriptorPool(pDevices->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create particle descriptor pool!");
+    }
+    
+    std::vector<VkDescriptorSetLayout> layouts(stateCount, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = stateCount;
+    allocInfo.pSetLayouts = layouts.data();
+    
+    descriptorSets.resize(stateCount);
+    if (vkAllocateDescriptorSets(pDevices->device, &allocInfo, descriptorSets.data()) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate particle descriptor sets!");
+    }
+    
+    for (uint32_t i = 0; i < stateCount; i++){
+        VkDescriptorBufferInfo bufferInfos[4] = {
+            {stateBuffers[(i + stateCount - 1) % stateCount].buffer, 0, VK_WHOLE_SIZE},
+            {stateBuffers[i].buffer, 0, VK_WHOLE_SIZE},
+            {scratchBuffer.buffer, 0, VK_WHOLE_SIZE},
+            {bucketBuffer.buffer, 0, VK_WHOLE_SIZE}
+        };
+        VkWriteDescriptorSet writes[4]{};
+        for (uint32_t binding = 0; binding < 4; binding++){
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = descriptorSets[i];
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[binding].pBufferInfo = &bufferInfos[binding];
+        }
+        vkUpdateDescriptorSets(pDevices->device, 4, writes, 0, nullptr);
+    }
+    
+    emitter.spread = 0.03f;
+    emitter.velocity[1] = -1.6f;
+    emitter.velocityJitter = 0.3f;
+    emitter.gravity[1] = 1.2f;
+    emitter.lifetime = particleLifetime;
+    emitter.capacity = capacity;
+}
+
+particleSystem::buffer particleSystem::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, const std::vector<uint32_t>& families){
+    buffer result;
+    
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    if (families.size() > 1){
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        bufferInfo.pQueueFamilyIndices = families.data();
+    } else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    
+    if (vkCreateBuffer(pDevices->device, &bufferInfo, nullptr, &result.buffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create particle buffer!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(pDevices->device, result.buffer, &memoryRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::buffers, &result.memory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate particle memory!");
+    }
+    vkBindBufferMemory(pDevices->device, result.buffer, result.memory, 0);
+    return result;
+}
+
+void particleSystem::destroyBuffer(buffer& target){
+    vkDestroyBuffer(pDevices->device, target.buffer, nullptr);
+    pDevices->memoryBudget.free(target.memory);
+    target.buffer = VK_NULL_HANDLE;
+    target.memory = VK_NULL_HANDLE;
+}
+
+void particleSystem::createPipelines(){
+    // Every pass gets the same emitter block and set, so they're bound once and stay through all four
+    pushConstantLayout pushConstants;
+    emitterRange = pushConstants.addRange<emitterConstants>(VK_SHADER_STAGE_COMPUTE_BIT);
+    pushConstants.checkLimits(pDevices->physicalDevice);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pushConstants.fillLayoutInfo(pipelineLayoutInfo);
+    
+    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &computeLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create particle pipeline layout!");
+    }
+    
+    shaderVariant simulateVariant{VK_SHADER_STAGE_COMPUTE_BIT, "particlesim.spv", {}};
+    shaderVariant emitVariant{VK_SHADER_STAGE_COMPUTE_BIT, "particleemit.spv", {}};
+    shaderVariant prefixVariant{VK_SHADER_STAGE_COMPUTE_BIT, "particleprefix.spv", {}};
+    shaderVariant scatterVariant{VK_SHADER_STAGE_COMPUTE_BIT, "particlescatter.spv", {}};
+    simulateVariant.constants.set(0, bucketCount);
+    emitVariant.constants.set(0, bucketCount);
+    prefixVariant.constants.set(0, bucketCount);
+    scatterVariant.constants.set(0, bucketCount);
+    simulatePipeline = pPipelineManager->getComputePipeline(simulateVariant, computeLayout, pipelineLayoutInfo);
+    emitPipeline = pPipelineManager->getComputePipeline(emitVariant, computeLayout, pipelineLayoutInfo);
+    prefixPipeline = pPipelineManager->getComputePipeline(prefixVariant, computeLayout, pipelineLayoutInfo);
+    scatterPipeline = pPipelineManager->getComputePipeline(scatterVariant, computeLayout, pipelineLayoutInfo);
+}
+
+void particleSystem::update(){
+    // Frame n writes state n and draws state n - maxFramesInFlight, the fence this frame waited on covers that one's compute
+    uint32_t stateCount = static_cast<uint32_t>(stateBuffers.size());
+    currentSlot = static_cast<uint32_t>(frameCount % stateCount);
+    drawSlot = (currentSlot + 1) % stateCount;
+    drawReady = frameCount >= maxFramesInFlight;
+    
+    // Long hitches get clamped so the fountain doesn't jump, and enough get emitted that the average one living out its life keeps it full
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<float> delta = now - lastUpdate;
+    std::chrono::duration<float> elapsed = now - start;
+    lastUpdate = now;
+    float deltaTime = std::min(delta.count(), 0.1f);
+    float rate = capacity / (0.75f * particleLifetime);
+    emitRemainder += rate * deltaTime;
+    uint32_t emitCount = std::min(static_cast<uint32_t>(emitRemainder), capacity);
+    emitRemainder = std::min(emitRemainder - emitCount, 1.0f);
+    emitted += emitCount;
+    
+    emitter.position[0] = 0.6f * std::sin(elapsed.count() * 0.5f);
+    emitter.position[1] = 0.9f;
+    emitter.position[2] = 0.05f;
+    emitter.deltaTime = deltaTime;
+    emitter.emitCount = emitCount;
+    emitter.seed = static_cast<uint32_t>(frameCount) * 2654435761u + 1u;
+    frameCount++;
+}
+
+void particleSystem::recordSimulation(VkCommandBuffer commandBuffer){
+    uint32_t stateCount = static_cast<uint32_t>(stateBuffers.size());
+    uint32_t readSlot = (currentSlot + stateCount - 1) % stateCount;
+    
+    // The last frame's scatter has to be done with the scratch list and its state written before anything here touches them
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    if (frameCount == 1){
+        // Nothing has been simulated yet, an empty state makes the first dispatch do nothing
+        vkCmdFillBuffer(commandBuffer, stateBuffers[readSlot].buffer, 0, sizeof(stateHeader), 0);
+    }
+    vkCmdFillBuffer(commandBuffer, scratchBuffer.buffer, 0, sizeof(scratchHeader), 0);
+    vkCmdFillBuffer(commandBuffer, bucketBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeLayout, 0, 1, &descriptorSets[currentSlot], 0, nullptr);
+    commands::pushConstants(commandBuffer, computeLayout, emitterRange, emitter);
+    
+    // Simulating and emitting only meet at the atomics, so they run back to back without a barrier
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulatePipeline);
+    vkCmdDispatchIndirect(commandBuffer, stateBuffers[readSlot].buffer, offsetof(stateHeader, simulate));
+    if (emitter.emitCount > 0){
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, emitPipeline);
+        vkCmdDispatch(commandBuffer, (emitter.emitCount + workgroupSize - 1) / workgroupSize, 1, 1);
+    }
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, prefixPipeline);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scatterPipeline);
+    vkCmdDispatchIndirect(commandBuffer, scratchBuffer.buffer, offsetof(scratchHeader, scatter));
+}
+
+void particleSystem::recordDraw(VkCommandBuffer commandBuffer, graphicsPipeline* pipeline, const float* viewProjection){
+    if (!drawReady){
+        return;
+    }
+    
+    // The viewport and scissor are still the scene's from the draw before
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->particlePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->particleLayout.get(), 0, 1, &descriptorSets[drawSlot], 0, nullptr);
+    
+    particleDrawConstants draw{};
+    std::copy(viewProjection, viewProjection + 16, draw.viewProjection);
+    draw.size = particleSize;
+    commands::pushConstants(commandBuffer, pipeline->particleLayout.get(), pipeline->particleRange, draw);
+    vkCmdDrawIndirect(commandBuffer, stateBuffers[drawSlot].buffer, offsetof(stateHeader, draw), 1, 0);
+}
+
+void particleSystem::printSummary(){
+    std::chrono::duration<double> elapsed = lastUpdate - start;
+    if (frameCount == 0 || elapsed.count() <= 0.0){
+        return;
+    }
+    std::cout << "Particles: up to " << capacity << " alive, " << emitted << " emitted over " << frameCount << " frames (" << emitted / elapsed.count() << " a second), " << stateBuffers.size() << " state buffers" << std::endl;
+}
+
+void particleSystem::destroyParticleSystem(){
+    for (buffer& state : stateBuffers){
+        destroyBuffer(state);
+    }
+    stateBuffers.clear();
+    destroyBuffer(scratchBuffer);
+    destroyBuffer(bucketBuffer);
+    vkDestroyDescriptorPool(pDevices->device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(pDevices->device, descriptorSetLayout, nullptr);
+    vkDestroyPipelineLayout(pDevices->device, computeLayout, nullptr);
+}
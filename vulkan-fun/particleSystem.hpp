@@ -0,0 +1,132 @@
+#ifndef particleSystem_hpp
+#define particleSystem_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <cstddef>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "devices.hpp"
+#include "pipelineManager.hpp"
+#include "settings.hpp"
+#include "commands.hpp"
+#include "graphicsPipeline.hpp"
+
+// Lines up with the particle struct in the particle shaders
+struct particleData {
+    // Seconds left to live in w
+    float position[3];
+    float life;
+    // How long it lived in total in w, for fading out
+    float velocity[3];
+    float lifetime;
+};
+
+// Lines up with the push_constant block in every particle compute shader, it's everything the cpu hands over each frame
+struct emitterConstants {
+    float position[3];
+    // Radius of the disc new particles start in
+    float spread;
+    float velocity[3];
+    // Up to this much gets added to or taken off every axis of a new particle's velocity
+    float velocityJitter;
+    float gravity[3];
+    float lifetime;
+    float deltaTime;
+    uint32_t emitCount;
+    uint32_t seed;
+    uint32_t capacity;
+};
+
+// A fountain of up to millions of particles the cpu never touches
+// Every frame compute shaders age and move what's alive, append what the emitter adds, then sort everything back to front into the next state buffer
+// The sort is a counting sort on depth buckets, and every count in between lives on the gpu so the dispatches and the draw are all indirect
+// Each frame's state buffer is drawn framesInFlight frames later, by then the fence that frame waits on covers the compute that wrote it on whichever queue it ran
+class particleSystem{
+public:
+    static constexpr uint32_t workgroupSize = 64;
+    // Depth buckets the sort uses, the prefix pass does them in one workgroup of 256 threads
+    static constexpr uint32_t bucketCount = 1024;
+    
+    // Only touches the disk, so it can run before there's a device
+    void loadShaders(pipelineManager* initPipelineManager);
+    // The set layout has to exist before the draw pipeline gets made, so this makes it straight away
+    void initParticleSystem(devices* initDevices, settings* initSettings, uint32_t initMaxFramesInFlight);
+    void createPipelines();
+    // Once a frame before recording, moves the emitter and picks which state buffers this frame reads, writes and draws
+    void update();
+    // Compute only, can go on the async compute queue at the end of the frame
+    void recordSimulation(VkCommandBuffer commandBuffer);
+    // Inside a pass drawing into the scene's color and depth, after everything solid
+    void recordDraw(VkCommandBuffer commandBuffer, graphicsPipeline* pipeline, const float* viewProjection);
+    void printSummary();
+    void destroyParticleSystem();
+    
+    VkDescriptorSetLayout descriptorSetLayout;
+private:
+    struct buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+    
+    // Lines up with the header in front of the particles in each state buffer
+    struct stateHeader {
+        uint32_t count;
+        uint32_t padding[3];
+        VkDispatchIndirectCommand simulate;
+        uint32_t padding2;
+        VkDrawIndirectCommand draw;
+    };
+    
+    // Lines up with the header in front of the particles in the scratch buffer
+    struct scratchHeader {
+        uint32_t count;
+        uint32_t padding[3];
+        VkDispatchIndirectCommand scatter;
+        uint32_t padding2;
+    };
+    
+    devices* pDevices;
+    pipelineManager* pPipelineManager;
+    settings* pSettings;
+    uint32_t capacity;
+    
+    // One more than can be in flight, so the one being drawn, the one being read and the one being written are never the same
+    std::vector<buffer> stateBuffers;
+    // Only the compute shaders touch these, and only one frame's compute runs at a time
+    buffer scratchBuffer;
+    buffer bucketBuffer;
+    VkDescriptorPool descriptorPool;
+    // Set i reads state i - 1 and writes state i
+    std::vector<VkDescriptorSet> descriptorSets;
+    
+    VkPipelineLayout computeLayout;
+    pushConstantRange<emitterConstants> emitterRange;
+    VkPipeline simulatePipeline;
+    VkPipeline emitPipeline;
+    VkPipeline prefixPipeline;
+    VkPipeline scatterPipeline;
+    
+    uint64_t frameCount = 0;
+    uint32_t maxFramesInFlight;
+    // Picked by update, the state this frame's compute writes and the one its draw reads
+    uint32_t currentSlot = 0;
+    uint32_t drawSlot = 0;
+    // Nothing has been written to draw until the first frame's compute has gone around
+    bool drawReady = false;
+    emitterConstants emitter{};
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point lastUpdate;
+    // Fractions of a particle carried over so a low rate still emits on average
+    float emitRemainder = 0.0f;
+    uint64_t emitted = 0;
+    
+    buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, const std::vector<uint32_t>& families);
+    void destroyBuffer(buffer& target);
+};
+
+#endif /* particleSystem_hpp */
@@ -0,0 +1,262 @@
+#include "pipelineManager.hpp"
+
+namespace {
+    const char* pipelineCacheFile = "pipelinecache.bin";
+}
+
+specializationConstants& specializationConstants::set(uint32_t id, uint32_t value){
+    setBits(id, value);
+    return *this;
+}
+
+specializationConstants& specializationConstants::set(uint32_t id, int32_t value){
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    setBits(id, bits);
+    return *this;
+}
+
+specializationConstants& specializationConstants::set(uint32_t id, float value){
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    setBits(id, bits);
+    return *this;
+}
+
+specializationConstants& specializationConstants::set(uint32_t id, bool value){
+    setBits(id, value ? VK_TRUE : VK_FALSE);
+    return *this;
+}
+
+void specializationConstants::setBits(uint32_t id, uint32_t bits){
+    // Every type here is 32 bits, so each constant is one slot of data and setting an id twice just overwrites it
+    auto entry = std::lower_bound(entries.begin(), entries.end(), id, [](const VkSpecializationMapEntry& existing, uint32_t value){
+        return existing.constantID < value;
+    });
+    size_t index = entry - entries.begin();
+
+    if (entry != entries.end() && entry->constantID == id){
+        data[index] = bits;
+        return;
+    }
+
+    entries.insert(entry, {id, 0, sizeof(uint32_t)});
+    data.insert(data.begin() + index, bits);
+    for (size_t i = 0; i < entries.size(); i++){
+        entries[i].offset = static_cast<uint32_t>(i * sizeof(uint32_t));
+    }
+}
+
+const VkSpecializationInfo* specializationConstants::getInfo(){
+    if (entries.empty()){
+        return nullptr;
+    }
+    info.mapEntryCount = static_cast<uint32_t>(entries.size());
+    info.pMapEntries = entries.data();
+    info.dataSize = data.size() * sizeof(uint32_t);
+    info.pData = data.data();
+    return &info;
+}
+
+std::string specializationConstants::getKey() const{
+    // The raw bits go in the key, so 0.0 and -0.0 count as different variants the same way the driver sees them
+    std::string key;
+    for (size_t i = 0; i < entries.size(); i++){
+        key += std::to_string(entries[i].constantID) + "=" + std::to_string(data[i]) + ",";
+    }
+    return key;
+}
+
+void pipelineManager::loadShader(const std::string& shader){
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (shaderCode.count(shader) != 0){
+            return;
+        }
+    }
+
+    std::vector<char> code = file.readFile(shader);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    shaderCode.emplace(shader, std::move(code));
+}
+
+void pipelineManager::initPipelineManager(devices* initDevices){
+    pDevices = initDevices;
+    loadPipelineCache();
+}
+
+void pipelineManager::loadPipelineCache(){
+    // The driver checks the header too but a cache from another gpu or driver is thrown out here first so it never gets the chance to choke on it
+    std::vector<char> initialData;
+    if (file.exists(pipelineCacheFile)){
+        initialData = file.readFile(pipelineCacheFile);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(pDevices->physicalDevice, &properties);
+
+        // Header is length, version, vendor id, device id and then the cache uuid
+        uint32_t header[4] = {};
+        bool matches = initialData.size() >= sizeof(header) + VK_UUID_SIZE;
+        if (matches){
+            std::memcpy(header, initialData.data(), sizeof(header));
+            matches = header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header[2] == properties.vendorID && header[3] == properties.deviceID && std::memcmp(initialData.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+        if (!matches){
+            std::cout << "Pipeline cache on disk is from a different device or driver, starting over" << std::endl;
+            initialData.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = initialData.size();
+    cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    if (vkCreatePipelineCache(pDevices->device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pipeline cache!");
+    }
+}
+
+void pipelineManager::savePipelineCache(){
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(pDevices->device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0){
+        return;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(pDevices->device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS){
+        return;
+    }
+    data.resize(dataSize);
+    file.writeFile(pipelineCacheFile, data);
+}
+
+VkShaderModule pipelineManager::getShaderModule(const std::string& shader){
+    // One module per spirv file, every variant of it gets specialized from the same one
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto existing = shaderModules.find(shader);
+        if (existing != shaderModules.end()){
+            return existing->second;
+        }
+    }
+
+    loadShader(shader);
+    const std::vector<char>* code;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        code = &shaderCode.at(shader);
+    }
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code->size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code->data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(pDevices->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create shader module!");
+    }
+
+    // Another job might have made the same one while this one was, keep theirs
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto inserted = shaderModules.emplace(shader, shaderModule);
+    if (!inserted.second){
+        vkDestroyShaderModule(pDevices->device, shaderModule, nullptr);
+    }
+    return inserted.first->second;
+}
+
+bool pipelineManager::findPipeline(const std::string& key, VkPipeline& pipeline){
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    requests++;
+    auto existing = pipelines.find(key);
+    if (existing == pipelines.end()){
+        return false;
+    }
+    reused++;
+    pipeline = existing->second;
+    return true;
+}
+
+VkPipeline pipelineManager::storePipeline(const std::string& key, VkPipeline pipeline){
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto inserted = pipelines.emplace(key, pipeline);
+    if (!inserted.second){
+        vkDestroyPipeline(pDevices->device, pipeline, nullptr);
+    }
+    return inserted.first->second;
+}
+
+std::vector<VkPipelineShaderStageCreateInfo> pipelineManager::getStageInfos(std::vector<shaderVariant>& variants){
+    std::vector<VkPipelineShaderStageCreateInfo> stages(variants.size());
+    for (size_t i = 0; i < variants.size(); i++){
+        stages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[i].stage = variants[i].stage;
+        stages[i].module = getShaderModule(variants[i].shader);
+        stages[i].pName = "main";
+        stages[i].pSpecializationInfo = variants[i].constants.getInfo();
+    }
+    return stages;
+}
+
+VkPipeline pipelineManager::getComputePipeline(shaderVariant variant, VkPipelineLayout layout, const VkPipelineLayoutCreateInfo& layoutInfo){
+    std::string key = "compute:" + getLayoutKey(layoutInfo) + ":" + variant.shader + ":" + variant.constants.getKey();
+    VkPipeline pipeline;
+    if (findPipeline(key, pipeline)){
+        return pipeline;
+    }
+
+    std::vector<shaderVariant> variants = {variant};
+    std::vector<VkPipelineShaderStageCreateInfo> stages = getStageInfos(variants);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = stages[0];
+    pipelineInfo.layout = layout;
+
+    if (vkCreateComputePipelines(pDevices->device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create compute pipeline!");
+    }
+    return storePipeline(key, pipeline);
+}
+
+VkPipeline pipelineManager::getGraphicsPipeline(std::vector<shaderVariant> variants, const std::string& stateKey, const std::function<VkPipeline(const std::vector<VkPipelineShaderStageCreateInfo>&, VkPipelineCache)>& create){
+    std::string key = "graphics:" + stateKey;
+    for (const auto& variant : variants){
+        key += ":" + variant.shader + ":" + variant.constants.getKey();
+    }
+    VkPipeline pipeline;
+    if (findPipeline(key, pipeline)){
+        return pipeline;
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> stages = getStageInfos(variants);
+    return storePipeline(key, create(stages, pipelineCache));
+}
+
+std::string pipelineManager::getLayoutKey(const VkPipelineLayoutCreateInfo& layoutInfo){
+    // The set layouts only go in by count, each one is made once at startup to match what the shaders using it declare, so the shaders in the key already pin them down
+    std::string key = std::to_string(layoutInfo.setLayoutCount) + " sets";
+    for (uint32_t i = 0; i < layoutInfo.pushConstantRangeCount; i++){
+        const VkPushConstantRange& range = layoutInfo.pPushConstantRanges[i];
+        key += "," + std::to_string(range.stageFlags) + "@" + std::to_string(range.offset) + "+" + std::to_string(range.size);
+    }
+    return key;
+}
+
+void pipelineManager::destroyPipelineManager(){
+    std::cout << "Pipeline variants: " << pipelines.size() << " built from " << shaderModules.size() << " shader modules, " << reused << " of " << requests << " requests reused one" << std::endl;
+    savePipelineCache();
+
+    for (auto& pipeline : pipelines){
+        vkDestroyPipeline(pDevices->device, pipeline.second, nullptr);
+    }
+    for (auto& shaderModule : shaderModules){
+        vkDestroyShaderModule(pDevices->device, shaderModule.second, nullptr);
+    }
+    vkDestroyPipelineCache(pDevices->device, pipelineCache, nullptr);
+    pipelines.clear();
+    shaderModules.clear();
+}
@@ -0,0 +1,81 @@
+#ifndef pipelineManager_hpp
+#define pipelineManager_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "file.hpp"
+#include "devices.hpp"
+
+// Typed values for a shader's constant_id slots, kept sorted by id so the same values set in any order come out as the same variant
+class specializationConstants {
+public:
+    specializationConstants& set(uint32_t id, uint32_t value);
+    specializationConstants& set(uint32_t id, int32_t value);
+    specializationConstants& set(uint32_t id, float value);
+    // Booleans are 32 bits wide on the vulkan side
+    specializationConstants& set(uint32_t id, bool value);
+
+    // Points into this object, so it has to stay alive until the pipeline is created
+    const VkSpecializationInfo* getInfo();
+    std::string getKey() const;
+private:
+    void setBits(uint32_t id, uint32_t bits);
+
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t> data;
+    VkSpecializationInfo info;
+};
+
+// One stage of a pipeline, which spirv file it comes from and what it gets specialized with
+struct shaderVariant {
+    VkShaderStageFlagBits stage;
+    std::string shader;
+    specializationConstants constants;
+};
+
+// Builds pipelines out of shader variants, each spirv file becomes one shader module no matter how many variants use it
+// Asking for a variant that already exists hands back the same pipeline, and everything goes through a VkPipelineCache that's kept on disk between runs
+class pipelineManager{
+public:
+    // Only reads the spirv, no device needed, so loading can start before there is one
+    void loadShader(const std::string& shader);
+    void initPipelineManager(devices* initDevices);
+    // The layout goes in the key by what it was created from, so layoutInfo has to be what made it
+    VkPipeline getComputePipeline(shaderVariant variant, VkPipelineLayout layout, const VkPipelineLayoutCreateInfo& layoutInfo);
+    // The fixed function state and render target are up to the caller, stateKey has to be different for anything create would build differently
+    // It should describe that state rather than name handles, a destroyed handle's value can come back for something else entirely
+    VkPipeline getGraphicsPipeline(std::vector<shaderVariant> variants, const std::string& stateKey, const std::function<VkPipeline(const std::vector<VkPipelineShaderStageCreateInfo>&, VkPipelineCache)>& create);
+    void destroyPipelineManager();
+    
+    static std::string getLayoutKey(const VkPipelineLayoutCreateInfo& layoutInfo);
+private:
+    devices* pDevices;
+    File file;
+
+    // Pipelines get built from several init jobs at once, the lock is only held for lookups so compiles still overlap
+    std::mutex cacheMutex;
+    std::unordered_map<std::string, std::vector<char>> shaderCode;
+    std::unordered_map<std::string, VkShaderModule> shaderModules;
+    std::unordered_map<std::string, VkPipeline> pipelines;
+    uint32_t requests = 0;
+    uint32_t reused = 0;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+    VkShaderModule getShaderModule(const std::string& shader);
+    bool findPipeline(const std::string& key, VkPipeline& pipeline);
+    VkPipeline storePipeline(const std::string& key, VkPipeline pipeline);
+    std::vector<VkPipelineShaderStageCreateInfo> getStageInfos(std::vector<shaderVariant>& variants);
+    void loadPipelineCache();
+    void savePipelineCache();
+};
+
+#endif /* pipelineManager_hpp */
@@ -0,0 +1,284 @@
+#include "postProcess.hpp"
+
+namespace {
+    const char* stageNames[postStageCount] = {"bloom prefilter", "bloom downsample", "bloom upsample", "tonemap", "sharpen"};
+    const char* stageShaders[postStageCount] = {"postbloomprefilter.spv", "postbloomdownsample.spv", "postbloomupsample.spv", "posttonemap.spv", "postsharpen.spv"};
+}
+
+void postProcess::loadShaders(pipelineManager* initPipelineManager){
+    pPipelineManager = initPipelineManager;
+    for (const char* shader : stageShaders){
+        pPipelineManager->loadShader(shader);
+    }
+}
+
+void postProcess::initPostProcess(devices* initDevices, swapchain* initSwapchain, renderGraph* initRenderGraph, settings* initSettings){
+    pDevices = initDevices;
+    pSwapchain = initSwapchain;
+    pRenderGraph = initRenderGraph;
+    pSettings = initSettings;
+
+    // rgba8 unorm is the only 8 bit layout a storage image can be, anything else gets written in its bit pattern and copied across
+    VkFormat format = pSwapchain->swapChainImageFormat;
+    writeSwapchain = format == VK_FORMAT_R8G8B8A8_UNORM && (pSwapchain->supportedUsage & VK_IMAGE_USAGE_STORAGE_BIT);
+
+    constants.bloomThreshold = 1.0f;
+    constants.bloomIntensity = 0.05f;
+    constants.sharpenAmount = 0.5f;
+    constants.swizzleOutput = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    constants.encodeSrgb = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+bool postProcess::isSupported(){
+    VkFormat format = pSwapchain->swapChainImageFormat;
+    bool eightBit = format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    return writeSwapchain || (eightBit && (pSwapchain->supportedUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+}
+
+void postProcess::declarePasses(uint32_t scene, uint32_t backbuffer){
+    // Bloom works at half and quarter resolution, the graph packs whichever of these don't overlap into the same memory
+    uint32_t bloomHalf = pRenderGraph->createScaledImage("bloom half", VK_FORMAT_R16G16B16A16_SFLOAT, 2);
+    uint32_t bloomQuarter = pRenderGraph->createScaledImage("bloom quarter", VK_FORMAT_R16G16B16A16_SFLOAT, 4);
+    uint32_t bloomBlur = pRenderGraph->createScaledImage("bloom blur", VK_FORMAT_R16G16B16A16_SFLOAT, 2);
+    uint32_t tonemapped = pRenderGraph->createImage("tonemapped", VK_FORMAT_R16G16B16A16_SFLOAT);
+    output = writeSwapchain ? backbuffer : pRenderGraph->createImage("post output", VK_FORMAT_R8G8B8A8_UNORM);
+
+    stages[postBloomPrefilter] = {0, scene, scene, bloomHalf};
+    stages[postBloomDownsample] = {0, bloomHalf, bloomHalf, bloomQuarter};
+    stages[postBloomUpsample] = {0, bloomQuarter, bloomHalf, bloomBlur};
+    stages[postTonemap] = {0, scene, bloomBlur, tonemapped};
+    stages[postSharpen] = {0, tonemapped, tonemapped, output};
+
+    // Each pass only reads what the one before it wrote, so the graph only puts a barrier where an image actually changes hands
+    for (int stage = 0; stage < postStageCount; stage++){
+        stageResources& resources = stages[stage];
+        resources.pass = pRenderGraph->addPass(stageNames[stage], passType::compute);
+        pRenderGraph->addTextureInput(resources.pass, resources.source);
+        if (resources.secondSource != resources.source){
+            pRenderGraph->addTextureInput(resources.pass, resources.secondSource);
+        }
+        pRenderGraph->addStorageOutput(resources.pass, resources.destination);
+        pRenderGraph->setAsyncCompute(resources.pass);
+        pRenderGraph->setRecordFunction(resources.pass, [this, stage](VkCommandBuffer commandBuffer, uint32_t imageIndex){
+            recordStage(commandBuffer, static_cast<postStage>(stage), imageIndex);
+        });
+    }
+
+    // Copies work on compute queues where blits don't, and a copy between two 32 bit formats keeps the bits the sharpen pass laid out
+    if (!writeSwapchain){
+        uint32_t copyPass = pRenderGraph->addPass("post copy", passType::transfer);
+        pRenderGraph->addTransferInput(copyPass, output);
+        pRenderGraph->addTransferOutput(copyPass, backbuffer);
+        pRenderGraph->setAsyncCompute(copyPass);
+        pRenderGraph->setRecordFunction(copyPass, [this, backbuffer](VkCommandBuffer commandBuffer, uint32_t imageIndex){
+            recordCopy(commandBuffer, imageIndex, backbuffer);
+        });
+    }
+}
+
+void postProcess::chooseWorkgroupSize(){
+    // Workgroups want to be a few subgroups big so a wave64 part isn't left half empty and a warp32 part has some to switch between
+    // The size goes in through specialization constants so one spirv file covers every device
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(pDevices->physicalDevice, &properties);
+    const VkPhysicalDeviceLimits& limits = properties.limits;
+
+    if (pSettings->postWorkgroupX != 0){
+        constants.workgroupX = pSettings->postWorkgroupX;
+        constants.workgroupY = pSettings->postWorkgroupY;
+    } else {
+        uint32_t subgroupSize = 32;
+        if (properties.apiVersion >= VK_API_VERSION_1_1){
+            VkPhysicalDeviceSubgroupProperties subgroupProperties{};
+            subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+            VkPhysicalDeviceProperties2 properties2{};
+            properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties2.pNext = &subgroupProperties;
+            vkGetPhysicalDeviceProperties2(pDevices->physicalDevice, &properties2);
+            if (subgroupProperties.subgroupSize != 0){
+                subgroupSize = subgroupProperties.subgroupSize;
+            }
+        }
+
+        uint32_t invocations = std::min(std::max(64u, subgroupSize * 2), limits.maxComputeWorkGroupInvocations);
+        constants.workgroupX = std::min(invocations >= 256 ? 16u : 8u, limits.maxComputeWorkGroupSize[0]);
+        constants.workgroupY = std::min(std::max(invocations / constants.workgroupX, 1u), limits.maxComputeWorkGroupSize[1]);
+    }
+
+    if (constants.workgroupX > limits.maxComputeWorkGroupSize[0] || constants.workgroupY > limits.maxComputeWorkGroupSize[1] || constants.workgroupX * constants.workgroupY > limits.maxComputeWorkGroupInvocations){
+        throw std::runtime_error("Post processing workgroup size is bigger than the device allows!");
+    }
+
+    std::cout << "Post processing: " << constants.workgroupX << "x" << constants.workgroupY << " workgroups, " << (writeSwapchain ? "writing the swapchain directly" : "copying into the swapchain") << std::endl;
+}
+
+void postProcess::createPipelines(){
+    // Every stage shares one layout, two sampled inputs and a storage output
+    chooseWorkgroupSize();
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(pDevices->device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create post processing sampler!");
+    }
+
+    VkDescriptorSetLayoutBinding bindings[3]{};
+    for (uint32_t i = 0; i < 3; i++){
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i < 2 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(pDevices->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create post processing descriptor set layout!");
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkCreatePipelineLayout(pDevices->device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create post processing pipeline layout!");
+    }
+
+    for (int stage = 0; stage < postStageCount; stage++){
+        shaderVariant variant{VK_SHADER_STAGE_COMPUTE_BIT, stageShaders[stage], getConstants(static_cast<postStage>(stage))};
+        pipelines[stage] = pPipelineManager->getComputePipeline(variant, pipelineLayout, pipelineLayoutInfo);
+    }
+}
+
+specializationConstants postProcess::getConstants(postStage stage){
+    // Only what the stage's shader actually declares, so a setting one stage ignores doesn't make a new variant of it
+    specializationConstants stageConstants;
+    stageConstants.set(0, constants.workgroupX).set(1, constants.workgroupY);
+    switch (stage){
+        case postBloomPrefilter:
+            stageConstants.set(2, constants.bloomThreshold);
+            break;
+        case postTonemap:
+            stageConstants.set(3, constants.bloomIntensity);
+            break;
+        case postSharpen:
+            stageConstants.set(4, constants.sharpenAmount).set(5, constants.swizzleOutput == VK_TRUE).set(6, constants.encodeSrgb == VK_TRUE);
+            break;
+        default:
+            break;
+    }
+    return stageConstants;
+}
+
+void postProcess::createDescriptors(){
+    uint32_t imageCount = static_cast<uint32_t>(pSwapchain->swapChainImages.size());
+    uint32_t setCount = imageCount * postStageCount;
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = setCount * 2;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = setCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = setCount;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(pDevices->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create post processing descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(setCount, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    descriptorSets.resize(setCount);
+    if (vkAllocateDescriptorSets(pDevices->device, &allocInfo, descriptorSets.data()) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate post processing descriptor sets!");
+    }
+
+    // Same layouts the render graph leaves the images in, sampled inputs are read only and storage is general
+    for (uint32_t imageIndex = 0; imageIndex < imageCount; imageIndex++){
+        for (int stage = 0; stage < postStageCount; stage++){
+            const stageResources& resources = stages[stage];
+
+            VkDescriptorImageInfo imageInfos[3]{};
+            imageInfos[0] = {sampler, pRenderGraph->getImageView(resources.source, imageIndex), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            imageInfos[1] = {sampler, pRenderGraph->getImageView(resources.secondSource, imageIndex), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            imageInfos[2] = {VK_NULL_HANDLE, pRenderGraph->getImageView(resources.destination, imageIndex), VK_IMAGE_LAYOUT_GENERAL};
+
+            VkWriteDescriptorSet writes[3]{};
+            for (uint32_t i = 0; i < 3; i++){
+                writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[i].dstSet = descriptorSets[imageIndex * postStageCount + stage];
+                writes[i].dstBinding = i;
+                writes[i].descriptorCount = 1;
+                writes[i].descriptorType = i < 2 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                writes[i].pImageInfo = &imageInfos[i];
+            }
+            vkUpdateDescriptorSets(pDevices->device, 3, writes, 0, nullptr);
+        }
+    }
+}
+
+void postProcess::recordStage(VkCommandBuffer commandBuffer, postStage stage, uint32_t imageIndex){
+    // One thread per output pixel, rounded up to whole workgroups, the shaders skip anything past the edge
+    VkExtent2D extent = pRenderGraph->getExtent(stages[stage].destination);
+    uint32_t groupsX = (extent.width + constants.workgroupX - 1) / constants.workgroupX;
+    uint32_t groupsY = (extent.height + constants.workgroupY - 1) / constants.workgroupY;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[stage]);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[imageIndex * postStageCount + stage], 0, nullptr);
+    vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+}
+
+void postProcess::recordCopy(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t backbuffer){
+    VkExtent2D extent = pRenderGraph->getExtent(backbuffer);
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.extent = {extent.width, extent.height, 1};
+
+    vkCmdCopyImage(commandBuffer, pRenderGraph->getImage(output, imageIndex), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, pRenderGraph->getImage(backbuffer, imageIndex), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void postProcess::destroyDescriptors(){
+    // Freeing the pool frees every set in it
+    if (descriptorPool != VK_NULL_HANDLE){
+        vkDestroyDescriptorPool(pDevices->device, descriptorPool, nullptr);
+        descriptorPool = VK_NULL_HANDLE;
+    }
+    descriptorSets.clear();
+}
+
+void postProcess::destroyPostProcess(){
+    // The pipelines go with the pipeline manager
+    destroyDescriptors();
+    if (pipelineLayout != VK_NULL_HANDLE){
+        vkDestroyPipelineLayout(pDevices->device, pipelineLayout, nullptr);
+    }
+    if (descriptorSetLayout != VK_NULL_HANDLE){
+        vkDestroyDescriptorSetLayout(pDevices->device, descriptorSetLayout, nullptr);
+    }
+    if (sampler != VK_NULL_HANDLE){
+        vkDestroySampler(pDevices->device, sampler, nullptr);
+    }
+}
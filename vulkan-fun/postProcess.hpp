@@ -0,0 +1,93 @@
+#ifndef postProcess_hpp
+#define postProcess_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "file.hpp"
+#include "devices.hpp"
+#include "swapchain.hpp"
+#include "renderGraph.hpp"
+#include "settings.hpp"
+#include "pipelineManager.hpp"
+
+// Every compute pass in the chain, in the order they run
+enum postStage {
+    postBloomPrefilter,
+    postBloomDownsample,
+    postBloomUpsample,
+    postTonemap,
+    postSharpen,
+    postStageCount
+};
+
+// Values for the constant_id slots in the post shaders, each stage only gets specialized with the ones it declares
+struct postConstants {
+    uint32_t workgroupX;
+    uint32_t workgroupY;
+    float bloomThreshold;
+    float bloomIntensity;
+    float sharpenAmount;
+    VkBool32 swizzleOutput;
+    VkBool32 encodeSrgb;
+};
+
+// Compute chain between the hdr scene and the swapchain, bloom then tonemap then sharpen
+// All of it is marked async so the render graph can hand it to the compute queue while the next frame is drawing
+class postProcess{
+public:
+    // Only touches the disk, so it can run before there's a device
+    void loadShaders(pipelineManager* initPipelineManager);
+    void initPostProcess(devices* initDevices, swapchain* initSwapchain, renderGraph* initRenderGraph, settings* initSettings);
+    // False when there's no way to get the result into this swapchain format, the scene should just draw straight to the swapchain then
+    bool isSupported();
+    void declarePasses(uint32_t scene, uint32_t backbuffer);
+    void createPipelines();
+    // The descriptor sets point at the graph's images, so these get remade every time the graph is compiled
+    void createDescriptors();
+    void destroyDescriptors();
+    void destroyPostProcess();
+
+    // What the main pass renders into before it gets tonemapped
+    static const VkFormat sceneFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+private:
+    // What a stage reads and writes in the graph, secondSource is the same as source for stages with one input
+    struct stageResources {
+        uint32_t pass;
+        uint32_t source;
+        uint32_t secondSource;
+        uint32_t destination;
+    };
+
+    devices* pDevices;
+    swapchain* pSwapchain;
+    renderGraph* pRenderGraph;
+    settings* pSettings;
+    pipelineManager* pPipelineManager;
+
+    stageResources stages[postStageCount];
+    postConstants constants;
+    // Storage images can't be bgra or srgb, so those swapchains get an rgba8 image copied into them instead of being written directly
+    bool writeSwapchain;
+    uint32_t output;
+
+    VkSampler sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    // Owned by the pipeline manager
+    VkPipeline pipelines[postStageCount] = {};
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    // One set per stage per swapchain image, the graph's images follow the swapchain image when async compute is on
+    std::vector<VkDescriptorSet> descriptorSets;
+
+    void chooseWorkgroupSize();
+    void recordStage(VkCommandBuffer commandBuffer, postStage stage, uint32_t imageIndex);
+    void recordCopy(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t backbuffer);
+    specializationConstants getConstants(postStage stage);
+};
+
+#endif /* postProcess_hpp */
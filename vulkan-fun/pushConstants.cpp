@@ -0,0 +1,20 @@
+#include "pushConstants.hpp"
+#include <string>
+
+void pushConstantLayout::checkLimits(VkPhysicalDevice physicalDevice){
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    
+    if (size > properties.limits.maxPushConstantsSize){
+        throw std::runtime_error("Push constants are " + std::to_string(size) + " bytes, the device only allows " + std::to_string(properties.limits.maxPushConstantsSize) + "!");
+    }
+}
+
+void pushConstantLayout::fillLayoutInfo(VkPipelineLayoutCreateInfo& layoutInfo){
+    layoutInfo.pushConstantRangeCount = static_cast<uint32_t>(ranges.size());
+    layoutInfo.pPushConstantRanges = ranges.empty() ? nullptr : ranges.data();
+}
+
+uint32_t pushConstantLayout::getSize(){
+    return size;
+}
@@ -0,0 +1,50 @@
+#ifndef pushConstants_hpp
+#define pushConstants_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+// Where a block of type T sits in a pipeline layout's push constants, recording only takes a T through this so the size and stages always match the layout
+template<typename T>
+struct pushConstantRange {
+    VkShaderStageFlags stages = 0;
+    uint32_t offset = 0;
+};
+
+// The push constant ranges for one pipeline layout, blocks get packed one after another in the order they're added
+class pushConstantLayout{
+public:
+    template<typename T>
+    pushConstantRange<T> addRange(VkShaderStageFlags stages){
+        // The struct gets copied straight into the command buffer, so it has to be plain data in the shader's std430 layout
+        static_assert(std::is_trivially_copyable<T>::value, "Push constant blocks have to be plain data");
+        static_assert(sizeof(T) % 4 == 0, "Push constant blocks have to be a multiple of 4 bytes");
+        
+        // A stage can only be in one range of a layout
+        if (stages & usedStages){
+            throw std::runtime_error("Push constant range reuses a shader stage!");
+        }
+        usedStages |= stages;
+        
+        pushConstantRange<T> range;
+        range.stages = stages;
+        range.offset = size;
+        ranges.push_back({stages, size, static_cast<uint32_t>(sizeof(T))});
+        size += static_cast<uint32_t>(sizeof(T));
+        return range;
+    }
+    
+    // Throws when everything added is bigger than the device allows, 128 bytes is the only size every device has to give
+    void checkLimits(VkPhysicalDevice physicalDevice);
+    void fillLayoutInfo(VkPipelineLayoutCreateInfo& layoutInfo);
+    uint32_t getSize();
+private:
+    std::vector<VkPushConstantRange> ranges;
+    VkShaderStageFlags usedStages = 0;
+    uint32_t size = 0;
+};
+
+#endif /* pushConstants_hpp */
@@ -0,0 +1,1002 @@
+#include "renderGraph.hpp"
+
+namespace {
+    // Everything the graph needs to know about one kind of access, looked up instead of hand writing it per pass
+    struct usageInfo {
+        VkImageLayout layout;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkAccessFlags writeAccess;
+        VkImageUsageFlags imageUsage;
+    };
+
+    usageInfo getUsageInfo(const graphAccess& access, passType type){
+        VkPipelineStageFlags shaderStage = type == passType::compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        usageInfo info{};
+
+        switch (access.usage){
+            case resourceUsage::colorAttachment:
+                info.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                info.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+                info.writeAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+                info.access = info.writeAccess | (access.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0);
+                info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                break;
+            case resourceUsage::depthAttachment:
+                info.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                info.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+                info.writeAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                info.access = info.writeAccess | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+                info.imageUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                break;
+            case resourceUsage::sampled:
+                info.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                info.stages = shaderStage;
+                info.access = VK_ACCESS_SHADER_READ_BIT;
+                info.imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT;
+                break;
+            case resourceUsage::storage:
+                info.layout = VK_IMAGE_LAYOUT_GENERAL;
+                info.stages = shaderStage;
+                info.writeAccess = access.write ? VK_ACCESS_SHADER_WRITE_BIT : 0;
+                info.access = VK_ACCESS_SHADER_READ_BIT | info.writeAccess;
+                info.imageUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+                break;
+            case resourceUsage::transferSrc:
+                info.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                info.access = VK_ACCESS_TRANSFER_READ_BIT;
+                info.imageUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                break;
+            case resourceUsage::transferDst:
+                info.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                info.writeAccess = VK_ACCESS_TRANSFER_WRITE_BIT;
+                info.access = info.writeAccess;
+                info.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+                break;
+        }
+
+        return info;
+    }
+
+    bool isAttachment(resourceUsage usage){
+        return usage == resourceUsage::colorAttachment || usage == resourceUsage::depthAttachment;
+    }
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment){
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Which side of the queue split a transient image is used on, each side gets its own stretch of memory
+    enum queueSpan {
+        graphicsOnly,
+        asyncOnly,
+        // Written by graphics and read by the async tail, the next frame's graphics work can get to it while the tail still has it
+        bothQueues,
+        queueSpanCount
+    };
+}
+
+void renderGraph::initRenderGraph(devices* initDevices, swapchain* initSwapchain, deletionQueue* initDeletionQueue, bool initAllowAsyncCompute){
+    pDevices = initDevices;
+    pSwapchain = initSwapchain;
+    pDeletionQueue = initDeletionQueue;
+    allowAsyncCompute = initAllowAsyncCompute;
+    dynamicRendering = pDevices->dynamicRenderingEnabled;
+    swapchainWaitStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    swapchainOnAsync = false;
+    asyncWaitStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    imageCopies = 1;
+    asyncStart = 0;
+}
+
+uint32_t renderGraph::importSwapchain(const std::string& name){
+    // The swapchain images are owned by the swapchain, the graph only tracks their state and always presents them at the end
+    graphResource resource{};
+    resource.name = name;
+    resource.format = pSwapchain->swapChainImageFormat;
+    resource.extentDivisor = 1;
+    resource.swapchainImage = true;
+    resource.output = true;
+    resources.push_back(resource);
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t renderGraph::importImage(const std::string& name, VkImage image, VkImageView imageView, VkFormat format, VkExtent2D extent, VkImageLayout restingLayout){
+    // Whatever gets written into it is wanted next frame, so it counts as an output and the passes writing it never get culled
+    graphResource resource{};
+    resource.name = name;
+    resource.format = format;
+    resource.extent = extent;
+    resource.extentDivisor = 1;
+    resource.imported = true;
+    resource.restingLayout = restingLayout;
+    resource.output = true;
+    resource.images.push_back(image);
+    resource.imageViews.push_back(imageView);
+    resources.push_back(resource);
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t renderGraph::createImage(const std::string& name, VkFormat format, VkExtent2D extent){
+    // Transient images only live for a frame, so the graph is free to put them in the same memory when their lifetimes don't overlap
+    graphResource resource{};
+    resource.name = name;
+    resource.format = format;
+    resource.extent = extent;
+    resource.extentDivisor = 1;
+    resources.push_back(resource);
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t renderGraph::createScaledImage(const std::string& name, VkFormat format, uint32_t divisor){
+    // Follows the swapchain like a zero extent image but at a fraction of the size, for the blur and downsample chains
+    uint32_t resource = createImage(name, format);
+    resources[resource].extentDivisor = std::max(divisor, 1u);
+    return resource;
+}
+
+uint32_t renderGraph::addPass(const std::string& name, passType type){
+    graphPass pass{};
+    pass.name = name;
+    pass.type = type;
+    passes.push_back(std::move(pass));
+    return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void renderGraph::addAccess(uint32_t pass, uint32_t resource, resourceUsage usage, bool write, VkAttachmentLoadOp loadOp, VkClearValue clearValue){
+    if (pass >= passes.size() || resource >= resources.size()){
+        throw std::runtime_error("Render graph access refers to a pass or resource that doesn't exist!");
+    }
+
+    graphAccess access{};
+    access.resource = resource;
+    access.usage = usage;
+    access.write = write;
+    access.loadOp = loadOp;
+    access.clearValue = clearValue;
+    passes[pass].accesses.push_back(access);
+}
+
+void renderGraph::addColorOutput(uint32_t pass, uint32_t resource, VkAttachmentLoadOp loadOp, VkClearValue clearValue){
+    addAccess(pass, resource, resourceUsage::colorAttachment, true, loadOp, clearValue);
+}
+
+void renderGraph::addDepthOutput(uint32_t pass, uint32_t resource, VkAttachmentLoadOp loadOp, VkClearValue clearValue){
+    addAccess(pass, resource, resourceUsage::depthAttachment, true, loadOp, clearValue);
+}
+
+void renderGraph::addTextureInput(uint32_t pass, uint32_t resource){
+    addAccess(pass, resource, resourceUsage::sampled, false, VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+void renderGraph::addStorageInput(uint32_t pass, uint32_t resource){
+    addAccess(pass, resource, resourceUsage::storage, false, VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+void renderGraph::addStorageOutput(uint32_t pass, uint32_t resource){
+    addAccess(pass, resource, resourceUsage::storage, true, VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+void renderGraph::addTransferInput(uint32_t pass, uint32_t resource){
+    addAccess(pass, resource, resourceUsage::transferSrc, false, VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+void renderGraph::addTransferOutput(uint32_t pass, uint32_t resource){
+    addAccess(pass, resource, resourceUsage::transferDst, true, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {});
+}
+
+void renderGraph::setRecordFunction(uint32_t pass, std::function<void(VkCommandBuffer, uint32_t)> record){
+    passes[pass].record = record;
+}
+
+void renderGraph::setSideEffects(uint32_t pass){
+    // For passes that do something outside the graph (readbacks and the like) so they never get culled
+    passes[pass].sideEffects = true;
+}
+
+void renderGraph::setAsyncCompute(uint32_t pass){
+    // Only a hint, the pass stays on the graphics queue if there's no separate compute queue or a graphics pass comes after it
+    if (passes[pass].type == passType::graphics){
+        throw std::runtime_error("Graphics passes can't run on the async compute queue!");
+    }
+    passes[pass].async = true;
+}
+
+void renderGraph::markOutput(uint32_t resource){
+    resources[resource].output = true;
+}
+
+VkImageUsageFlags renderGraph::getSwapchainUsage(){
+    // Storage and transfer usage can cost the driver its compression on some hardware, so only ask for what the passes need
+    VkImageUsageFlags usage = 0;
+    for (const auto& pass : passes){
+        for (const auto& access : pass.accesses){
+            if (resources[access.resource].swapchainImage){
+                usage |= getUsageInfo(access, pass.type).imageUsage;
+            }
+        }
+    }
+    if (usage == 0){
+        usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    }
+    return usage;
+}
+
+bool renderGraph::usesAsyncCompute(){
+    if (!allowAsyncCompute || pDevices->computeAliasesGraphics){
+        return false;
+    }
+    for (const auto& pass : passes){
+        if (pass.async){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool renderGraph::hasAsyncWork(){
+    return asyncStart < executionOrder.size();
+}
+
+void renderGraph::compile(){
+    // Works out the whole frame from the declarations, then builds the vulkan objects for whatever survived
+    cullPasses();
+    splitQueues();
+    computeLifetimes();
+    allocateTransientImages();
+    computeBarriers();
+
+    for (uint32_t passIndex : executionOrder){
+        if (passes[passIndex].type == passType::graphics && !dynamicRendering){
+            createPassObjects(passes[passIndex]);
+        }
+    }
+}
+
+void renderGraph::cullPasses(){
+    // Reference counting the same way as frostbite's frame graph, passes write resources and resources are read by passes
+    // Anything that doesn't end up feeding an output (or has side effects) gets thrown out
+    for (auto& resource : resources){
+        resource.refCount = resource.output ? 1 : 0;
+    }
+
+    for (auto& pass : passes){
+        pass.culled = false;
+        pass.refCount = pass.sideEffects ? 1 : 0;
+
+        for (const auto& access : pass.accesses){
+            if (access.write){
+                pass.refCount++;
+            }
+            if (!access.write || access.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD){
+                resources[access.resource].refCount++;
+            }
+        }
+    }
+
+    std::vector<uint32_t> unreferenced;
+    for (uint32_t i = 0; i < resources.size(); i++){
+        if (resources[i].refCount == 0){
+            unreferenced.push_back(i);
+        }
+    }
+
+    while (!unreferenced.empty()){
+        uint32_t resourceIndex = unreferenced.back();
+        unreferenced.pop_back();
+
+        for (auto& pass : passes){
+            if (pass.culled){
+                continue;
+            }
+
+            for (const auto& access : pass.accesses){
+                if (access.resource != resourceIndex || !access.write){
+                    continue;
+                }
+
+                if (--pass.refCount == 0){
+                    pass.culled = true;
+
+                    for (const auto& input : pass.accesses){
+                        if ((!input.write || input.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) && --resources[input.resource].refCount == 0){
+                            unreferenced.push_back(input.resource);
+                        }
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    // Declaration order is the execution order, the graph only removes passes it doesn't reorder them
+    executionOrder.clear();
+    for (uint32_t i = 0; i < passes.size(); i++){
+        if (!passes[i].culled){
+            executionOrder.push_back(i);
+        }
+    }
+}
+
+void renderGraph::splitQueues(){
+    // The compute queue gets the run of async passes at the very end of the frame, one semaphore between the two submits is all the syncing that needs
+    // An async pass with a graphics pass after it would need a second trip back, so it just runs inline instead
+    asyncStart = static_cast<uint32_t>(executionOrder.size());
+    if (usesAsyncCompute()){
+        while (asyncStart > 0 && passes[executionOrder[asyncStart - 1]].async){
+            asyncStart--;
+        }
+    }
+
+    for (uint32_t order = 0; order < executionOrder.size(); order++){
+        passes[executionOrder[order]].runsAsync = order >= asyncStart;
+    }
+    imageCopies = hasAsyncWork() ? static_cast<uint32_t>(pSwapchain->swapChainImages.size()) : 1;
+}
+
+void renderGraph::computeLifetimes(){
+    // Figures out the first and last pass (by position in the execution order) each resource is used in and how it's used
+    for (auto& resource : resources){
+        resource.usage = 0;
+        resource.firstPass = UINT32_MAX;
+        resource.lastPass = 0;
+        resource.lastStages = 0;
+        resource.lastWriteAccess = 0;
+        resource.aliasWaitStages = 0;
+        resource.aliasWaitAccess = 0;
+    }
+
+    for (uint32_t order = 0; order < executionOrder.size(); order++){
+        graphPass& pass = passes[executionOrder[order]];
+        pass.order = order;
+        pass.usesSwapchain = false;
+        pass.extent = {0, 0};
+
+        for (const auto& access : pass.accesses){
+            graphResource& resource = resources[access.resource];
+            usageInfo info = getUsageInfo(access, pass.type);
+
+            resource.usage |= info.imageUsage;
+            resource.firstPass = std::min(resource.firstPass, order);
+            resource.lastPass = std::max(resource.lastPass, order);
+            resource.lastStages |= info.stages;
+            resource.lastWriteAccess |= info.writeAccess;
+
+            if (resource.swapchainImage){
+                pass.usesSwapchain = true;
+            }
+            if (isAttachment(access.usage) && pass.extent.width == 0){
+                pass.extent = getExtent(access.resource);
+            }
+        }
+    }
+}
+
+void renderGraph::allocateTransientImages(){
+    // Creates every transient image that's still used, then packs them into one allocation
+    // Images whose lifetimes don't overlap are allowed to sit on top of each other in memory
+    // With the frame split across two queue families the images are shared between them instead of handing ownership back and forth
+    // Only images used on both sides of the split get a copy per swapchain image, the rest are never touched by two frames at once
+    std::vector<uint32_t> transients;
+    VkDeviceSize unaliasedSize = 0;
+    uint32_t queueFamilies[] = {pDevices->graphicsQueueFamily, pDevices->computeQueueFamily};
+    bool concurrent = hasAsyncWork() && pDevices->graphicsQueueFamily != pDevices->computeQueueFamily;
+
+    auto createTransientImage = [&](uint32_t index){
+        graphResource& resource = resources[index];
+        VkExtent2D extent = getExtent(index);
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = resource.format;
+        imageInfo.extent = {extent.width, extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = resource.usage;
+        imageInfo.sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.queueFamilyIndexCount = concurrent ? 2 : 0;
+        imageInfo.pQueueFamilyIndices = concurrent ? queueFamilies : nullptr;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImage image;
+        if (vkCreateImage(pDevices->device, &imageInfo, nullptr, &image) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create render graph image!");
+        }
+        resource.images.push_back(image);
+    };
+
+    for (uint32_t i = 0; i < resources.size(); i++){
+        graphResource& resource = resources[i];
+        if (resource.imported){
+            continue;
+        }
+        resource.images.clear();
+        resource.imageViews.clear();
+
+        if (resource.swapchainImage || resource.firstPass == UINT32_MAX){
+            continue;
+        }
+
+        createTransientImage(i);
+        vkGetImageMemoryRequirements(pDevices->device, resource.images[0], &resource.memoryRequirements);
+        unaliasedSize += resource.memoryRequirements.size;
+        transients.push_back(i);
+    }
+
+    if (transients.empty()){
+        return;
+    }
+
+    // Biggest first tends to pack the best, each image goes at the lowest offset that doesn't collide with anything alive at the same time
+    std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b){
+        return resources[a].memoryRequirements.size > resources[b].memoryRequirements.size;
+    });
+
+    // Graphics and the async tail of the previous frame run at the same time, so images from different spans never share memory
+    auto spanOf = [this](uint32_t index){
+        const graphResource& resource = resources[index];
+        if (resource.firstPass >= asyncStart){
+            return asyncOnly;
+        }
+        return resource.lastPass >= asyncStart ? bothQueues : graphicsOnly;
+    };
+    auto livesOverlap = [&](uint32_t a, uint32_t b){
+        return spanOf(a) == spanOf(b) && resources[a].firstPass <= resources[b].lastPass && resources[b].firstPass <= resources[a].lastPass;
+    };
+    auto memoryOverlaps = [&](uint32_t a, uint32_t b){
+        const graphResource& ra = resources[a];
+        const graphResource& rb = resources[b];
+        return spanOf(a) == spanOf(b) && ra.memoryOffset < rb.memoryOffset + rb.memoryRequirements.size && rb.memoryOffset < ra.memoryOffset + ra.memoryRequirements.size;
+    };
+
+    std::vector<uint32_t> placed;
+    VkDeviceSize spanSizes[queueSpanCount] = {};
+    VkDeviceSize allocationAlignment = 1;
+    uint32_t memoryTypeBits = UINT32_MAX;
+
+    for (uint32_t index : transients){
+        graphResource& resource = resources[index];
+        VkDeviceSize alignment = resource.memoryRequirements.alignment;
+
+        std::vector<VkDeviceSize> candidates = {0};
+        for (uint32_t other : placed){
+            if (livesOverlap(index, other)){
+                candidates.push_back(alignUp(resources[other].memoryOffset + resources[other].memoryRequirements.size, alignment));
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        for (VkDeviceSize candidate : candidates){
+            resource.memoryOffset = candidate;
+            bool fits = true;
+            for (uint32_t other : placed){
+                if (livesOverlap(index, other) && memoryOverlaps(index, other)){
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits){
+                break;
+            }
+        }
+
+        placed.push_back(index);
+        spanSizes[spanOf(index)] = std::max(spanSizes[spanOf(index)], resource.memoryOffset + resource.memoryRequirements.size);
+        allocationAlignment = std::max(allocationAlignment, alignment);
+        memoryTypeBits &= resource.memoryRequirements.memoryTypeBits;
+    }
+
+    // Whoever shares memory has to wait for the previous owner to be done with it, including the last frame's use
+    for (uint32_t a : transients){
+        for (uint32_t b : transients){
+            if (a != b && memoryOverlaps(a, b)){
+                resources[a].aliasWaitStages |= resources[b].lastStages;
+                resources[a].aliasWaitAccess |= resources[b].lastWriteAccess;
+            }
+        }
+    }
+
+    if (memoryTypeBits == 0){
+        throw std::runtime_error("Render graph images have no memory type in common!");
+    }
+
+    // Graphics only, then async only, then every copy of the shared span with the same packed layout one after the other
+    VkDeviceSize spanBases[queueSpanCount];
+    VkDeviceSize layoutSize = 0;
+    for (uint32_t span = 0; span < queueSpanCount; span++){
+        spanBases[span] = layoutSize;
+        spanSizes[span] = alignUp(spanSizes[span], allocationAlignment);
+        layoutSize += spanSizes[span] * (span == bothQueues ? imageCopies : 1);
+    }
+    uint32_t copiedImages = 0;
+    for (uint32_t index : transients){
+        if (spanOf(index) != bothQueues){
+            continue;
+        }
+        copiedImages++;
+        for (uint32_t copy = 1; copy < imageCopies; copy++){
+            createTransientImage(index);
+        }
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = layoutSize;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::attachments, &transientMemory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate render graph memory!");
+    }
+
+    for (uint32_t index : transients){
+        graphResource& resource = resources[index];
+        queueSpan span = spanOf(index);
+        for (uint32_t copy = 0; copy < resource.images.size(); copy++){
+            vkBindImageMemory(pDevices->device, resource.images[copy], transientMemory, spanBases[span] + spanSizes[span] * copy + resource.memoryOffset);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.images[copy];
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.format;
+            viewInfo.subresourceRange.aspectMask = aspectFor(resource.format);
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            VkImageView imageView;
+            if (vkCreateImageView(pDevices->device, &viewInfo, nullptr, &imageView) != VK_SUCCESS){
+                throw std::runtime_error("Failed to create render graph image view!");
+            }
+            resource.imageViews.push_back(imageView);
+        }
+    }
+
+    std::cout << "Render graph: " << transients.size() << " transient images in " << layoutSize / 1024 << " KB (" << unaliasedSize / 1024 << " KB without aliasing)";
+    if (copiedImages > 0 && imageCopies > 1){
+        std::cout << ", " << copiedImages << " of them with " << imageCopies << " copies for async compute";
+    }
+    std::cout << std::endl;
+}
+
+void renderGraph::computeBarriers(){
+    // Walks the frame in order keeping track of what state every image is in, and only syncs when something actually changes
+    // A barrier is needed for a layout change, reading something that was written and hasn't been made visible to that stage yet,
+    // or writing over something that's still being read. Reads after reads in the same layout don't need anything.
+    // Attachments get their transitions and waits folded into the render pass itself, everything else gets a pipeline barrier
+    struct resourceState {
+        bool touched;
+        VkImageLayout layout;
+        VkPipelineStageFlags writeStages;
+        VkAccessFlags writeAccess;
+        VkPipelineStageFlags readStages;
+        VkPipelineStageFlags visibleStages;
+    };
+    std::vector<resourceState> states(resources.size(), resourceState{false, VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, 0});
+    bool swapchainSeen = false;
+
+    for (uint32_t order = 0; order < executionOrder.size(); order++){
+        graphPass& pass = passes[executionOrder[order]];
+        pass.barriers.clear();
+        pass.finalBarriers.clear();
+        pass.dependencies.clear();
+        pass.barrierSrcStages = 0;
+        pass.barrierDstStages = 0;
+        pass.finalSrcStages = 0;
+
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+
+        for (auto& access : pass.accesses){
+            graphResource& resource = resources[access.resource];
+            resourceState& state = states[access.resource];
+            usageInfo info = getUsageInfo(access, pass.type);
+            bool attachment = pass.type == passType::graphics && isAttachment(access.usage) && !dynamicRendering;
+
+            VkImageLayout oldLayout = state.layout;
+            VkPipelineStageFlags waitStages = 0;
+            VkAccessFlags waitAccess = 0;
+            bool makesVisible = false;
+
+            if (!state.touched){
+                // First time this frame, contents from last frame are never kept so start from undefined
+                oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                if (resource.imported){
+                    // Except for imported images, which pick up where the last frame left them
+                    oldLayout = resource.restingLayout;
+                    waitStages = resource.lastStages;
+                    waitAccess = resource.lastWriteAccess;
+                } else if (resource.swapchainImage){
+                    // Has to line up with the stage the acquire semaphore gets waited on
+                    if (!swapchainSeen){
+                        swapchainWaitStages = info.stages;
+                        swapchainOnAsync = pass.runsAsync;
+                        swapchainSeen = true;
+                    }
+                    waitStages = info.stages;
+                } else {
+                    waitStages = resource.lastStages | resource.aliasWaitStages;
+                    waitAccess = resource.aliasWaitAccess;
+                }
+            } else {
+                bool layoutChange = state.layout != info.layout;
+                bool readAfterWrite = state.writeAccess != 0 && (info.stages & ~state.visibleStages) != 0;
+                bool writeAfterWrite = info.writeAccess != 0 && state.writeAccess != 0;
+                bool writeAfterRead = info.writeAccess != 0 && state.readStages != 0;
+
+                if (layoutChange || readAfterWrite || writeAfterWrite){
+                    waitStages |= state.writeStages | (layoutChange ? state.readStages : 0);
+                    waitAccess |= state.writeAccess;
+                    makesVisible = true;
+                }
+                if (writeAfterRead){
+                    waitStages |= state.readStages;
+                }
+            }
+
+            bool needsSync = waitStages != 0 || oldLayout != info.layout;
+
+            if (attachment){
+                // Nothing to keep if we're clearing or don't care, so let the driver discard it
+                access.initialLayout = access.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? oldLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+                access.finalLayout = info.layout;
+                if (resource.swapchainImage && resource.lastPass == order){
+                    access.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+                }
+
+                if (needsSync){
+                    dependency.srcStageMask |= waitStages;
+                    dependency.srcAccessMask |= waitAccess;
+                    dependency.dstStageMask |= info.stages;
+                    dependency.dstAccessMask |= info.access;
+                }
+            } else if (needsSync){
+                pass.barriers.push_back({access.resource, oldLayout, info.layout, waitAccess, info.access});
+                pass.barrierSrcStages |= waitStages;
+                pass.barrierDstStages |= info.stages;
+            }
+
+            // Update what state the image is going to be in after this pass
+            state.touched = true;
+            state.layout = attachment ? access.finalLayout : info.layout;
+            if (info.writeAccess != 0){
+                state.writeStages = info.stages;
+                state.writeAccess = info.writeAccess;
+                state.readStages = 0;
+                state.visibleStages = 0;
+            } else {
+                state.readStages |= info.stages;
+                if (makesVisible || oldLayout != info.layout){
+                    state.visibleStages |= info.stages;
+                }
+            }
+
+            // Swapchain images used for the last time outside of a render pass still need to get to the present layout
+            if (resource.swapchainImage && resource.lastPass == order && !attachment){
+                pass.finalBarriers.push_back({access.resource, info.layout, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, info.writeAccess, 0});
+                pass.finalSrcStages |= info.stages;
+                state.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            }
+        }
+
+        if (pass.type == passType::graphics && (dependency.srcStageMask != 0 || dependency.dstStageMask != 0)){
+            if (dependency.srcStageMask == 0){
+                dependency.srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            }
+            pass.dependencies.push_back(dependency);
+        }
+        if (pass.barrierSrcStages == 0 && !pass.barriers.empty()){
+            pass.barrierSrcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+
+        // Whatever the graphics queue did this frame is already covered by the semaphore the compute submit waits on
+        // The compute queue can't name graphics stages anyway, so those barriers just chain off the semaphore wait instead
+        if (pass.runsAsync){
+            VkPipelineStageFlags graphicsStages = pass.barrierSrcStages & ~(asyncWaitStages | VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+            if (graphicsStages != 0){
+                pass.barrierSrcStages = (pass.barrierSrcStages & ~graphicsStages) | asyncWaitStages;
+            }
+            for (auto& barrier : pass.barriers){
+                barrier.srcAccessMask &= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            }
+        }
+    }
+
+    // The next frame's first use assumes the resting layout, so the last use has to leave it there
+    for (uint32_t i = 0; i < resources.size(); i++){
+        if (resources[i].imported && states[i].touched && states[i].layout != resources[i].restingLayout){
+            throw std::runtime_error("Imported render graph image doesn't end the frame in its resting layout!");
+        }
+    }
+}
+
+void renderGraph::createPassObjects(graphPass& pass){
+    // Turns a graphics pass into the render pass and framebuffers that commands records with
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkAttachmentReference> colorRefs;
+    VkAttachmentReference depthRef{};
+    bool hasDepth = false;
+    std::vector<uint32_t> attachmentResources;
+
+    pass.clearValues.clear();
+    for (const auto& access : pass.accesses){
+        if (!isAttachment(access.usage)){
+            continue;
+        }
+        const graphResource& resource = resources[access.resource];
+
+        VkAttachmentDescription attachment{};
+        attachment.format = resource.format;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = access.loadOp;
+        attachment.storeOp = keepAttachment(pass, access) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = access.initialLayout;
+        attachment.finalLayout = access.finalLayout;
+
+        VkAttachmentReference reference{};
+        reference.attachment = static_cast<uint32_t>(attachments.size());
+        reference.layout = getUsageInfo(access, pass.type).layout;
+
+        if (access.usage == resourceUsage::depthAttachment){
+            depthRef = reference;
+            hasDepth = true;
+        } else {
+            colorRefs.push_back(reference);
+        }
+
+        attachments.push_back(attachment);
+        attachmentResources.push_back(access.resource);
+        pass.clearValues.push_back(access.clearValue);
+    }
+
+    pass.renderPass.createRenderPass(pDevices, pDeletionQueue, &attachments, &colorRefs, hasDepth ? &depthRef : nullptr, &pass.dependencies);
+
+    // One framebuffer per swapchain image as soon as any attachment has one image per swapchain image
+    bool perImage = pass.usesSwapchain;
+    for (uint32_t resource : attachmentResources){
+        perImage = perImage || resources[resource].imageViews.size() > 1;
+    }
+    size_t framebufferCount = perImage ? pSwapchain->swapChainImageViews.size() : 1;
+    std::vector<std::vector<VkImageView>> views(framebufferCount);
+    for (size_t i = 0; i < framebufferCount; i++){
+        for (uint32_t resource : attachmentResources){
+            views[i].push_back(getImageView(resource, static_cast<uint32_t>(i)));
+        }
+    }
+
+    pass.framebuffer.createFramebuffers(pDevices, pDeletionQueue, &pass.renderPass, &views, pass.extent);
+    pass.hasObjects = true;
+}
+
+bool renderGraph::keepAttachment(const graphPass& pass, const graphAccess& access){
+    // Only bother storing if someone later in the frame (or the presentation engine) is going to look at it
+    const graphResource& resource = resources[access.resource];
+    return resource.output || resource.lastPass > pass.order;
+}
+
+void renderGraph::beginRendering(VkCommandBuffer commandBuffer, graphPass& pass, uint32_t imageIndex){
+    // Same information a render pass and framebuffer would hold, just handed over at record time instead
+#ifdef VK_KHR_dynamic_rendering
+    std::vector<VkRenderingAttachmentInfoKHR> colorAttachments;
+    VkRenderingAttachmentInfoKHR depthAttachment{};
+    bool hasDepth = false;
+
+    for (const auto& access : pass.accesses){
+        if (!isAttachment(access.usage)){
+            continue;
+        }
+
+        VkRenderingAttachmentInfoKHR attachment{};
+        attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        attachment.imageView = getImageView(access.resource, imageIndex);
+        attachment.imageLayout = getUsageInfo(access, pass.type).layout;
+        attachment.resolveMode = VK_RESOLVE_MODE_NONE;
+        attachment.loadOp = access.loadOp;
+        attachment.storeOp = keepAttachment(pass, access) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.clearValue = access.clearValue;
+
+        if (access.usage == resourceUsage::depthAttachment){
+            depthAttachment = attachment;
+            hasDepth = true;
+        } else {
+            colorAttachments.push_back(attachment);
+        }
+    }
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea.offset = {0, 0};
+    renderingInfo.renderArea.extent = pass.extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+    renderingInfo.pColorAttachments = colorAttachments.data();
+    renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+
+    pDevices->cmdBeginRendering(commandBuffer, &renderingInfo);
+#else
+    // Devices never turn it on without the headers knowing about it, so getting here means something skipped that check
+    throw std::runtime_error("Dynamic rendering is enabled but the Vulkan headers don't support it!");
+#endif
+}
+
+void renderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<graphBarrier>& barriers, VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages, uint32_t imageIndex){
+    // Everything a pass needs goes out in a single vkCmdPipelineBarrier
+    std::vector<VkImageMemoryBarrier> imageBarriers(barriers.size());
+
+    for (size_t i = 0; i < barriers.size(); i++){
+        const graphBarrier& barrier = barriers[i];
+        VkImageMemoryBarrier& imageBarrier = imageBarriers[i];
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = barrier.srcAccessMask;
+        imageBarrier.dstAccessMask = barrier.dstAccessMask;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = getImage(barrier.resource, imageIndex);
+        imageBarrier.subresourceRange.aspectMask = aspectFor(resources[barrier.resource].format);
+        imageBarrier.subresourceRange.baseMipLevel = 0;
+        imageBarrier.subresourceRange.levelCount = 1;
+        imageBarrier.subresourceRange.baseArrayLayer = 0;
+        imageBarrier.subresourceRange.layerCount = 1;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void renderGraph::execute(VkCommandBuffer commandBuffer, uint32_t imageIndex){
+    // Records the whole frame into the command buffer, barriers first then the pass itself
+    for (uint32_t order = 0; order < asyncStart; order++){
+        recordPass(commandBuffer, passes[executionOrder[order]], imageIndex);
+    }
+}
+
+void renderGraph::executeAsync(VkCommandBuffer commandBuffer, uint32_t imageIndex){
+    for (uint32_t order = asyncStart; order < executionOrder.size(); order++){
+        recordPass(commandBuffer, passes[executionOrder[order]], imageIndex);
+    }
+}
+
+void renderGraph::recordPass(VkCommandBuffer commandBuffer, graphPass& pass, uint32_t imageIndex){
+    if (!pass.barriers.empty()){
+        recordBarriers(commandBuffer, pass.barriers, pass.barrierSrcStages, pass.barrierDstStages, imageIndex);
+    }
+
+    if (pass.type == passType::graphics && dynamicRendering){
+#ifdef VK_KHR_dynamic_rendering
+        beginRendering(commandBuffer, pass, imageIndex);
+        if (pass.record){
+            pass.record(commandBuffer, imageIndex);
+        }
+        pDevices->cmdEndRendering(commandBuffer);
+#else
+        throw std::runtime_error("Dynamic rendering is enabled but the Vulkan headers don't support it!");
+#endif
+    } else if (pass.type == passType::graphics){
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = pass.renderPass.renderPass.get();
+        renderPassInfo.framebuffer = pass.framebuffer.swapChainFramebuffers[pass.framebuffer.swapChainFramebuffers.size() > 1 ? imageIndex : 0].get();
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = pass.extent;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+        renderPassInfo.pClearValues = pass.clearValues.data();
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        if (pass.record){
+            pass.record(commandBuffer, imageIndex);
+        }
+        vkCmdEndRenderPass(commandBuffer);
+    } else if (pass.record){
+        pass.record(commandBuffer, imageIndex);
+    }
+
+    if (!pass.finalBarriers.empty()){
+        recordBarriers(commandBuffer, pass.finalBarriers, pass.finalSrcStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, imageIndex);
+    }
+}
+
+renderPass* renderGraph::getRenderPass(uint32_t pass){
+    if (!passes[pass].hasObjects){
+        throw std::runtime_error("Render pass requested for a pass that was culled or isn't a graphics pass!");
+    }
+    return &passes[pass].renderPass;
+}
+
+passTarget renderGraph::getPassTarget(uint32_t pass){
+    // Pipelines get built against either the render pass or just the attachment formats
+    passTarget target{};
+    target.renderPass = passes[pass].hasObjects ? passes[pass].renderPass.renderPass.get() : VK_NULL_HANDLE;
+    target.depthFormat = VK_FORMAT_UNDEFINED;
+
+    for (const auto& access : passes[pass].accesses){
+        if (access.usage == resourceUsage::colorAttachment){
+            target.colorFormats.push_back(resources[access.resource].format);
+        } else if (access.usage == resourceUsage::depthAttachment){
+            target.depthFormat = resources[access.resource].format;
+        }
+    }
+
+    return target;
+}
+
+VkExtent2D renderGraph::getExtent(uint32_t resource){
+    if (resources[resource].swapchainImage || resources[resource].extent.width == 0){
+        uint32_t divisor = resources[resource].extentDivisor;
+        return {std::max(pSwapchain->swapChainExtent.width / divisor, 1u), std::max(pSwapchain->swapChainExtent.height / divisor, 1u)};
+    }
+    return resources[resource].extent;
+}
+
+VkImage renderGraph::getImage(uint32_t resource, uint32_t imageIndex){
+    if (resources[resource].swapchainImage){
+        return pSwapchain->swapChainImages[imageIndex];
+    }
+    const graphResource& transient = resources[resource];
+    return transient.images[transient.images.size() > 1 ? imageIndex : 0];
+}
+
+VkImageView renderGraph::getImageView(uint32_t resource, uint32_t imageIndex){
+    if (resources[resource].swapchainImage){
+        return pSwapchain->swapChainImageViews[imageIndex].get();
+    }
+    const graphResource& transient = resources[resource];
+    return transient.imageViews[transient.imageViews.size() > 1 ? imageIndex : 0];
+}
+
+bool renderGraph::isCulled(uint32_t pass){
+    return passes[pass].culled;
+}
+
+VkImageAspectFlags renderGraph::aspectFor(VkFormat format){
+    switch (format){
+        case VK_FORMAT_D32_SFLOAT:
+        case VK_FORMAT_D16_UNORM:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+void renderGraph::destroyRenderGraph(){
+    // Frees everything compile made but keeps the declarations so the graph can be compiled again after a swapchain change
+    for (auto& pass : passes){
+        // They go through the deletion queue, framebuffers first since they were made against the render pass
+        if (pass.hasObjects){
+            pass.framebuffer.swapChainFramebuffers.clear();
+            pass.renderPass.renderPass.reset();
+            pass.hasObjects = false;
+        }
+    }
+
+    for (auto& resource : resources){
+        if (resource.imported){
+            continue;
+        }
+        for (auto imageView : resource.imageViews){
+            vkDestroyImageView(pDevices->device, imageView, nullptr);
+        }
+        for (auto image : resource.images){
+            vkDestroyImage(pDevices->device, image, nullptr);
+        }
+        resource.imageViews.clear();
+        resource.images.clear();
+    }
+
+    if (transientMemory != VK_NULL_HANDLE){
+        pDevices->memoryBudget.free(transientMemory);
+        transientMemory = VK_NULL_HANDLE;
+    }
+}
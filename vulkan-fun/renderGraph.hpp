@@ -0,0 +1,193 @@
+#ifndef renderGraph_hpp
+#define renderGraph_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "devices.hpp"
+#include "swapchain.hpp"
+#include "renderPass.hpp"
+#include "frameBuffer.hpp"
+
+// How a pass touches an image, everything else (layouts, load/store ops, barriers) is worked out from this
+enum class resourceUsage {
+    colorAttachment,
+    depthAttachment,
+    sampled,
+    storage,
+    transferSrc,
+    transferDst
+};
+
+enum class passType {
+    graphics,
+    compute,
+    transfer
+};
+
+struct graphAccess {
+    uint32_t resource;
+    resourceUsage usage;
+    bool write;
+    VkAttachmentLoadOp loadOp;
+    VkClearValue clearValue;
+
+    // Filled out by compile, only used for attachments
+    VkImageLayout initialLayout;
+    VkImageLayout finalLayout;
+};
+
+struct graphBarrier {
+    uint32_t resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkAccessFlags srcAccessMask;
+    VkAccessFlags dstAccessMask;
+};
+
+struct graphResource {
+    std::string name;
+    VkFormat format;
+    // A zero extent means the image follows the swapchain extent, divided down for half and quarter resolution images
+    VkExtent2D extent;
+    uint32_t extentDivisor;
+    bool swapchainImage;
+    // Owned by someone else and kept from frame to frame, it starts and ends every frame in the resting layout
+    bool imported;
+    VkImageLayout restingLayout;
+    bool output;
+
+    // Filled out by compile
+    VkImageUsageFlags usage;
+    uint32_t refCount;
+    uint32_t firstPass;
+    uint32_t lastPass;
+    VkPipelineStageFlags lastStages;
+    VkAccessFlags lastWriteAccess;
+    VkPipelineStageFlags aliasWaitStages;
+    VkAccessFlags aliasWaitAccess;
+    VkMemoryRequirements memoryRequirements;
+    VkDeviceSize memoryOffset;
+    // One copy per swapchain image when it's used on both sides of the queue split, otherwise just the one
+    std::vector<VkImage> images;
+    std::vector<VkImageView> imageViews;
+};
+
+// What a pipeline needs to know to be used inside a pass, the render pass is null when dynamic rendering is used
+struct passTarget {
+    VkRenderPass renderPass;
+    std::vector<VkFormat> colorFormats;
+    VkFormat depthFormat;
+};
+
+struct graphPass {
+    std::string name;
+    passType type;
+    bool sideEffects;
+    // Only compute and transfer passes at the end of the frame can go to the async compute queue
+    bool async;
+    std::vector<graphAccess> accesses;
+    std::function<void(VkCommandBuffer, uint32_t)> record;
+
+    // Filled out by compile
+    bool culled;
+    uint32_t refCount;
+    uint32_t order;
+    bool usesSwapchain;
+    bool runsAsync;
+    VkExtent2D extent;
+    std::vector<graphBarrier> barriers;
+    VkPipelineStageFlags barrierSrcStages;
+    VkPipelineStageFlags barrierDstStages;
+    std::vector<graphBarrier> finalBarriers;
+    VkPipelineStageFlags finalSrcStages;
+    std::vector<VkSubpassDependency> dependencies;
+    std::vector<VkClearValue> clearValues;
+    bool hasObjects;
+    renderPass renderPass;
+    framebuffer framebuffer;
+};
+
+class renderGraph{
+public:
+    void initRenderGraph(devices* initDevices, swapchain* initSwapchain, deletionQueue* initDeletionQueue, bool initAllowAsyncCompute);
+
+    // Declaring the frame, done once and kept around so compile can be run again when the swapchain changes
+    uint32_t importSwapchain(const std::string& name);
+    // For images whose contents have to last longer than a frame, the graph syncs and transitions them but never creates, aliases or destroys them
+    uint32_t importImage(const std::string& name, VkImage image, VkImageView imageView, VkFormat format, VkExtent2D extent, VkImageLayout restingLayout);
+    uint32_t createImage(const std::string& name, VkFormat format, VkExtent2D extent = {0, 0});
+    uint32_t createScaledImage(const std::string& name, VkFormat format, uint32_t divisor);
+    uint32_t addPass(const std::string& name, passType type);
+    void addColorOutput(uint32_t pass, uint32_t resource, VkAttachmentLoadOp loadOp, VkClearValue clearValue = {});
+    void addDepthOutput(uint32_t pass, uint32_t resource, VkAttachmentLoadOp loadOp, VkClearValue clearValue = {});
+    void addTextureInput(uint32_t pass, uint32_t resource);
+    void addStorageInput(uint32_t pass, uint32_t resource);
+    void addStorageOutput(uint32_t pass, uint32_t resource);
+    void addTransferInput(uint32_t pass, uint32_t resource);
+    void addTransferOutput(uint32_t pass, uint32_t resource);
+    void setRecordFunction(uint32_t pass, std::function<void(VkCommandBuffer, uint32_t)> record);
+    void setSideEffects(uint32_t pass);
+    void setAsyncCompute(uint32_t pass);
+    void markOutput(uint32_t resource);
+    // What the swapchain images have to be created with for the passes declared so far
+    VkImageUsageFlags getSwapchainUsage();
+    // True when async passes were declared and the device has a compute queue that isn't the graphics queue
+    bool usesAsyncCompute();
+
+    void compile();
+    // Records every pass that runs on the graphics queue, then executeAsync records the rest for the compute queue
+    void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void executeAsync(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    bool hasAsyncWork();
+    void destroyRenderGraph();
+
+    renderPass* getRenderPass(uint32_t pass);
+    passTarget getPassTarget(uint32_t pass);
+    VkExtent2D getExtent(uint32_t resource);
+    VkImage getImage(uint32_t resource, uint32_t imageIndex);
+    VkImageView getImageView(uint32_t resource, uint32_t imageIndex);
+    bool isCulled(uint32_t pass);
+
+    // Stage the first use of the swapchain image happens at, the acquire semaphore has to be waited on here
+    VkPipelineStageFlags swapchainWaitStages;
+    // When the first use is an async pass the compute submit waits on the acquire instead of the graphics one
+    bool swapchainOnAsync;
+    // Where the compute submit waits on the graphics submit
+    VkPipelineStageFlags asyncWaitStages;
+private:
+    devices* pDevices;
+    swapchain* pSwapchain;
+    deletionQueue* pDeletionQueue;
+
+    std::vector<graphResource> resources;
+    std::vector<graphPass> passes;
+    std::vector<uint32_t> executionOrder;
+    VkDeviceMemory transientMemory = VK_NULL_HANDLE;
+    // Async passes read what graphics wrote while the next frame is already drawing, so images used on both queues get a copy per swapchain image
+    uint32_t imageCopies;
+    uint32_t asyncStart;
+    bool allowAsyncCompute;
+    // With dynamic rendering there are no render pass or framebuffer objects at all, attachments get explicit barriers instead
+    bool dynamicRendering;
+
+    void addAccess(uint32_t pass, uint32_t resource, resourceUsage usage, bool write, VkAttachmentLoadOp loadOp, VkClearValue clearValue);
+    void cullPasses();
+    void splitQueues();
+    void computeLifetimes();
+    void allocateTransientImages();
+    void computeBarriers();
+    void createPassObjects(graphPass& pass);
+    bool keepAttachment(const graphPass& pass, const graphAccess& access);
+    void recordPass(VkCommandBuffer commandBuffer, graphPass& pass, uint32_t imageIndex);
+    void beginRendering(VkCommandBuffer commandBuffer, graphPass& pass, uint32_t imageIndex);
+    void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<graphBarrier>& barriers, VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages, uint32_t imageIndex);
+    VkImageAspectFlags aspectFor(VkFormat format);
+};
+
+#endif /* renderGraph_hpp */
@@ -1,52 +1,29 @@
 #include "renderPass.hpp"
 
-void renderPass::createRenderPass(devices* initDevices, swapchain* initSwapchain){
+void renderPass::createRenderPass(devices* initDevices, deletionQueue* initDeletionQueue, const std::vector<VkAttachmentDescription>* attachments, const std::vector<VkAttachmentReference>* colorAttachmentRefs, const VkAttachmentReference* depthAttachmentRef, const std::vector<VkSubpassDependency>* dependencies){
     pDevices = initDevices;
-    pSwapchain = initSwapchain;
     
     // This is so we can tell vulkan about our framebuffer attachments that are going to be used for rendering
     // Sorta like a glue thing, I think
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = pSwapchain->swapChainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    
+    // The layouts, load/store ops and dependencies all come from the render graph now instead of being written out by hand
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs->size());
+    subpass.pColorAttachments = colorAttachmentRefs->data();
+    subpass.pDepthStencilAttachment = depthAttachmentRef;
     
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments->size());
+    renderPassInfo.pAttachments = attachments->data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies->size());
+    renderPassInfo.pDependencies = dependencies->data();
     
-    if (vkCreateRenderPass(pDevices->device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS){
+    VkRenderPass newRenderPass;
+    if (vkCreateRenderPass(pDevices->device, &renderPassInfo, nullptr, &newRenderPass) != VK_SUCCESS){
         throw std::runtime_error("Failed to create render pass!");
     }
-}
-
-void renderPass::destroyRenderPass(){
-    vkDestroyRenderPass(pDevices->device, renderPass, nullptr);
+    renderPass = uniqueHandle<VkRenderPass>(pDevices->device, newRenderPass, vkDestroyRenderPass, initDeletionQueue);
 }
@@ -3,20 +3,20 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <vector>
 #include <iostream>
 #include <stdexcept>
 #include "devices.hpp"
-#include "swapchain.hpp"
+#include "vulkanHandle.hpp"
 
+// Creating it again or resetting the handle sends the old render pass through the deletion queue
 class renderPass{
 public:
-    void createRenderPass(devices* initDevices, swapchain* initSwapchain);
-    void destroyRenderPass();
+    void createRenderPass(devices* initDevices, deletionQueue* initDeletionQueue, const std::vector<VkAttachmentDescription>* attachments, const std::vector<VkAttachmentReference>* colorAttachmentRefs, const VkAttachmentReference* depthAttachmentRef, const std::vector<VkSubpassDependency>* dependencies);
     
-    VkRenderPass renderPass;
+    uniqueHandle<VkRenderPass> renderPass;
 private:
     devices* pDevices;
-    swapchain* pSwapchain;
 };
 
 #endif /* renderPass_hpp */
@@ -0,0 +1,502 @@
+#include "scene.hpp"
+
+namespace {
+    bool testBit(const uint64_t* words, uint32_t index){
+        return (words[index / 64] >> (index % 64)) & 1;
+    }
+    
+    void setBit(uint64_t* words, uint32_t index){
+        words[index / 64] |= 1ull << (index % 64);
+    }
+    
+    uint32_t lowestBit(uint64_t word){
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<uint32_t>(__builtin_ctzll(word));
+#else
+        uint32_t bit = 0;
+        while (!(word & 1)){
+            word >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+}
+
+void scene::initScene(devices* initDevices, uint32_t initFramesInFlight){
+    pDevices = initDevices;
+    framesInFlight = initFramesInFlight;
+    
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    
+    if (vkCreateDescriptorSetLayout(pDevices->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create scene descriptor set layout!");
+    }
+    
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = framesInFlight;
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = framesInFlight;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    
+    if (vkCreateDescriptorPool(pDevices->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create scene descriptor pool!");
+    }
+    
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+    
+    std::vector<VkDescriptorSet> descriptorSets(framesInFlight);
+    if (vkAllocateDescriptorSets(pDevices->device, &allocInfo, descriptorSets.data()) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate scene descriptor sets!");
+    }
+    
+    // The sets stay the same for good, only the buffer they point at changes when it has to grow
+    instanceBuffers.resize(framesInFlight);
+    for (uint32_t i = 0; i < framesInFlight; i++){
+        instanceBuffers[i].descriptorSet = descriptorSets[i];
+        createInstanceBuffer(instanceBuffers[i], chunkSize);
+    }
+}
+
+scene::chunk& scene::getChunk(entityId entity){
+    return *chunks[entity / chunkSize];
+}
+
+void scene::markDirty(entityId entity){
+    chunk& target = getChunk(entity);
+    setBit(target.localDirty, entity % chunkSize);
+    target.anyDirty = true;
+}
+
+entityId scene::createEntity(entityId parent){
+    if (parent != noEntity && parent >= entityCount){
+        throw std::runtime_error("Scene entity parent doesn't exist!");
+    }
+    
+    // Zeroed, so only what isn't zero by default needs setting
+    if (entityCount % chunkSize == 0){
+        chunks.push_back(std::unique_ptr<chunk>(new chunk()));
+    }
+    entityId entity = entityCount++;
+    chunk& target = getChunk(entity);
+    uint32_t slot = entity % chunkSize;
+    target.rotationW[slot] = 1.0f;
+    target.scaleX[slot] = 1.0f;
+    target.scaleY[slot] = 1.0f;
+    target.scaleZ[slot] = 1.0f;
+    // Big enough for the triangle every entity draws until something says otherwise
+    target.boundsRadius[slot] = 1.0f;
+    target.parent[slot] = parent;
+    setBit(target.uploadDirty, slot);
+    markDirty(entity);
+    
+    if (parent != noEntity){
+        hierarchyChanged = true;
+    }
+    return entity;
+}
+
+void scene::setParent(entityId entity, entityId parent){
+    // Walking up from the new parent can't reach the entity, or the transforms would depend on themselves
+    for (entityId ancestor = parent; ancestor != noEntity; ancestor = getChunk(ancestor).parent[ancestor % chunkSize]){
+        if (ancestor == entity){
+            throw std::runtime_error("Scene parent would make a cycle!");
+        }
+    }
+    getChunk(entity).parent[entity % chunkSize] = parent;
+    hierarchyChanged = true;
+    markDirty(entity);
+}
+
+void scene::setPosition(entityId entity, float x, float y, float z){
+    chunk& target = getChunk(entity);
+    uint32_t slot = entity % chunkSize;
+    target.positionX[slot] = x;
+    target.positionY[slot] = y;
+    target.positionZ[slot] = z;
+    markDirty(entity);
+}
+
+void scene::setRotation(entityId entity, float x, float y, float z, float w){
+    chunk& target = getChunk(entity);
+    uint32_t slot = entity % chunkSize;
+    target.rotationX[slot] = x;
+    target.rotationY[slot] = y;
+    target.rotationZ[slot] = z;
+    target.rotationW[slot] = w;
+    markDirty(entity);
+}
+
+void scene::setScale(entityId entity, float x, float y, float z){
+    chunk& target = getChunk(entity);
+    uint32_t slot = entity % chunkSize;
+    target.scaleX[slot] = x;
+    target.scaleY[slot] = y;
+    target.scaleZ[slot] = z;
+    markDirty(entity);
+}
+
+void scene::setBounds(entityId entity, float centerX, float centerY, float centerZ, float radius){
+    // Culling reads it off the gpu, so it goes up like the mesh does
+    chunk& target = getChunk(entity);
+    uint32_t slot = entity % chunkSize;
+    target.boundsX[slot] = centerX;
+    target.boundsY[slot] = centerY;
+    target.boundsZ[slot] = centerZ;
+    target.boundsRadius[slot] = radius;
+    setBit(target.uploadDirty, slot);
+    target.anyDirty = true;
+}
+
+void scene::setMesh(entityId entity, uint32_t meshId, uint32_t materialId){
+    // Doesn't move anything, so only the instance buffers need to hear about it
+    chunk& target = getChunk(entity);
+    uint32_t slot = entity % chunkSize;
+    target.meshId[slot] = meshId;
+    target.materialId[slot] = materialId;
+    setBit(target.uploadDirty, slot);
+    target.anyDirty = true;
+}
+
+const float* scene::getWorldTransform(entityId entity){
+    return getChunk(entity).world[entity % chunkSize];
+}
+
+void scene::getWorldBounds(entityId entity, float* sphere){
+    // The center goes through the whole world transform, the radius only grows by the largest scale so it still covers a stretched mesh
+    const chunk& source = getChunk(entity);
+    uint32_t slot = entity % chunkSize;
+    const float* world = source.world[slot];
+    float center[3] = {source.boundsX[slot], source.boundsY[slot], source.boundsZ[slot]};
+    float largestScale = 0.0f;
+    for (uint32_t column = 0; column < 3; column++){
+        sphere[column] = world[12 + column];
+        const float* axis = world + column * 4;
+        largestScale = std::max(largestScale, axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    }
+    for (uint32_t row = 0; row < 3; row++){
+        for (uint32_t column = 0; column < 3; column++){
+            sphere[row] += world[column * 4 + row] * center[column];
+        }
+    }
+    sphere[3] = source.boundsRadius[slot] * std::sqrt(largestScale);
+}
+
+const std::vector<entityId>& scene::getChangedEntities(){
+    return changedEntities;
+}
+
+uint32_t scene::getEntityCount(){
+    return entityCount;
+}
+
+void scene::rebuildHierarchyOrder(){
+    // Depth first, then a counting sort on it, so any parent is always somewhere before its children
+    std::vector<uint32_t> depths(entityCount, UINT32_MAX);
+    std::vector<entityId> chain;
+    uint32_t maxDepth = 0;
+    for (entityId entity = 0; entity < entityCount; entity++){
+        // Walks up until it finds something with a known depth, then fills the chain in on the way back down
+        entityId current = entity;
+        while (current != noEntity && depths[current] == UINT32_MAX){
+            chain.push_back(current);
+            current = getChunk(current).parent[current % chunkSize];
+        }
+        uint32_t depth = current == noEntity ? 0 : depths[current] + 1;
+        while (!chain.empty()){
+            depths[chain.back()] = depth++;
+            chain.pop_back();
+        }
+        maxDepth = std::max(maxDepth, depths[entity]);
+    }
+    
+    std::vector<uint32_t> starts(maxDepth + 2, 0);
+    for (entityId entity = 0; entity < entityCount; entity++){
+        starts[depths[entity] + 1]++;
+    }
+    for (uint32_t depth = 1; depth < starts.size(); depth++){
+        starts[depth] += starts[depth - 1];
+    }
+    
+    // Roots are left out, update handles them straight from the dirty bits
+    uint32_t rootCount = starts[1];
+    hierarchyOrder.resize(entityCount - rootCount);
+    for (entityId entity = 0; entity < entityCount; entity++){
+        if (depths[entity] > 0){
+            hierarchyOrder[starts[depths[entity]]++ - rootCount] = entity;
+        }
+    }
+    hierarchyChanged = false;
+}
+
+void scene::composeLocal(chunk& target, uint32_t first){
+    // Four entities at once, one lane each, straight from the component arrays
+    float4 px = load4(target.positionX + first);
+    float4 py = load4(target.positionY + first);
+    float4 pz = load4(target.positionZ + first);
+    float4 qx = load4(target.rotationX + first);
+    float4 qy = load4(target.rotationY + first);
+    float4 qz = load4(target.rotationZ + first);
+    float4 qw = load4(target.rotationW + first);
+    float4 sx = load4(target.scaleX + first);
+    float4 sy = load4(target.scaleY + first);
+    float4 sz = load4(target.scaleZ + first);
+    
+    float4 one = splat4(1.0f);
+    float4 two = splat4(2.0f);
+    float4 xx = qx * qx;
+    float4 yy = qy * qy;
+    float4 zz = qz * qz;
+    float4 xy = qx * qy;
+    float4 xz = qx * qz;
+    float4 yz = qy * qz;
+    float4 wx = qw * qx;
+    float4 wy = qw * qy;
+    float4 wz = qw * qz;
+    
+    // Element by element of the column major translation * rotation * scale, then turned back into one matrix per entity
+    alignas(16) float elements[16][4];
+    store4(elements[0], (one - two * (yy + zz)) * sx);
+    store4(elements[1], two * (xy + wz) * sx);
+    store4(elements[2], two * (xz - wy) * sx);
+    store4(elements[3], splat4(0.0f));
+    store4(elements[4], two * (xy - wz) * sy);
+    store4(elements[5], (one - two * (xx + zz)) * sy);
+    store4(elements[6], two * (yz + wx) * sy);
+    store4(elements[7], splat4(0.0f));
+    store4(elements[8], two * (xz + wy) * sz);
+    store4(elements[9], two * (yz - wx) * sz);
+    store4(elements[10], (one - two * (xx + yy)) * sz);
+    store4(elements[11], splat4(0.0f));
+    store4(elements[12], px);
+    store4(elements[13], py);
+    store4(elements[14], pz);
+    store4(elements[15], one);
+    
+    for (uint32_t lane = 0; lane < 4; lane++){
+        float* local = target.local[first + lane];
+        for (uint32_t element = 0; element < 16; element++){
+            local[element] = elements[element][lane];
+        }
+    }
+}
+
+void scene::propagate(){
+    if (hierarchyChanged){
+        rebuildHierarchyOrder();
+    }
+    
+    // Local matrices for every group of four with anything dirty in it, then roots just take theirs as is
+    for (auto& chunkPointer : chunks){
+        chunk& target = *chunkPointer;
+        if (!target.anyDirty){
+            continue;
+        }
+        for (uint32_t word = 0; word < wordsPerChunk; word++){
+            uint64_t dirty = target.localDirty[word];
+            while (dirty){
+                uint32_t group = lowestBit(dirty) & ~3u;
+                composeLocal(target, word * 64 + group);
+                dirty &= ~(0xFull << group);
+            }
+            
+            dirty = target.localDirty[word];
+            while (dirty){
+                uint32_t slot = word * 64 + lowestBit(dirty);
+                dirty &= dirty - 1;
+                if (target.parent[slot] == noEntity){
+                    std::memcpy(target.world[slot], target.local[slot], sizeof(target.world[slot]));
+                    setBit(target.worldChanged, slot);
+                    setBit(target.uploadDirty, slot);
+                    transformsUpdated++;
+                }
+            }
+        }
+    }
+    
+    // Parents always come first in the order, so a parent's world is final and its changed bit set before any child looks at it
+    for (entityId entity : hierarchyOrder){
+        chunk& target = getChunk(entity);
+        uint32_t slot = entity % chunkSize;
+        entityId parent = target.parent[slot];
+        chunk& parentChunk = getChunk(parent);
+        uint32_t parentSlot = parent % chunkSize;
+        if (!testBit(target.localDirty, slot) && !testBit(parentChunk.worldChanged, parentSlot)){
+            continue;
+        }
+        multiplyMatrices(parentChunk.world[parentSlot], target.local[slot], target.world[slot]);
+        setBit(target.worldChanged, slot);
+        setBit(target.uploadDirty, slot);
+        target.anyDirty = true;
+        transformsUpdated++;
+    }
+    
+    // Every instance buffer hears about the changes, each one gets them written the next time its frame comes around
+    // The same list goes out to anything on the cpu that caches something per entity
+    changedEntities.clear();
+    uint32_t wordCount = (entityCount + 63) / 64;
+    for (auto& instances : instanceBuffers){
+        instances.pending.resize(wordCount, 0);
+    }
+    for (uint32_t chunkIndex = 0; chunkIndex < chunks.size(); chunkIndex++){
+        chunk& target = *chunks[chunkIndex];
+        if (!target.anyDirty){
+            continue;
+        }
+        for (uint32_t word = 0; word < wordsPerChunk; word++){
+            uint64_t changed = target.uploadDirty[word];
+            if (changed){
+                for (auto& instances : instanceBuffers){
+                    instances.pending[chunkIndex * wordsPerChunk + word] |= changed;
+                }
+            }
+            while (changed){
+                changedEntities.push_back(chunkIndex * chunkSize + word * 64 + lowestBit(changed));
+                changed &= changed - 1;
+            }
+            target.localDirty[word] = 0;
+            target.worldChanged[word] = 0;
+            target.uploadDirty[word] = 0;
+        }
+        target.anyDirty = false;
+    }
+}
+
+void scene::createInstanceBuffer(instanceBuffer& target, uint32_t capacity){
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = static_cast<VkDeviceSize>(capacity) * sizeof(instanceData);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    
+    if (vkCreateBuffer(pDevices->device, &bufferInfo, nullptr, &target.buffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create scene instance buffer!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(pDevices->device, target.buffer, &memoryRequirements);
+    
+    // Written straight from the cpu every frame something moves, the vertex shader reads each instance once so host memory is fine
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::buffers, &target.memory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate scene instance memory!");
+    }
+    vkBindBufferMemory(pDevices->device, target.buffer, target.memory, 0);
+    
+    void* mapped;
+    if (vkMapMemory(pDevices->device, target.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS){
+        throw std::runtime_error("Failed to map scene instance memory!");
+    }
+    target.mapped = static_cast<instanceData*>(mapped);
+    target.capacity = capacity;
+    
+    VkDescriptorBufferInfo descriptorInfo{target.buffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = target.descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &descriptorInfo;
+    vkUpdateDescriptorSets(pDevices->device, 1, &write, 0, nullptr);
+}
+
+void scene::destroyInstanceBuffer(instanceBuffer& target){
+    vkUnmapMemory(pDevices->device, target.memory);
+    vkDestroyBuffer(pDevices->device, target.buffer, nullptr);
+    pDevices->memoryBudget.free(target.memory);
+    target.buffer = VK_NULL_HANDLE;
+    target.memory = VK_NULL_HANDLE;
+    target.mapped = nullptr;
+    target.capacity = 0;
+}
+
+void scene::upload(instanceBuffer& target){
+    // Only called for the frame whose fence was just waited on, so nothing is reading this buffer or its descriptor set
+    if (target.capacity < entityCount){
+        uint32_t capacity = std::max(target.capacity * 2, (entityCount + chunkSize - 1) / chunkSize * chunkSize);
+        destroyInstanceBuffer(target);
+        createInstanceBuffer(target, capacity);
+        
+        // Nothing in the new buffer yet
+        std::fill(target.pending.begin(), target.pending.end(), ~0ull);
+    }
+    
+    for (uint32_t word = 0; word < target.pending.size(); word++){
+        uint64_t changed = target.pending[word];
+        target.pending[word] = 0;
+        while (changed){
+            entityId entity = word * 64 + lowestBit(changed);
+            changed &= changed - 1;
+            if (entity >= entityCount){
+                break;
+            }
+            
+            const chunk& source = getChunk(entity);
+            uint32_t slot = entity % chunkSize;
+            instanceData& instance = target.mapped[entity];
+            std::memcpy(instance.transform, source.world[slot], sizeof(instance.transform));
+            instance.bounds[0] = source.boundsX[slot];
+            instance.bounds[1] = source.boundsY[slot];
+            instance.bounds[2] = source.boundsZ[slot];
+            instance.bounds[3] = source.boundsRadius[slot];
+            instance.meshId = source.meshId[slot];
+            instance.materialId = source.materialId[slot];
+            instancesUploaded++;
+        }
+    }
+}
+
+void scene::update(uint32_t frame){
+    auto start = std::chrono::steady_clock::now();
+    propagate();
+    currentFrame = frame;
+    upload(instanceBuffers[currentFrame]);
+    
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    updateMilliseconds += elapsed.count();
+    framesUpdated++;
+}
+
+VkDescriptorSet scene::getDescriptorSet(){
+    return instanceBuffers[currentFrame].descriptorSet;
+}
+
+void scene::printSummary(){
+    if (framesUpdated == 0){
+        return;
+    }
+    std::cout << "Scene: " << entityCount << " entities in " << chunks.size() << " chunks, " << hierarchyOrder.size() << " with parents, " << static_cast<double>(transformsUpdated) / framesUpdated << " transforms and " << static_cast<double>(instancesUploaded) / framesUpdated << " instance writes a frame, " << updateMilliseconds / framesUpdated << " ms average update" << std::endl;
+}
+
+void scene::destroyScene(){
+    for (auto& instances : instanceBuffers){
+        destroyInstanceBuffer(instances);
+    }
+    instanceBuffers.clear();
+    vkDestroyDescriptorPool(pDevices->device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(pDevices->device, descriptorSetLayout, nullptr);
+    chunks.clear();
+}
@@ -0,0 +1,137 @@
+#ifndef scene_hpp
+#define scene_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include "devices.hpp"
+#include "simdMath.hpp"
+
+typedef uint32_t entityId;
+const entityId noEntity = UINT32_MAX;
+
+// What the vertex shader reads per instance, lines up with the instances buffer in shadervert.vert
+struct instanceData {
+    // Column major like glsl's mat4
+    float transform[16];
+    // Local space sphere, center then radius
+    float bounds[4];
+    uint32_t meshId;
+    uint32_t materialId;
+    uint32_t padding[2];
+};
+
+// Everything drawn lives in here, stored by component so updating a million transforms is a walk over flat arrays instead of a pointer per entity
+// Entities come in chunks of chunkSize, an id is its chunk and its slot in it, and every component is one array per chunk so four entities can be worked on at once
+// Changes only set dirty bits, update turns the dirty local transforms into world ones parents first and copies only what changed into the frame's instance buffer
+class scene{
+public:
+    void initScene(devices* initDevices, uint32_t initFramesInFlight);
+    // The parent has to exist already, noEntity makes a root, everything starts at the origin with no rotation and a scale of 1
+    entityId createEntity(entityId parent = noEntity);
+    void setParent(entityId entity, entityId parent);
+    void setPosition(entityId entity, float x, float y, float z);
+    // A unit quaternion
+    void setRotation(entityId entity, float x, float y, float z, float w);
+    void setScale(entityId entity, float x, float y, float z);
+    // A sphere in local space for culling, the gpu scales it by the largest scale in the world transform
+    void setBounds(entityId entity, float centerX, float centerY, float centerZ, float radius);
+    void setMesh(entityId entity, uint32_t meshId, uint32_t materialId);
+    // Only up to date as of the last update
+    const float* getWorldTransform(entityId entity);
+    // The bounding sphere in world space, center then radius, as of the last update
+    void getWorldBounds(entityId entity, float* sphere);
+    // Everything whose transform, bounds or mesh changed in the last update, new entities included
+    const std::vector<entityId>& getChangedEntities();
+    uint32_t getEntityCount();
+    // Once a frame on the render thread once the frame's fence has been waited on, so its instance buffer is free to write
+    void update(uint32_t frame);
+    // Set 0 of the main pipeline and of culling, the frame's instance buffer
+    VkDescriptorSet getDescriptorSet();
+    void printSummary();
+    void destroyScene();
+    
+    VkDescriptorSetLayout descriptorSetLayout;
+private:
+    // A multiple of 64 so the dirty words line up with chunks and of 4 so the compose loop never runs off the end
+    static constexpr uint32_t chunkSize = 1024;
+    static constexpr uint32_t wordsPerChunk = chunkSize / 64;
+    
+    struct chunk {
+        alignas(16) float positionX[chunkSize];
+        alignas(16) float positionY[chunkSize];
+        alignas(16) float positionZ[chunkSize];
+        alignas(16) float rotationX[chunkSize];
+        alignas(16) float rotationY[chunkSize];
+        alignas(16) float rotationZ[chunkSize];
+        alignas(16) float rotationW[chunkSize];
+        alignas(16) float scaleX[chunkSize];
+        alignas(16) float scaleY[chunkSize];
+        alignas(16) float scaleZ[chunkSize];
+        alignas(16) float boundsX[chunkSize];
+        alignas(16) float boundsY[chunkSize];
+        alignas(16) float boundsZ[chunkSize];
+        alignas(16) float boundsRadius[chunkSize];
+        uint32_t meshId[chunkSize];
+        uint32_t materialId[chunkSize];
+        entityId parent[chunkSize];
+        // Cached so a parent moving doesn't mean rebuilding every child's local matrix too
+        alignas(16) float local[chunkSize][16];
+        alignas(16) float world[chunkSize][16];
+        // One bit per entity, localDirty is set by the setters, worldChanged by update for children to look at, uploadDirty is anything the instance buffers need
+        uint64_t localDirty[wordsPerChunk];
+        uint64_t worldChanged[wordsPerChunk];
+        uint64_t uploadDirty[wordsPerChunk];
+        bool anyDirty;
+    };
+    
+    // One per frame in flight, persistently mapped and grown when the entities outgrow it
+    struct instanceBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        instanceData* mapped = nullptr;
+        uint32_t capacity = 0;
+        VkDescriptorSet descriptorSet;
+        // Entities changed since this buffer was last written, a bit each
+        std::vector<uint64_t> pending;
+    };
+    
+    devices* pDevices;
+    uint32_t framesInFlight;
+    uint32_t currentFrame = 0;
+    
+    std::vector<std::unique_ptr<chunk>> chunks;
+    uint32_t entityCount = 0;
+    // Every entity with a parent, sorted so parents always come before their children, rebuilt when the hierarchy changes
+    std::vector<entityId> hierarchyOrder;
+    bool hierarchyChanged = false;
+    std::vector<entityId> changedEntities;
+    
+    VkDescriptorPool descriptorPool;
+    std::vector<instanceBuffer> instanceBuffers;
+    
+    // For the summary
+    uint64_t framesUpdated = 0;
+    uint64_t transformsUpdated = 0;
+    uint64_t instancesUploaded = 0;
+    double updateMilliseconds = 0.0;
+    
+    chunk& getChunk(entityId entity);
+    void markDirty(entityId entity);
+    void rebuildHierarchyOrder();
+    void composeLocal(chunk& target, uint32_t first);
+    void propagate();
+    void createInstanceBuffer(instanceBuffer& target, uint32_t capacity);
+    void destroyInstanceBuffer(instanceBuffer& target);
+    void upload(instanceBuffer& target);
+};
+
+#endif /* scene_hpp */
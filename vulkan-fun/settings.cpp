@@ -0,0 +1,157 @@
+#include "settings.hpp"
+
+const char* settings::getVariable(const char* name){
+    const char* value = std::getenv(name);
+    if (value != nullptr && value[0] != '\0'){
+        return value;
+    }
+    return nullptr;
+}
+
+void settings::loadSettings(){
+    // Anything not set just keeps the default from the header
+    if (const char* value = getVariable("VKFUN_RENDER_BACKEND")){
+        std::string backendName = value;
+        if (backendName == "renderpass"){
+            backend = renderBackend::renderPass;
+        } else if (backendName == "dynamic"){
+            backend = renderBackend::dynamicRendering;
+        } else {
+            std::cerr << "Unknown VKFUN_RENDER_BACKEND " << backendName << ", keeping the default" << std::endl;
+        }
+    }
+    
+    if (const char* value = getVariable("VKFUN_LATENCY_POLICY")){
+        std::string policyName = value;
+        if (policyName == "low"){
+            latency = latencyPolicy::lowestLatency;
+        } else if (policyName == "balanced"){
+            latency = latencyPolicy::balanced;
+        } else if (policyName == "power"){
+            latency = latencyPolicy::powerSave;
+        } else {
+            std::cerr << "Unknown VKFUN_LATENCY_POLICY " << policyName << ", keeping the default" << std::endl;
+        }
+    }
+    
+    if (const char* value = getVariable("VKFUN_FRAME_PACING")){
+        framePacing = std::string(value) != "off";
+    }
+    
+    if (const char* value = getVariable("VKFUN_TARGET_FPS")){
+        targetFps = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+    
+    if (const char* value = getVariable("VKFUN_DEVICE")){
+        deviceOverride = value;
+    }
+    
+    if (const char* value = getVariable("VKFUN_POST")){
+        postProcessing = std::string(value) != "off";
+    }
+    
+    if (const char* value = getVariable("VKFUN_ASYNC_COMPUTE")){
+        asyncCompute = std::string(value) != "off";
+    }
+    
+    if (const char* value = getVariable("VKFUN_POST_WORKGROUP")){
+        char* end;
+        postWorkgroupX = static_cast<uint32_t>(std::strtoul(value, &end, 10));
+        postWorkgroupY = *end == 'x' ? static_cast<uint32_t>(std::strtoul(end + 1, nullptr, 10)) : 0;
+        if (postWorkgroupX == 0 || postWorkgroupY == 0){
+            std::cerr << "VKFUN_POST_WORKGROUP should look like 8x8, picking one for the device instead" << std::endl;
+            postWorkgroupX = 0;
+            postWorkgroupY = 0;
+        }
+    }
+    
+    if (const char* value = getVariable("VKFUN_DYNAMIC_RESOLUTION")){
+        dynamicResolution = std::string(value) == "on";
+    }
+    
+    if (const char* value = getVariable("VKFUN_GPU_BUDGET_MS")){
+        gpuBudget = std::strtod(value, nullptr);
+    }
+    
+    if (const char* value = getVariable("VKFUN_MIN_RENDER_SCALE")){
+        minRenderScale = std::strtof(value, nullptr);
+    }
+    
+    if (const char* value = getVariable("VKFUN_TEXTURES")){
+        std::string list = value;
+        size_t start = 0;
+        while (start <= list.size()){
+            size_t end = list.find(',', start);
+            if (end == std::string::npos){
+                end = list.size();
+            }
+            if (end > start){
+                textures.push_back(list.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    }
+    
+    if (const char* value = getVariable("VKFUN_TEXTURE_BUDGET")){
+        textureBudget = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+    
+    if (const char* value = getVariable("VKFUN_STAGING_SIZE")){
+        stagingSize = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+    
+    if (const char* value = getVariable("VKFUN_CAPTURE")){
+        std::string formatName = value;
+        if (formatName == "png"){
+            capture = captureFormat::png;
+        } else if (formatName == "raw"){
+            capture = captureFormat::raw;
+        } else if (formatName == "y4m"){
+            capture = captureFormat::y4m;
+        } else if (formatName == "off"){
+            capture = captureFormat::off;
+        } else {
+            std::cerr << "Unknown VKFUN_CAPTURE " << formatName << ", not capturing" << std::endl;
+        }
+    }
+    
+    if (const char* value = getVariable("VKFUN_CAPTURE_PATH")){
+        capturePath = value;
+    }
+    
+    if (const char* value = getVariable("VKFUN_CAPTURE_BUFFERS")){
+        captureBuffers = std::max(2u, static_cast<uint32_t>(std::strtoul(value, nullptr, 10)));
+    }
+    
+    if (const char* value = getVariable("VKFUN_SCENE_ENTITIES")){
+        sceneEntities = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+    
+    if (const char* value = getVariable("VKFUN_OCCLUSION_CULLING")){
+        occlusionCulling = std::string(value) != "off";
+    }
+    
+    if (const char* value = getVariable("VKFUN_LIGHTS")){
+        lights = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+    
+    if (const char* value = getVariable("VKFUN_LIGHT_SWEEP")){
+        lightSweep = std::string(value) == "1";
+    }
+    
+    if (const char* value = getVariable("VKFUN_SHADOW_LIGHTS")){
+        shadowLights = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+    
+    if (const char* value = getVariable("VKFUN_PARTICLES")){
+        particles = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+    
+    if (const char* value = getVariable("VKFUN_SERIAL_INIT")){
+        serialInit = std::string(value) == "1";
+    }
+    
+    if (const char* value = getVariable("VKFUN_BENCHMARK_FRAMES")){
+        benchmarkFrames = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+}
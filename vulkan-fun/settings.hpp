@@ -0,0 +1,95 @@
+#ifndef settings_hpp
+#define settings_hpp
+
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+enum class renderBackend {
+    renderPass,
+    dynamicRendering
+};
+
+// How the swapchain trades latency against smoothness and power, can also be switched while running with the 1/2/3 keys
+enum class latencyPolicy {
+    lowestLatency,
+    balanced,
+    powerSave
+};
+
+// What recorded frames get written out as
+enum class captureFormat {
+    off,
+    // One file per frame
+    png,
+    raw,
+    // One video stream, 4:2:0 so anything that plays y4m can read it
+    y4m
+};
+
+// Startup options, read from the environment so they can be flipped without rebuilding
+// Maybe this becomes the settings.txt file at some point
+class settings {
+public:
+    void loadSettings();
+    
+    // VKFUN_RENDER_BACKEND=renderpass|dynamic, dynamic falls back to render passes when the device can't do it
+    renderBackend backend = renderBackend::dynamicRendering;
+    // VKFUN_LATENCY_POLICY=low|balanced|power
+    latencyPolicy latency = latencyPolicy::balanced;
+    // VKFUN_FRAME_PACING=on|off
+    bool framePacing = true;
+    // VKFUN_TARGET_FPS=N caps the frame rate, 0 just follows the display
+    uint32_t targetFps = 0;
+    // VKFUN_DEVICE=name:<part of the name>|vendor:<nvidia, amd, intel, apple or hex id>|uuid:<hex>, a bare value is matched against the name
+    std::string deviceOverride;
+    // VKFUN_POST=on|off, the compute chain (bloom, tonemap, sharpen) between the scene and the swapchain
+    bool postProcessing = true;
+    // VKFUN_ASYNC_COMPUTE=on|off, lets the post chain run on its own queue while the next frame is drawing
+    bool asyncCompute = true;
+    // VKFUN_POST_WORKGROUP=<x>x<y> overrides the compute workgroup size picked for the device, 0 picks
+    uint32_t postWorkgroupX = 0;
+    uint32_t postWorkgroupY = 0;
+    // VKFUN_DYNAMIC_RESOLUTION=on|off renders the scene at a fraction of the window's resolution when the gpu can't keep up, then scales it back up
+    bool dynamicResolution = false;
+    // VKFUN_GPU_BUDGET_MS=N gpu time per frame dynamic resolution aims for, 0 is 90% of the frame interval
+    double gpuBudget = 0.0;
+    // VKFUN_MIN_RENDER_SCALE=N how far down dynamic resolution can go, as a fraction of the width and height
+    float minRenderScale = 0.5f;
+    // VKFUN_TEXTURES=<file>,<file>... streamed in at startup, .ppm or rgba8 .ktx, the first four go on the materials in order
+    std::vector<std::string> textures;
+    // VKFUN_TEXTURE_BUDGET=MB of video memory textures can take before the least recently used ones drop to their small mips
+    uint32_t textureBudget = 256;
+    // VKFUN_STAGING_SIZE=MB for the upload ring, no single texture can be bigger than this
+    uint32_t stagingSize = 32;
+    // VKFUN_CAPTURE=png|raw|y4m|off records every frame, frames get dropped rather than slowing rendering down when the encoder falls behind
+    captureFormat capture = captureFormat::off;
+    // VKFUN_CAPTURE_PATH=<prefix> for the captured files, frame numbers and extensions get added on
+    std::string capturePath = "capture";
+    // VKFUN_CAPTURE_BUFFERS=N frames the readback ring can hold, more rides out encoder hiccups at the cost of host memory
+    uint32_t captureBuffers = 6;
+    // VKFUN_SCENE_ENTITIES=N fills the scene with N small triangles in spinning groups instead of the one big one, to see how the transform update scales
+    uint32_t sceneEntities = 0;
+    // VKFUN_OCCLUSION_CULLING=on|off tests objects against last frame's depth on the gpu, off leaves only the frustum test
+    bool occlusionCulling = true;
+    // VKFUN_LIGHTS=N point lights circling in front of the scene, binned into clusters so each pixel only looks at the ones near it
+    uint32_t lights = 0;
+    // VKFUN_LIGHT_SWEEP=1 steps through light counts from none to thousands at startup and prints the gpu time of each
+    bool lightSweep = false;
+    // VKFUN_SHADOW_LIGHTS=N of the lights cast shadows and hold still, their shadow maps only get redrawn when something near them moves
+    uint32_t shadowLights = 16;
+    // VKFUN_PARTICLES=N particles at most in a fountain simulated entirely on the gpu, on the async compute queue when there is one, 0 turns it off
+    uint32_t particles = 0;
+    // VKFUN_SERIAL_INIT=1 runs startup one step at a time like it used to, to compare time to first frame against
+    bool serialInit = false;
+    // VKFUN_BENCHMARK_FRAMES=N closes the window after N frames and prints the timing summary
+    uint32_t benchmarkFrames = 0;
+    
+private:
+    const char* getVariable(const char* name);
+};
+
+#endif /* settings_hpp */
@@ -1,13 +1,24 @@
 #!/bin/sh
 # Type a script or drag a script file from your workspace to insert its path.
+# Runs before every build, a shader that doesn't compile stops the build instead of leaving an old .spv behind
+set -e
 echo "Compiling shaders!"
 SHADERS="./vulkan-fun/shaders/*"
 COMPILED="./vulkan-fun/compiled/"
-GLSLC="/Users/tylerrajotte/VulkanSDK/1.2.176.1/macOS/bin/glslc"
+# GLSLC=<path> picks a compiler, otherwise the Vulkan SDK's or whatever is on the path
+if [ -z "$GLSLC" ]; then
+ if [ -n "$VULKAN_SDK" ] && [ -x "$VULKAN_SDK/bin/glslc" ]; then
+  GLSLC="$VULKAN_SDK/bin/glslc"
+ elif [ -x "/Users/tylerrajotte/VulkanSDK/1.2.176.1/macOS/bin/glslc" ]; then
+  GLSLC="/Users/tylerrajotte/VulkanSDK/1.2.176.1/macOS/bin/glslc"
+ else
+  GLSLC="glslc"
+ fi
+fi
+mkdir -p $COMPILED
 for SHADER in $SHADERS
 do
  SHADERPATH=$(echo $SHADER | cut -d '.' -f 2)
  SHADERNAME=$(echo $SHADERPATH | cut -d '/' -f 4)
  $GLSLC $SHADER -o $COMPILED$SHADERNAME.spv
 done
-
@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Same scale the main pass gets, so particles sit at the same brightness as the scene around them
+layout(constant_id = 0) const float sceneScale = 1.0;
+
+layout(location = 0) in vec2 fragCorner;
+layout(location = 1) in float fragAge;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // A soft round dot, hot when it's new and cooling off as it fades
+    float falloff = 1.0 - dot(fragCorner, fragCorner);
+    if (falloff <= 0.0) {
+        discard;
+    }
+    vec3 color = mix(vec3(1.0, 0.8, 0.4), vec3(0.3, 0.5, 1.0), fragAge);
+    float alpha = falloff * falloff * (1.0 - fragAge);
+    outColor = vec4(color * sceneScale, alpha);
+}
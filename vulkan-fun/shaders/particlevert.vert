@@ -0,0 +1,43 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// One quad facing the camera per particle, instanced over the sorted state so they come out back to front
+layout(push_constant) uniform particleDrawConstants {
+    mat4 viewProjection;
+    float size;
+} draw;
+
+struct particle {
+    vec4 positionLife;
+    vec4 velocityLifetime;
+};
+
+// The state a compute pass sorted framesInFlight frames ago
+layout(std430, set = 0, binding = 1) readonly buffer particleState {
+    uint count;
+    uvec3 simulate;
+    uvec4 drawArguments;
+    particle particles[];
+};
+
+layout(location = 0) out vec2 fragCorner;
+layout(location = 1) out float fragAge;
+
+vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0),
+    vec2(1.0, -1.0),
+    vec2(1.0, 1.0),
+    vec2(-1.0, -1.0),
+    vec2(1.0, 1.0),
+    vec2(-1.0, 1.0)
+);
+
+void main() {
+    particle current = particles[gl_InstanceIndex];
+    // The camera looks straight down +z, so an offset in x and y is already facing it
+    vec2 corner = corners[gl_VertexIndex];
+    vec3 position = current.positionLife.xyz + vec3(corner * draw.size, 0.0);
+    gl_Position = draw.viewProjection * vec4(position, 1.0);
+    fragCorner = corner;
+    fragAge = 1.0 - current.positionLife.w / max(current.velocityLifetime.w, 1e-5);
+}
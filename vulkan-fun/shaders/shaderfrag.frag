@@ -1,10 +1,106 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+layout(constant_id = 0) const float sceneScale = 1.0;
+// The light grid, has to match what the binning pass was built with
+layout(constant_id = 1) const uint gridX = 16;
+layout(constant_id = 2) const uint gridY = 9;
+layout(constant_id = 3) const uint gridZ = 24;
+
+layout(push_constant) uniform drawConstants {
+    mat4 transform;
+    uint materialId;
+} draw;
+
+// Tint per material, anything past the end just uses the first one
+const vec3 materialTints[4] = vec3[](
+    vec3(1.0, 1.0, 1.0),
+    vec3(1.0, 0.6, 0.3),
+    vec3(0.3, 0.6, 1.0),
+    vec3(0.5, 1.0, 0.5)
+);
+
+struct lightData {
+    vec4 positionRadius;
+    vec4 colorIntensity;
+    vec4 shadowTile;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer lightBuffer {
+    uint lightCount;
+    float ambient;
+    lightData lights[];
+};
+
+// Written by the binning pass this frame, an offset into the index list and a count for every cluster
+layout(std430, set = 2, binding = 1) readonly buffer clusterBuffer {
+    uvec2 clusters[];
+};
+
+layout(std430, set = 2, binding = 2) readonly buffer indexBuffer {
+    uint lightIndices[];
+};
+
+// Cached depth from every shadow casting light, each in its own square, compared against while sampling
+layout(set = 3, binding = 0) uniform sampler2DShadow shadowAtlas;
+
+// Whatever mips of each material's texture are resident right now, or a white placeholder until they arrive
+layout(set = 4, binding = 0) uniform sampler2D materialTextures[4];
+
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) flat in uint fragMaterial;
+layout(location = 2) in vec3 fragWorld;
+layout(location = 3) in vec3 fragClip;
 
 layout(location = 0) out vec4 outColor;
 
+// 1 for lit, 0 for behind a caster, lights without a tile never shadow anything
+float shadowFactor(lightData light, vec3 toFragment) {
+    vec4 tile = light.shadowTile;
+    if (tile.z <= 0.0 || toFragment.z <= tile.w) {
+        return 1.0;
+    }
+    // The same 90 degree frustum down +z the tile was drawn with, out to the light's radius
+    vec2 ndc = toFragment.xy / toFragment.z;
+    if (any(greaterThan(abs(ndc), vec2(1.0)))) {
+        return 1.0;
+    }
+    float farPlane = light.positionRadius.w;
+    float depth = farPlane / (farPlane - tile.w) - tile.w * farPlane / ((farPlane - tile.w) * toFragment.z);
+    vec2 uv = tile.xy + (ndc * 0.5 + 0.5) * tile.z;
+    return texture(shadowAtlas, vec3(uv, depth - 0.0005));
+}
+
+// Constant indices so the array doesn't need dynamic indexing, the material only changes between objects so the branch stays coherent
+vec3 materialTexture(uint material, vec2 uv) {
+    switch (material) {
+        case 1u: return texture(materialTextures[1], uv).rgb;
+        case 2u: return texture(materialTextures[2], uv).rgb;
+        case 3u: return texture(materialTextures[3], uv).rgb;
+        default: return texture(materialTextures[0], uv).rgb;
+    }
+}
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    // Every triangle lies flat facing the camera, which looks down +z
+    const vec3 normal = vec3(0.0, 0.0, -1.0);
+
+    uvec3 cell = uvec3(clamp(vec3((fragClip.xy * 0.5 + 0.5) * vec2(gridX, gridY), fragClip.z * float(gridZ)), vec3(0.0), vec3(gridX - 1u, gridY - 1u, gridZ - 1u)));
+    uvec2 cluster = clusters[cell.x + cell.y * gridX + cell.z * gridX * gridY];
+
+    vec3 lighting = vec3(ambient);
+    for (uint i = 0u; i < cluster.y; i++) {
+        lightData light = lights[lightIndices[cluster.x + i]];
+        vec3 toLight = light.positionRadius.xyz - fragWorld;
+        float distance = length(toLight);
+        if (distance < light.positionRadius.w) {
+            float falloff = 1.0 - distance / light.positionRadius.w;
+            float facing = max(dot(normal, toLight / max(distance, 1e-5)), 0.0);
+            lighting += light.colorIntensity.rgb * light.colorIntensity.a * falloff * falloff * facing * shadowFactor(light, -toLight);
+        }
+    }
+
+    // Everything faces the camera so the texture just gets mapped across the world's xy plane
+    uint material = fragMaterial < 4u ? fragMaterial : 0u;
+    outColor = vec4(fragColor * materialTints[material] * materialTexture(material, fragWorld.xy) * lighting * sceneScale, 1.0);
 }
@@ -1,7 +1,34 @@
 #version 430
 #extension GL_ARB_separate_shader_objects : enable
 
+layout(push_constant) uniform drawConstants {
+    mat4 transform;
+    uint materialId;
+    uint firstVisible;
+} draw;
+
+struct instanceData {
+    mat4 transform;
+    vec4 bounds;
+    uint meshId;
+    uint materialId;
+};
+
+// Written by the scene for whatever moved since this frame's buffer was last used
+layout(std430, set = 0, binding = 0) readonly buffer instanceBuffer {
+    instanceData instances[];
+};
+
+// Filled by culling, the draw is instanced over only the objects that made it through
+layout(std430, set = 1, binding = 2) readonly buffer visibleBuffer {
+    uint visibleIds[];
+};
+
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) flat out uint fragMaterial;
+// Where the fragment is for lighting, and where it is on screen to find its cluster
+layout(location = 2) out vec3 fragWorld;
+layout(location = 3) out vec3 fragClip;
 
 vec2 positions[3] = vec2[](
     vec2(0.0, -0.5),
@@ -16,6 +43,11 @@ vec3 colors[3] = vec3[](
 );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    instanceData instance = instances[visibleIds[draw.firstVisible + gl_InstanceIndex]];
+    vec4 world = instance.transform * vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    gl_Position = draw.transform * world;
+    fragWorld = world.xyz;
+    fragClip = gl_Position.xyz / gl_Position.w;
     fragColor = colors[gl_VertexIndex];
+    fragMaterial = draw.materialId != 0u ? draw.materialId : instance.materialId;
 }
@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Draws the casters of one light into its tile of the shadow atlas, only depth comes out the other end
+layout(push_constant) uniform shadowConstants {
+    mat4 lightViewProjection;
+    uint firstCaster;
+} shadow;
+
+struct instanceData {
+    mat4 transform;
+    vec4 bounds;
+    uint meshId;
+    uint materialId;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer instanceBuffer {
+    instanceData instances[];
+};
+
+// The cached caster lists of every tile being redrawn this frame, one after the other
+layout(std430, set = 1, binding = 1) readonly buffer casterBuffer {
+    uint casterIds[];
+};
+
+vec2 positions[3] = vec2[](
+    vec2(0.0, -0.5),
+    vec2(0.5, 0.5),
+    vec2(-0.5, 0.5)
+);
+
+void main() {
+    instanceData instance = instances[casterIds[shadow.firstCaster + gl_InstanceIndex]];
+    gl_Position = shadow.lightViewProjection * instance.transform * vec4(positions[gl_VertexIndex], 0.0, 1.0);
+}
@@ -0,0 +1,481 @@
+#include "shadowAtlas.hpp"
+
+void shadowAtlas::initShadowAtlas(devices* initDevices, scene* initScene, clusteredLights* initLights, uint32_t initFramesInFlight){
+    pDevices = initDevices;
+    pScene = initScene;
+    pLights = initLights;
+    framesInFlight = initFramesInFlight;
+    depthFormat = occlusionCuller::findDepthFormat(pDevices->physicalDevice);
+    
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = depthFormat;
+    imageInfo.extent = {atlasSize, atlasSize, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    
+    if (vkCreateImage(pDevices->device, &imageInfo, nullptr, &atlas) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create shadow atlas!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(pDevices->device, atlas, &memoryRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::images, &atlasMemory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate shadow atlas memory!");
+    }
+    vkBindImageMemory(pDevices->device, atlas, atlasMemory, 0);
+    
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = atlas;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+    
+    if (vkCreateImageView(pDevices->device, &viewInfo, nullptr, &atlasView) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create shadow atlas view!");
+    }
+    
+    // A fresh atlas holds garbage, all of it starts at the far plane and in the resting layout the render graph expects before anything gets to sample it
+    commands::submitOnce(pDevices, [this](VkCommandBuffer commandBuffer){
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = atlas;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        
+        VkClearDepthStencilValue farPlane = {1.0f, 0};
+        vkCmdClearDepthStencilImage(commandBuffer, atlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &farPlane, 1, &barrier.subresourceRange);
+        
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    });
+    
+    // Does the depth comparison while sampling, nearest since linear filtering of depth formats isn't everywhere
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    
+    if (vkCreateSampler(pDevices->device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create shadow sampler!");
+    }
+    
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    
+    if (vkCreateDescriptorSetLayout(pDevices->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create shadow descriptor set layout!");
+    }
+    
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = framesInFlight;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = framesInFlight;
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = framesInFlight;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    
+    if (vkCreateDescriptorPool(pDevices->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create shadow descriptor pool!");
+    }
+    
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo setAllocInfo{};
+    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocInfo.descriptorPool = descriptorPool;
+    setAllocInfo.descriptorSetCount = framesInFlight;
+    setAllocInfo.pSetLayouts = layouts.data();
+    
+    std::vector<VkDescriptorSet> sets(framesInFlight);
+    if (vkAllocateDescriptorSets(pDevices->device, &setAllocInfo, sets.data()) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate shadow descriptor sets!");
+    }
+    
+    casterBuffers.resize(framesInFlight);
+    for (uint32_t i = 0; i < framesInFlight; i++){
+        casterBuffers[i].descriptorSet = sets[i];
+        createCasterBuffer(casterBuffers[i], 1024);
+        
+        VkDescriptorImageInfo imageInfo{sampler, atlasView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = sets[i];
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(pDevices->device, 1, &write, 0, nullptr);
+    }
+    
+    freeTiles.resize(1);
+    while ((atlasSize >> (freeTiles.size() - 1)) > minTileSize){
+        freeTiles.emplace_back();
+    }
+    freeTiles[0].push_back({0, 0, atlasSize});
+}
+
+void shadowAtlas::createCasterBuffer(casterBuffer& target, uint32_t capacity){
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = static_cast<VkDeviceSize>(capacity) * sizeof(uint32_t);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    
+    if (vkCreateBuffer(pDevices->device, &bufferInfo, nullptr, &target.buffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create shadow caster buffer!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(pDevices->device, target.buffer, &memoryRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::buffers, &target.memory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate shadow caster memory!");
+    }
+    vkBindBufferMemory(pDevices->device, target.buffer, target.memory, 0);
+    
+    void* mapped;
+    if (vkMapMemory(pDevices->device, target.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS){
+        throw std::runtime_error("Failed to map shadow caster memory!");
+    }
+    target.mapped = static_cast<uint32_t*>(mapped);
+    target.capacity = capacity;
+    
+    VkDescriptorBufferInfo casterInfo{target.buffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = target.descriptorSet;
+    write.dstBinding = 1;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &casterInfo;
+    vkUpdateDescriptorSets(pDevices->device, 1, &write, 0, nullptr);
+}
+
+void shadowAtlas::destroyCasterBuffer(casterBuffer& target){
+    vkUnmapMemory(pDevices->device, target.memory);
+    vkDestroyBuffer(pDevices->device, target.buffer, nullptr);
+    pDevices->memoryBudget.free(target.memory);
+    target.buffer = VK_NULL_HANDLE;
+    target.memory = VK_NULL_HANDLE;
+    target.mapped = nullptr;
+}
+
+uint32_t shadowAtlas::tileSizeFor(float radius, VkExtent2D sceneExtent){
+    // The light reaches 2 * radius of the -1 to 1 height of the screen, so that many pixels across is all the detail it can show
+    float pixels = radius * sceneExtent.height;
+    uint32_t size = minTileSize;
+    while (size < pixels && size < maxTileSize){
+        size *= 2;
+    }
+    return size;
+}
+
+bool shadowAtlas::allocateTile(uint32_t size, tile& result){
+    // The smallest free square that fits, split down a quarter at a time with the other three quarters left free
+    uint32_t level = 0;
+    while ((atlasSize >> level) > size){
+        level++;
+    }
+    uint32_t found = level + 1;
+    for (uint32_t candidate = level + 1; candidate-- > 0;){
+        if (!freeTiles[candidate].empty()){
+            found = candidate;
+            break;
+        }
+    }
+    if (found > level){
+        return false;
+    }
+    
+    result = freeTiles[found].back();
+    freeTiles[found].pop_back();
+    while (found < level){
+        found++;
+        uint32_t half = result.size / 2;
+        freeTiles[found].push_back({result.x + half, result.y, half});
+        freeTiles[found].push_back({result.x, result.y + half, half});
+        freeTiles[found].push_back({result.x + half, result.y + half, half});
+        result.size = half;
+    }
+    return true;
+}
+
+void shadowAtlas::freeTile(const tile& target){
+    // Neighbours never get merged back together, when that leaves nothing big enough the whole atlas gets repacked
+    uint32_t level = 0;
+    while ((atlasSize >> level) > target.size){
+        level++;
+    }
+    freeTiles[level].push_back(target);
+}
+
+void shadowAtlas::repack(VkExtent2D sceneExtent){
+    // Biggest tiles first so they always fit, whatever doesn't fit at all goes without a shadow until something frees up
+    for (auto& level : freeTiles){
+        level.clear();
+    }
+    freeTiles[0].push_back({0, 0, atlasSize});
+    
+    std::vector<uint32_t> order(lights.size());
+    for (uint32_t i = 0; i < order.size(); i++){
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b){
+        return lights[a].radius > lights[b].radius;
+    });
+    for (uint32_t index : order){
+        shadowLight& light = lights[index];
+        light.placed = allocateTile(tileSizeFor(light.radius, sceneExtent), light.area);
+        light.dirty = true;
+    }
+    repacks++;
+}
+
+bool shadowAtlas::reaches(const shadowLight& light, const float* sphere){
+    // Anything in range and past the near plane, the light only looks down +z towards the scene
+    float dx = sphere[0] - light.position[0];
+    float dy = sphere[1] - light.position[1];
+    float dz = sphere[2] - light.position[2];
+    float reach = light.radius + sphere[3];
+    return dx * dx + dy * dy + dz * dz < reach * reach && dz + sphere[3] > nearPlane;
+}
+
+void shadowAtlas::gatherCasters(shadowLight& light){
+    // The whole scene, only when the light itself moved, it comes out sorted since the ids go up
+    light.casters.clear();
+    float sphere[4];
+    uint32_t entityCount = pScene->getEntityCount();
+    for (entityId entity = 0; entity < entityCount; entity++){
+        pScene->getWorldBounds(entity, sphere);
+        if (reaches(light, sphere)){
+            light.casters.push_back(entity);
+        }
+    }
+}
+
+void shadowAtlas::lightViewProjection(const shadowLight& light, float* matrix){
+    // Looking down +z from the light with a 90 degree frustum out to its radius, so x and y divided by the distance in z land in -1 to 1
+    float farPlane = light.radius;
+    float a = farPlane / (farPlane - nearPlane);
+    float b = -nearPlane * farPlane / (farPlane - nearPlane);
+    std::fill(matrix, matrix + 16, 0.0f);
+    matrix[0] = 1.0f;
+    matrix[5] = 1.0f;
+    matrix[10] = a;
+    matrix[11] = 1.0f;
+    matrix[12] = -light.position[0];
+    matrix[13] = -light.position[1];
+    matrix[14] = b - a * light.position[2];
+    matrix[15] = -light.position[2];
+}
+
+void shadowAtlas::update(uint32_t frame, VkExtent2D sceneExtent){
+    currentFrame = frame;
+    draws.clear();
+    framesCounted++;
+    
+    uint32_t count = pLights->getShadowLightCount();
+    while (lights.size() > count){
+        if (lights.back().placed){
+            freeTile(lights.back().area);
+        }
+        lights.pop_back();
+    }
+    lights.resize(count);
+    
+    // Moved lights start their casters over, the rest only look at what changed in the scene
+    const std::vector<entityId>& changed = pScene->getChangedEntities();
+    bool needRepack = false;
+    float sphere[4];
+    for (uint32_t i = 0; i < count; i++){
+        shadowLight& light = lights[i];
+        const lightData& current = pLights->getLight(i);
+        bool moved = light.radius != current.radius || !std::equal(current.position, current.position + 3, light.position);
+        if (moved){
+            std::copy(current.position, current.position + 3, light.position);
+            light.radius = current.radius;
+            gatherCasters(light);
+            light.dirty = true;
+            casterRebuilds++;
+        } else {
+            for (entityId entity : changed){
+                pScene->getWorldBounds(entity, sphere);
+                bool inRange = reaches(light, sphere);
+                auto position = std::lower_bound(light.casters.begin(), light.casters.end(), entity);
+                bool listed = position != light.casters.end() && *position == entity;
+                if (inRange && !listed){
+                    light.casters.insert(position, entity);
+                    casterPatches++;
+                } else if (!inRange && listed){
+                    light.casters.erase(position);
+                    casterPatches++;
+                }
+                // Moving into range, out of it, or about inside it all change what the tile should show
+                if (inRange || listed){
+                    light.dirty = true;
+                }
+            }
+        }
+        
+        uint32_t size = tileSizeFor(light.radius, sceneExtent);
+        if (!light.placed || light.area.size != size){
+            if (light.placed){
+                freeTile(light.area);
+            }
+            light.placed = allocateTile(size, light.area);
+            needRepack = needRepack || !light.placed;
+            light.dirty = true;
+        }
+    }
+    if (needRepack){
+        repack(sceneExtent);
+    }
+    
+    // Every dirty tile's casters go one after the other into this frame's buffer, its frame is done so it can be swapped for a bigger one
+    uint32_t totalCasters = 0;
+    for (const shadowLight& light : lights){
+        if (light.placed && light.dirty){
+            totalCasters += static_cast<uint32_t>(light.casters.size());
+        }
+    }
+    casterBuffer& casters = casterBuffers[currentFrame];
+    if (totalCasters > casters.capacity){
+        uint32_t capacity = casters.capacity;
+        while (capacity < totalCasters){
+            capacity *= 2;
+        }
+        destroyCasterBuffer(casters);
+        createCasterBuffer(casters, capacity);
+    }
+    
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < count; i++){
+        shadowLight& light = lights[i];
+        float area[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        if (light.placed){
+            area[0] = static_cast<float>(light.area.x) / atlasSize;
+            area[1] = static_cast<float>(light.area.y) / atlasSize;
+            area[2] = static_cast<float>(light.area.size) / atlasSize;
+            area[3] = nearPlane;
+        }
+        pLights->setShadowTile(i, area);
+        
+        if (light.placed && light.dirty){
+            uint32_t casterCount = static_cast<uint32_t>(light.casters.size());
+            std::copy(light.casters.begin(), light.casters.end(), casters.mapped + written);
+            draws.push_back({i, written, casterCount});
+            written += casterCount;
+            tilesDrawn++;
+            castersDrawn += casterCount;
+            light.dirty = false;
+        }
+    }
+}
+
+void shadowAtlas::recordShadows(VkCommandBuffer commandBuffer, graphicsPipeline* pipeline){
+    if (draws.empty()){
+        return;
+    }
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->depthOnlyPipeline);
+    VkDescriptorSet sets[2] = {pScene->getDescriptorSet(), getDescriptorSet()};
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->depthOnlyLayout.get(), 0, 2, sets, 0, nullptr);
+    
+    // Each tile gets wiped back to the far plane and its casters drawn in, nothing outside its square gets touched
+    for (const tileDraw& draw : draws){
+        const shadowLight& light = lights[draw.light];
+        VkViewport viewport{(float) light.area.x, (float) light.area.y, (float) light.area.size, (float) light.area.size, 0.0f, 1.0f};
+        VkRect2D scissor{{static_cast<int32_t>(light.area.x), static_cast<int32_t>(light.area.y)}, {light.area.size, light.area.size}};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        
+        VkClearAttachment clear{};
+        clear.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        clear.clearValue.depthStencil = {1.0f, 0};
+        VkClearRect clearRect{scissor, 0, 1};
+        vkCmdClearAttachments(commandBuffer, 1, &clear, 1, &clearRect);
+        
+        if (draw.casterCount == 0){
+            continue;
+        }
+        shadowConstants constants{};
+        lightViewProjection(light, constants.lightViewProjection);
+        constants.firstCaster = draw.firstCaster;
+        commands::pushConstants(commandBuffer, pipeline->depthOnlyLayout.get(), pipeline->shadowRange, constants);
+        vkCmdDraw(commandBuffer, 3, draw.casterCount, 0, 0);
+    }
+}
+
+VkDescriptorSet shadowAtlas::getDescriptorSet(){
+    return casterBuffers[currentFrame].descriptorSet;
+}
+
+void shadowAtlas::printSummary(){
+    if (framesCounted == 0){
+        return;
+    }
+    double frames = static_cast<double>(framesCounted);
+    std::cout << "Shadows: " << lights.size() << " lights in a " << atlasSize << " atlas, " << tilesDrawn / frames << " tiles and " << castersDrawn / frames << " casters drawn a frame, " << casterRebuilds << " caster lists rebuilt and " << casterPatches << " patched, " << repacks << " repacks" << std::endl;
+}
+
+void shadowAtlas::destroyShadowAtlas(){
+    for (casterBuffer& target : casterBuffers){
+        destroyCasterBuffer(target);
+    }
+    casterBuffers.clear();
+    vkDestroyDescriptorPool(pDevices->device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(pDevices->device, descriptorSetLayout, nullptr);
+    vkDestroySampler(pDevices->device, sampler, nullptr);
+    vkDestroyImageView(pDevices->device, atlasView, nullptr);
+    vkDestroyImage(pDevices->device, atlas, nullptr);
+    pDevices->memoryBudget.free(atlasMemory);
+}
@@ -0,0 +1,111 @@
+#ifndef shadowAtlas_hpp
+#define shadowAtlas_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "devices.hpp"
+#include "scene.hpp"
+#include "clusteredLights.hpp"
+#include "graphicsPipeline.hpp"
+#include "occlusionCuller.hpp"
+#include "commands.hpp"
+
+// One big depth image every shadow casting light gets a square of, kept from frame to frame
+// Each light keeps the list of entities that can throw a shadow into its tile, patched from the scene's changed entities instead of rebuilt
+// A tile only gets drawn again when its light moved, its size changed, or one of the entities near it changed, so a still scene draws no shadows at all
+class shadowAtlas{
+public:
+    static constexpr uint32_t atlasSize = 2048;
+    // Tiles are powers of two between these, picked from how much of the screen the light reaches
+    static constexpr uint32_t minTileSize = 32;
+    static constexpr uint32_t maxTileSize = 512;
+    static constexpr float nearPlane = 0.01f;
+    
+    void initShadowAtlas(devices* initDevices, scene* initScene, clusteredLights* initLights, uint32_t initFramesInFlight);
+    // Once a frame after the scene and the lights have updated, works out which tiles need drawing and hands the lights where their tiles are
+    void update(uint32_t frame, VkExtent2D sceneExtent);
+    // Inside the graph's pass with the atlas as its depth attachment, draws nothing when no tile changed
+    void recordShadows(VkCommandBuffer commandBuffer, graphicsPipeline* pipeline);
+    // Set 3 of the main pipeline for the atlas, set 1 of the depth only one for the caster ids
+    VkDescriptorSet getDescriptorSet();
+    void printSummary();
+    void destroyShadowAtlas();
+    
+    VkDescriptorSetLayout descriptorSetLayout;
+    // Imported into the render graph, it rests in shader read layout between frames and the graph's pass loads what's there so the tiles that aren't drawn keep their shadows
+    VkImage atlas;
+    VkImageView atlasView;
+    VkFormat depthFormat;
+private:
+    struct tile {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t size = 0;
+    };
+    
+    struct shadowLight {
+        // Where the light was and how far it reached when its casters were gathered
+        float position[3];
+        float radius;
+        bool placed = false;
+        tile area;
+        // Sorted, so the changed entities can be looked up in it
+        std::vector<entityId> casters;
+        bool dirty = true;
+    };
+    
+    // Written by the cpu every frame, so there's one per frame in flight
+    struct casterBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        uint32_t* mapped = nullptr;
+        uint32_t capacity = 0;
+        VkDescriptorSet descriptorSet;
+    };
+    
+    struct tileDraw {
+        uint32_t light;
+        uint32_t firstCaster;
+        uint32_t casterCount;
+    };
+    
+    devices* pDevices;
+    scene* pScene;
+    clusteredLights* pLights;
+    uint32_t framesInFlight;
+    uint32_t currentFrame = 0;
+    
+    VkDeviceMemory atlasMemory;
+    VkSampler sampler;
+    VkDescriptorPool descriptorPool;
+    
+    std::vector<shadowLight> lights;
+    // Free squares for every tile size, biggest first, a square gets split into four when a smaller one is needed
+    std::vector<std::vector<tile>> freeTiles;
+    std::vector<casterBuffer> casterBuffers;
+    std::vector<tileDraw> draws;
+    
+    // For the summary
+    uint64_t framesCounted = 0;
+    uint64_t tilesDrawn = 0;
+    uint64_t castersDrawn = 0;
+    uint64_t casterRebuilds = 0;
+    uint64_t casterPatches = 0;
+    uint64_t repacks = 0;
+    
+    uint32_t tileSizeFor(float radius, VkExtent2D sceneExtent);
+    bool allocateTile(uint32_t size, tile& result);
+    void freeTile(const tile& target);
+    void repack(VkExtent2D sceneExtent);
+    bool reaches(const shadowLight& light, const float* sphere);
+    void gatherCasters(shadowLight& light);
+    void createCasterBuffer(casterBuffer& target, uint32_t capacity);
+    void destroyCasterBuffer(casterBuffer& target);
+    void lightViewProjection(const shadowLight& light, float* matrix);
+};
+
+#endif /* shadowAtlas_hpp */
@@ -0,0 +1,116 @@
+#ifndef simdMath_hpp
+#define simdMath_hpp
+
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define VKFUN_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VKFUN_NEON 1
+#endif
+
+// Four floats in one register, whatever the cpu calls it, with a plain fallback so everything still builds without either
+// Kept to the handful of operations the transform code needs
+struct float4 {
+#if VKFUN_SSE
+    __m128 value;
+#elif VKFUN_NEON
+    float32x4_t value;
+#else
+    float value[4];
+#endif
+};
+
+// Loads and stores want 16 byte aligned pointers
+inline float4 load4(const float* source){
+    float4 result;
+#if VKFUN_SSE
+    result.value = _mm_load_ps(source);
+#elif VKFUN_NEON
+    result.value = vld1q_f32(source);
+#else
+    std::memcpy(result.value, source, sizeof(result.value));
+#endif
+    return result;
+}
+
+inline void store4(float* destination, float4 source){
+#if VKFUN_SSE
+    _mm_store_ps(destination, source.value);
+#elif VKFUN_NEON
+    vst1q_f32(destination, source.value);
+#else
+    std::memcpy(destination, source.value, sizeof(source.value));
+#endif
+}
+
+inline float4 splat4(float scalar){
+    float4 result;
+#if VKFUN_SSE
+    result.value = _mm_set1_ps(scalar);
+#elif VKFUN_NEON
+    result.value = vdupq_n_f32(scalar);
+#else
+    for (int i = 0; i < 4; i++){
+        result.value[i] = scalar;
+    }
+#endif
+    return result;
+}
+
+inline float4 operator+(float4 a, float4 b){
+    float4 result;
+#if VKFUN_SSE
+    result.value = _mm_add_ps(a.value, b.value);
+#elif VKFUN_NEON
+    result.value = vaddq_f32(a.value, b.value);
+#else
+    for (int i = 0; i < 4; i++){
+        result.value[i] = a.value[i] + b.value[i];
+    }
+#endif
+    return result;
+}
+
+inline float4 operator-(float4 a, float4 b){
+    float4 result;
+#if VKFUN_SSE
+    result.value = _mm_sub_ps(a.value, b.value);
+#elif VKFUN_NEON
+    result.value = vsubq_f32(a.value, b.value);
+#else
+    for (int i = 0; i < 4; i++){
+        result.value[i] = a.value[i] - b.value[i];
+    }
+#endif
+    return result;
+}
+
+inline float4 operator*(float4 a, float4 b){
+    float4 result;
+#if VKFUN_SSE
+    result.value = _mm_mul_ps(a.value, b.value);
+#elif VKFUN_NEON
+    result.value = vmulq_f32(a.value, b.value);
+#else
+    for (int i = 0; i < 4; i++){
+        result.value[i] = a.value[i] * b.value[i];
+    }
+#endif
+    return result;
+}
+
+// out = a * b for column major 4x4 matrices, out can't be either input
+// Every column of the result is the columns of a weighted by one column of b
+inline void multiplyMatrices(const float* a, const float* b, float* out){
+    float4 columns[4] = {load4(a), load4(a + 4), load4(a + 8), load4(a + 12)};
+    for (int column = 0; column < 4; column++){
+        const float* weights = b + column * 4;
+        float4 result = columns[0] * splat4(weights[0]) + columns[1] * splat4(weights[1]) + columns[2] * splat4(weights[2]) + columns[3] * splat4(weights[3]);
+        store4(out + column * 4, result);
+    }
+}
+
+#endif /* simdMath_hpp */
@@ -0,0 +1,44 @@
+#ifndef spscQueue_hpp
+#define spscQueue_hpp
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed size ring buffer for exactly one thread pushing and one thread popping, no locks so neither side can stall the other
+// Capacity has to be a power of two so the indices can just wrap with a mask
+template <typename T, size_t capacity>
+class spscQueue {
+    static_assert((capacity & (capacity - 1)) == 0, "spscQueue capacity must be a power of two");
+public:
+    // Producer side, returns false when the queue is full instead of waiting
+    bool push(const T& item){
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) == capacity){
+            return false;
+        }
+        
+        items[tail & (capacity - 1)] = item;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side, returns false when there's nothing to take
+    bool pop(T& item){
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)){
+            return false;
+        }
+        
+        item = items[head & (capacity - 1)];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    
+private:
+    T items[capacity];
+    // Kept on their own cache lines so the two threads aren't fighting over the same line on every push and pop
+    alignas(64) std::atomic<size_t> headIndex{0};
+    alignas(64) std::atomic<size_t> tailIndex{0};
+};
+
+#endif /* spscQueue_hpp */
@@ -12,28 +12,73 @@ VkSurfaceFormatKHR swapchain::chooseSwapSurfaceFormat(const std::vector<VkSurfac
 }
 
 VkPresentModeKHR swapchain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes){
-    // VSync Settings right here, tries for triple buffering  if not tries the standard mode of swapchain doing
-    for (const auto& availablePresentMode : availablePresentModes){
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR){
-            return availablePresentMode;
+    // VSync Settings right here, each policy has its own order of preference and FIFO is always there to fall back to
+    // Lowest latency will take tearing over waiting, balanced is triple buffering, power save just waits on the display
+    std::vector<VkPresentModeKHR> preferred;
+    switch (policy){
+        case latencyPolicy::lowestLatency:
+            preferred = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+            break;
+        case latencyPolicy::balanced:
+            preferred = {VK_PRESENT_MODE_MAILBOX_KHR};
+            break;
+        case latencyPolicy::powerSave:
+            break;
+    }
+    
+    for (VkPresentModeKHR mode : preferred){
+        if (std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end()){
+            return mode;
         }
     }
     
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t swapchain::chooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities){
+    // Generally 1 plus the minimum so there's always an image free to render into
+    // Lowest latency with FIFO would only queue up more frames with the extra image, so it sticks to the minimum there
+    uint32_t imageCount = capabilities.minImageCount + 1;
+    if (policy == latencyPolicy::lowestLatency && presentMode == VK_PRESENT_MODE_FIFO_KHR){
+        imageCount = std::max(capabilities.minImageCount, 2u);
+    }
+    
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount){
+        imageCount = capabilities.maxImageCount;
+    }
+    
+    return imageCount;
+}
+
+void swapchain::setLatencyPolicy(latencyPolicy newPolicy){
+    policy = newPolicy;
+    
+    // Only one frame in flight for lowest latency so input never waits behind an already recorded frame
+    framesInFlight = policy == latencyPolicy::lowestLatency ? 1 : 2;
+}
+
+const char* swapchain::getPolicyName(){
+    switch (policy){
+        case latencyPolicy::lowestLatency:
+            return "lowest latency";
+        case latencyPolicy::balanced:
+            return "balanced";
+        case latencyPolicy::powerSave:
+            return "power save";
+    }
+    return "unknown";
+}
+
 VkExtent2D swapchain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities){
     // Makes sure that the proper screen coords or screen size is being used depending on whats needed and it converts between the two
     // Also makes sure that everything is going to actually work with vulkan and isnt out of spec
     if (capabilities.currentExtent.width != UINT32_MAX){
         return capabilities.currentExtent;
     } else {
-        int width, height;
-        glfwGetFramebufferSize(pWindow->window, &width, &height);
-        
+        // Read from what the window last reported since this runs on the render thread and glfw can't be asked from here
         VkExtent2D actualExent = {
-            static_cast<uint32_t>(width),
-            static_cast<uint32_t>(height)
+            static_cast<uint32_t>(pWindow->framebufferWidth.load()),
+            static_cast<uint32_t>(pWindow->framebufferHeight.load())
         };
         
         actualExent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExent.width));
@@ -43,42 +88,63 @@ VkExtent2D swapchain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilit
     }
 }
 
-void swapchain::createSwapChain(windowManager* initWindow, devices* initDevices, VkSurfaceKHR* initSurface){
+void swapchain::selectSurfaceFormat(windowManager* initWindow, devices* initDevices, VkSurfaceKHR* initSurface, deletionQueue* initDeletionQueue){
     pWindow = initWindow;
     pDevices = initDevices;
     pSurface = initSurface;
+    pDeletionQueue = initDeletionQueue;
+    
+    SwapChainSupportDetails swapChainSupport = querySwapChainSupport(&pDevices->physicalDevice, pSurface);
+    VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+    swapChainImageFormat = surfaceFormat.format;
+    swapChainColorSpace = surfaceFormat.colorSpace;
     
-    // Figure out what we can and can't do as a starting point
+    // The surface can say storage is fine while the format itself can't be written from a shader, srgb formats usually can't
+    supportedUsage = swapChainSupport.capabilities.supportedUsageFlags;
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(pDevices->physicalDevice, swapChainImageFormat, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)){
+        supportedUsage &= ~VK_IMAGE_USAGE_STORAGE_BIT;
+    }
+}
+
+void swapchain::createSwapChain(){
+    // Figure out what we can and can't do as a starting point, the format was already settled by selectSurfaceFormat
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(&pDevices->physicalDevice, pSurface);
     
     // Gathers info for filling another data struct "Vulkan Form" trieds to grabs whats the reasonable defaults but will go back to what works
-    VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
     
-    // Sets up however many images were going to store in the swap chain generally 1 plus the minium
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount){
-        imageCount = swapChainSupport.capabilities.maxImageCount;
-    }
+    // Sets up however many images were going to store in the swap chain
+    uint32_t imageCount = chooseImageCount(swapChainSupport.capabilities);
     
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     createInfo.surface = *pSurface;
     createInfo.minImageCount = imageCount;
-    createInfo.imageFormat = surfaceFormat.format;
-    createInfo.imageColorSpace = surfaceFormat.colorSpace;
+    createInfo.imageFormat = swapChainImageFormat;
+    createInfo.imageColorSpace = swapChainColorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if ((imageUsage & supportedUsage) != imageUsage){
+        throw std::runtime_error("Swapchain images can't be used the way the render graph needs!");
+    }
+    createInfo.imageUsage = imageUsage;
     
     QueueFamilyIndices indices = pDevices->findQueueFamilies(pDevices->physicalDevice);
-    uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::vector<uint32_t> queueFamilyIndices = {indices.graphicsFamily.value()};
+    if (indices.presentFamily.value() != indices.graphicsFamily.value()){
+        queueFamilyIndices.push_back(indices.presentFamily.value());
+    }
+    if (shareWithCompute && std::find(queueFamilyIndices.begin(), queueFamilyIndices.end(), pDevices->computeQueueFamily) == queueFamilyIndices.end()){
+        queueFamilyIndices.push_back(pDevices->computeQueueFamily);
+    }
     
-    if (indices.graphicsFamily != indices.presentFamily){
+    if (queueFamilyIndices.size() > 1){
         createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-        createInfo.queueFamilyIndexCount = 2;
-        createInfo.pQueueFamilyIndices = queueFamilyIndices;
+        createInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
+        createInfo.pQueueFamilyIndices = queueFamilyIndices.data();
     } else {
         createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
         createInfo.queueFamilyIndexCount = 0;
@@ -88,23 +154,27 @@ void swapchain::createSwapChain(windowManager* initWindow, devices* initDevices,
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // The surface can only have one swapchain that isn't retired, handing over the old one retires it
+    createInfo.oldSwapchain = swapChain.get();
     
-    if (vkCreateSwapchainKHR(pDevices->device, &createInfo, nullptr, &swapChain) != VK_SUCCESS){
+    VkSwapchainKHR newSwapChain;
+    if (vkCreateSwapchainKHR(pDevices->device, &createInfo, nullptr, &newSwapChain) != VK_SUCCESS){
         throw std::runtime_error("Failed to create swapchain");
     }
+    // The old views go first so they're never left pointing at images of a swapchain that's already gone
+    swapChainImageViews.clear();
+    swapChain = uniqueHandle<VkSwapchainKHR>(pDevices->device, newSwapChain, vkDestroySwapchainKHR, pDeletionQueue);
     
-    vkGetSwapchainImagesKHR(pDevices->device, swapChain, &imageCount, nullptr);
+    vkGetSwapchainImagesKHR(pDevices->device, swapChain.get(), &imageCount, nullptr);
     swapChainImages.resize(imageCount);
-    vkGetSwapchainImagesKHR(pDevices->device, swapChain, &imageCount, swapChainImages.data());
+    vkGetSwapchainImagesKHR(pDevices->device, swapChain.get(), &imageCount, swapChainImages.data());
     
-    swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
 }
 
 void swapchain::createImageViews(){
     // Needed so the swapchain can actually function, creates a image view for every image in the swapchain
-    swapChainImageViews.resize(swapChainImages.size());
+    swapChainImageViews.clear();
     
     for (size_t i = 0; i < swapChainImages.size(); i++){
         VkImageViewCreateInfo createInfo{};
@@ -123,16 +193,10 @@ void swapchain::createImageViews(){
         createInfo.subresourceRange.baseArrayLayer = 0;
         createInfo.subresourceRange.layerCount = 1;
         
-        if(vkCreateImageView(pDevices->device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS){
+        VkImageView imageView;
+        if(vkCreateImageView(pDevices->device, &createInfo, nullptr, &imageView) != VK_SUCCESS){
             throw std::runtime_error("Failed to create image views!");
         }
+        swapChainImageViews.emplace_back(pDevices->device, imageView, vkDestroyImageView, pDeletionQueue);
     }
 }
-
-void swapchain::destroySwapChain(){
-    for (auto imageView : swapChainImageViews) {
-        vkDestroyImageView(pDevices->device, imageView, nullptr);
-    }
-    
-    vkDestroySwapchainKHR(pDevices->device, swapChain, nullptr);
-}
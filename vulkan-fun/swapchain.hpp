@@ -11,26 +11,48 @@
 #include "windowManager.hpp"
 #include "devices.hpp"
 #include "querySwapchainSupport.hpp"
+#include "settings.hpp"
+#include "vulkanHandle.hpp"
 
+// Owns the swapchain and its image views, replacing them hands the old ones to the deletion queue so nothing needs tearing down by hand
 class swapchain {
 public:
-    void createSwapChain(windowManager* initWindow, devices* initDevices, VkSurfaceKHR* initSurface);
+    // Picks the image format without creating anything, so work that only needs the format can get going early
+    void selectSurfaceFormat(windowManager* initWindow, devices* initDevices, VkSurfaceKHR* initSurface, deletionQueue* initDeletionQueue);
+    // Called again on a resize, the old swapchain gets retired into the new one and destroyed once its frames are done
+    void createSwapChain();
     void createImageViews();
-    void destroySwapChain();
+    // Only takes effect the next time the swapchain gets created
+    void setLatencyPolicy(latencyPolicy newPolicy);
+    const char* getPolicyName();
     
-    VkSwapchainKHR swapChain;
+    latencyPolicy policy = latencyPolicy::balanced;
+    VkPresentModeKHR presentMode;
+    // How many frames the cpu is allowed to get ahead of the gpu under the current policy
+    uint32_t framesInFlight = 2;
+    // Declared before the swapchain so dropping everything at once still hands the views over first
+    std::vector<uniqueHandle<VkImageView>> swapChainImageViews;
+    uniqueHandle<VkSwapchainKHR> swapChain;
     VkFormat swapChainImageFormat;
+    VkColorSpaceKHR swapChainColorSpace;
     VkExtent2D swapChainExtent;
-    std::vector<VkImageView> swapChainImageViews;
+    // What the surface and format allow the images to be used for, filled out by selectSurfaceFormat
+    VkImageUsageFlags supportedUsage;
+    // Set before createSwapChain from what the render graph does with the images
+    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // Async compute passes that touch the images need them shared with the compute queue family too
+    bool shareWithCompute = false;
     std::vector<VkImage> swapChainImages;
 private:
     windowManager* pWindow;
     devices* pDevices;
     VkSurfaceKHR* pSurface;
+    deletionQueue* pDeletionQueue;
     
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
+    uint32_t chooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities);
 };
 
 #endif /* swapchain_hpp */
@@ -0,0 +1,142 @@
+#include "textureFile.hpp"
+
+namespace {
+    bool endsWith(const std::string& value, const std::string& ending){
+        return value.size() >= ending.size() && value.compare(value.size() - ending.size(), ending.size(), ending) == 0;
+    }
+
+    // Skips whitespace and # comments, then reads one number from a ppm header
+    uint32_t readPpmNumber(const std::vector<char>& data, size_t& position){
+        while (position < data.size()){
+            if (data[position] == '#'){
+                while (position < data.size() && data[position] != '\n'){
+                    position++;
+                }
+            } else if (data[position] == ' ' || data[position] == '\t' || data[position] == '\r' || data[position] == '\n'){
+                position++;
+            } else {
+                break;
+            }
+        }
+
+        uint32_t value = 0;
+        bool found = false;
+        while (position < data.size() && data[position] >= '0' && data[position] <= '9'){
+            value = value * 10 + static_cast<uint32_t>(data[position] - '0');
+            position++;
+            found = true;
+        }
+        if (!found){
+            throw std::runtime_error("Failed to read ppm header!");
+        }
+        return value;
+    }
+}
+
+textureSource textureFile::decode(const std::string& filename){
+    std::vector<char> data = File::readFile(filename);
+    if (endsWith(filename, ".ppm")){
+        return decodePpm(data);
+    }
+    if (endsWith(filename, ".ktx")){
+        return decodeKtx(data);
+    }
+    throw std::runtime_error("Unknown texture format for " + filename + "!");
+}
+
+uint32_t textureFile::mipLevelCount(uint32_t width, uint32_t height){
+    // Halving until both sides hit one
+    uint32_t levels = 1;
+    uint32_t size = std::max(width, height);
+    while (size > 1){
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+textureSource textureFile::decodePpm(const std::vector<char>& data){
+    // P6 width height maxval, one whitespace character, then rgb triples
+    if (data.size() < 2 || data[0] != 'P' || data[1] != '6'){
+        throw std::runtime_error("Only binary ppm textures are supported!");
+    }
+
+    size_t position = 2;
+    textureSource source;
+    source.width = readPpmNumber(data, position);
+    source.height = readPpmNumber(data, position);
+    uint32_t maxValue = readPpmNumber(data, position);
+    position++;
+
+    if (maxValue != 255 || source.width == 0 || source.height == 0){
+        throw std::runtime_error("Only 8 bit ppm textures are supported!");
+    }
+
+    size_t pixelCount = static_cast<size_t>(source.width) * source.height;
+    if (data.size() < position + pixelCount * 3){
+        throw std::runtime_error("Ppm texture is shorter than its header says!");
+    }
+
+    // Nothing samples rgb8 well, so it gets an opaque alpha here instead of on the gpu
+    std::vector<uint8_t> pixels(pixelCount * 4);
+    for (size_t i = 0; i < pixelCount; i++){
+        pixels[i * 4 + 0] = static_cast<uint8_t>(data[position + i * 3 + 0]);
+        pixels[i * 4 + 1] = static_cast<uint8_t>(data[position + i * 3 + 1]);
+        pixels[i * 4 + 2] = static_cast<uint8_t>(data[position + i * 3 + 2]);
+        pixels[i * 4 + 3] = 255;
+    }
+    source.levels.push_back(std::move(pixels));
+    return source;
+}
+
+textureSource textureFile::decodeKtx(const std::vector<char>& data){
+    // KTX 1.1, a 12 byte identifier then 13 uint32 fields, key value data, and each level prefixed with its size
+    const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    uint32_t header[13];
+    if (data.size() < sizeof(identifier) + sizeof(header) || std::memcmp(data.data(), identifier, sizeof(identifier)) != 0){
+        throw std::runtime_error("Texture isn't a ktx file!");
+    }
+    std::memcpy(header, data.data() + sizeof(identifier), sizeof(header));
+
+    // Header fields, in order: endianness, glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat, width, height, depth, array elements, faces, mip levels, key value bytes
+    const uint32_t glUnsignedByte = 0x1401;
+    const uint32_t glRgba = 0x1908;
+    if (header[0] != 0x04030201){
+        throw std::runtime_error("Ktx texture has the wrong endianness!");
+    }
+    if (header[1] != glUnsignedByte || header[3] != glRgba || header[8] > 1 || header[9] > 1 || header[10] != 1){
+        throw std::runtime_error("Only uncompressed rgba8 2d ktx textures are supported!");
+    }
+
+    textureSource source;
+    source.width = header[6];
+    source.height = std::max(header[7], 1u);
+    uint32_t levelCount = std::max(header[11], 1u);
+    if (source.width == 0 || levelCount > mipLevelCount(source.width, source.height)){
+        throw std::runtime_error("Ktx texture has a bad size or too many mips!");
+    }
+
+    size_t position = sizeof(identifier) + sizeof(header) + header[12];
+    for (uint32_t level = 0; level < levelCount; level++){
+        uint32_t levelWidth = std::max(source.width >> level, 1u);
+        uint32_t levelHeight = std::max(source.height >> level, 1u);
+        size_t levelSize = static_cast<size_t>(levelWidth) * levelHeight * 4;
+
+        uint32_t imageSize;
+        if (data.size() < position + sizeof(imageSize)){
+            throw std::runtime_error("Ktx texture is missing mip levels!");
+        }
+        std::memcpy(&imageSize, data.data() + position, sizeof(imageSize));
+        position += sizeof(imageSize);
+
+        if (imageSize != levelSize || data.size() < position + levelSize){
+            throw std::runtime_error("Ktx texture level is the wrong size!");
+        }
+        const uint8_t* levelData = reinterpret_cast<const uint8_t*>(data.data() + position);
+        source.levels.emplace_back(levelData, levelData + levelSize);
+
+        // rgba8 rows are always 4 byte aligned so the only padding is what rounds the level up to 4
+        position += (levelSize + 3) & ~static_cast<size_t>(3);
+    }
+    return source;
+}
@@ -0,0 +1,32 @@
+#ifndef textureFile_hpp
+#define textureFile_hpp
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include "file.hpp"
+
+// A decoded texture, always rgba8 with the full size level first
+struct textureSource {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Only the one level when the file didn't come with mips, those get made on the gpu
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+// Decoders for the formats that can be read without pulling in a library
+// Binary ppm (P6) for plain images and uncompressed rgba8 ktx for ones with their mips already built
+class textureFile {
+public:
+    // Picks the decoder from the extension, throws on anything it can't read
+    static textureSource decode(const std::string& filename);
+    static uint32_t mipLevelCount(uint32_t width, uint32_t height);
+private:
+    static textureSource decodePpm(const std::vector<char>& data);
+    static textureSource decodeKtx(const std::vector<char>& data);
+};
+
+#endif /* textureFile_hpp */
@@ -0,0 +1,791 @@
+#include "textureStreamer.hpp"
+
+namespace {
+    void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages){
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1};
+        barrier.srcAccessMask = srcAccessMask;
+        barrier.dstAccessMask = dstAccessMask;
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment){
+        return (value + alignment - 1) / alignment * alignment;
+    }
+    
+    // Everything that samples a texture, the graphics queue can run compute too
+    const VkPipelineStageFlags shaderStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+}
+
+void textureStreamer::initMaterialSets(devices* initDevices, uint32_t initFramesInFlight){
+    pDevices = initDevices;
+    
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = materialSlots;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    
+    if (vkCreateDescriptorSetLayout(pDevices->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create material descriptor set layout!");
+    }
+    
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = initFramesInFlight * materialSlots;
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = initFramesInFlight;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    
+    if (vkCreateDescriptorPool(pDevices->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create material descriptor pool!");
+    }
+    
+    std::vector<VkDescriptorSetLayout> layouts(initFramesInFlight, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo setAllocInfo{};
+    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocInfo.descriptorPool = descriptorPool;
+    setAllocInfo.descriptorSetCount = initFramesInFlight;
+    setAllocInfo.pSetLayouts = layouts.data();
+    
+    materialSets.resize(initFramesInFlight);
+    if (vkAllocateDescriptorSets(pDevices->device, &setAllocInfo, materialSets.data()) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate material descriptor sets!");
+    }
+    
+    // Nothing's been written yet, so the first update fills in every slot
+    std::array<uint32_t, materialSlots> unwritten;
+    unwritten.fill(UINT32_MAX);
+    writtenVersions.assign(initFramesInFlight, unwritten);
+}
+
+void textureStreamer::initTextureStreamer(devices* initDevices, jobSystem* initJobSystem, deletionQueue* initDeletionQueue, objectPool* initObjectPool, settings* initSettings){
+    pDevices = initDevices;
+    pJobSystem = initJobSystem;
+    pDeletionQueue = initDeletionQueue;
+    pObjectPool = initObjectPool;
+    budget = static_cast<VkDeviceSize>(initSettings->textureBudget) * 1024 * 1024;
+    pressureSubscription = pDevices->memoryBudget.subscribe([this](const memoryPressure& pressure){
+        onMemoryPressure(pressure);
+    });
+    stagingSize = static_cast<VkDeviceSize>(std::max(initSettings->stagingSize, 1u)) * 1024 * 1024;
+    
+    // Mips get made with linear blits, which not every format can do
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(pDevices->physicalDevice, textureFormat, &formatProperties);
+    VkFormatFeatureFlags neededFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if ((formatProperties.optimalTilingFeatures & neededFeatures) != neededFeatures){
+        throw std::runtime_error("Texture format can't be filtered and blitted on this device!");
+    }
+    
+    // Uploads happen on the transfer queue and everything after on the graphics one, sharing the images saves an ownership transfer for each
+    concurrentFamilies = {pDevices->graphicsQueueFamily};
+    if (pDevices->transferQueueFamily != pDevices->graphicsQueueFamily){
+        concurrentFamilies.push_back(pDevices->transferQueueFamily);
+    }
+    
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    
+    if (vkCreateSampler(pDevices->device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create texture sampler!");
+    }
+    
+    createStagingRing();
+    createPlaceholder();
+}
+
+void textureStreamer::createStagingRing(){
+    // One persistently mapped buffer that every upload gets carved out of in order
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(pDevices->physicalDevice, &properties);
+    stagingAlignment = std::max<VkDeviceSize>(16, properties.limits.optimalBufferCopyOffsetAlignment);
+    stagingSize = alignUp(stagingSize, stagingAlignment);
+    
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = stagingSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    
+    if (vkCreateBuffer(pDevices->device, &bufferInfo, nullptr, &stagingBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create texture staging buffer!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(pDevices->device, stagingBuffer, &memoryRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::staging, &stagingMemory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate texture staging memory!");
+    }
+    vkBindBufferMemory(pDevices->device, stagingBuffer, stagingMemory, 0);
+    
+    void* mapped;
+    if (vkMapMemory(pDevices->device, stagingMemory, 0, stagingSize, 0, &mapped) != VK_SUCCESS){
+        throw std::runtime_error("Failed to map texture staging memory!");
+    }
+    stagingData = static_cast<uint8_t*>(mapped);
+}
+
+void textureStreamer::createPlaceholder(){
+    // A 1x1 white texture for anything that isn't in yet, so a material just shows its tint until its texture arrives, cleared once at startup since nothing is drawing yet
+    placeholder = createImage(1, 1, 1);
+    
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = pDevices->graphicsQueueFamily;
+    
+    VkCommandPool commandPool;
+    if (vkCreateCommandPool(pDevices->device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create placeholder texture command pool!");
+    }
+    
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(pDevices->device, &allocInfo, &commandBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate placeholder texture command buffer!");
+    }
+    
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    
+    VkClearColorValue white = {{1.0f, 1.0f, 1.0f, 1.0f}};
+    VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    imageBarrier(commandBuffer, placeholder.image, 0, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    vkCmdClearColorImage(commandBuffer, placeholder.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &range);
+    imageBarrier(commandBuffer, placeholder.image, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages);
+    
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to record placeholder texture command buffer!");
+    }
+    
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    
+    if (vkQueueSubmit(pDevices->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS){
+        throw std::runtime_error("Failed to submit placeholder texture command buffer!");
+    }
+    vkQueueWaitIdle(pDevices->graphicsQueue);
+    vkDestroyCommandPool(pDevices->device, commandPool, nullptr);
+}
+
+textureStreamer::residentImage textureStreamer::createImage(uint32_t width, uint32_t height, uint32_t mipLevels){
+    residentImage image;
+    image.width = width;
+    image.height = height;
+    image.mipLevels = mipLevels;
+    
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = textureFormat;
+    imageInfo.extent = {width, height, 1};
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    // Source for the mip blits and for the copy down to the tail when it gets evicted
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (concurrentFamilies.size() > 1){
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(concurrentFamilies.size());
+        imageInfo.pQueueFamilyIndices = concurrentFamilies.data();
+    } else {
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    
+    if (vkCreateImage(pDevices->device, &imageInfo, nullptr, &image.image) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create texture image!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(pDevices->device, image.image, &memoryRequirements);
+    image.size = memoryRequirements.size;
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = pDevices->findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    if (pDevices->memoryBudget.allocate(allocInfo, memoryCategory::images, &image.memory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate texture memory!");
+    }
+    vkBindImageMemory(pDevices->device, image.image, image.memory, 0);
+    
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = textureFormat;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1};
+    
+    if (vkCreateImageView(pDevices->device, &viewInfo, nullptr, &image.view) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create texture image view!");
+    }
+    return image;
+}
+
+void textureStreamer::destroyImage(const residentImage& image){
+    vkDestroyImageView(pDevices->device, image.view, nullptr);
+    vkDestroyImage(pDevices->device, image.image, nullptr);
+    pDevices->memoryBudget.free(image.memory);
+}
+
+uint32_t textureStreamer::requestTexture(const std::string& filename){
+    uint32_t texture;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        texture = static_cast<uint32_t>(textures.size());
+        textures.emplace_back();
+        textures.back().filename = filename;
+        textures.back().busy = true;
+        textures.back().lastUsedFrame = frame;
+    }
+    
+    pJobSystem->runBackground([this, texture](){
+        decode(texture);
+    }, &decodeJobs);
+    return texture;
+}
+
+void textureStreamer::decode(uint32_t texture){
+    // Runs on a worker, the file read and decode are the slow part and nothing else touches the texture until it's on the decoded list
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        filename = textures[texture].filename;
+    }
+    
+    std::unique_ptr<textureSource> source;
+    try {
+        source = std::make_unique<textureSource>(textureFile::decode(filename));
+    } catch (const std::exception& error) {
+        std::cerr << "Failed to load texture " << filename << ": " << error.what() << std::endl;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    streamedTexture& streamed = textures[texture];
+    if (!source){
+        streamed.failed = true;
+        streamed.busy = false;
+        return;
+    }
+    streamed.source = std::move(source);
+    decoded.push_back(texture);
+}
+
+void textureStreamer::update(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        frame++;
+    }
+    finishedUploads.clear();
+    evictions.clear();
+    waitSemaphores.clear();
+    
+    retireBatches();
+    uploadDecoded();
+    enforceBudget();
+    promoteRecent();
+}
+
+void textureStreamer::retireBatches(){
+    // Batches finish in the order they were submitted, so stop at the first one that hasn't
+    while (!inFlightBatches.empty()){
+        uploadBatch& batch = inFlightBatches.front();
+        if (vkGetFenceStatus(pDevices->device, batch.fence) != VK_SUCCESS){
+            break;
+        }
+        ringFreed = batch.ringEnd;
+        
+        // The fence says the copies are done, the semaphore is still waited on so the graphics queue is properly ordered after them
+        for (const auto& upload : batch.uploads){
+            finishedUploads.push_back(upload);
+            publish(upload.texture, upload.image, upload.residency);
+        }
+        waitSemaphores.push_back(batch.semaphore);
+        
+        // This frame waits on the semaphore, the pool only takes everything back once the frame is done
+        pObjectPool->releaseCommandBuffer(pDevices->transferQueueFamily, batch.commandBuffer);
+        pObjectPool->releaseFence(batch.fence);
+        pObjectPool->releaseSemaphore(batch.semaphore);
+        inFlightBatches.pop_front();
+    }
+}
+
+void textureStreamer::uploadDecoded(){
+    std::vector<uint32_t> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(decoded);
+    }
+    if (ready.empty()){
+        return;
+    }
+    
+    // The pool hands these back reset, after the first few frames it's never making new ones
+    uploadBatch batch{};
+    batch.commandBuffer = pObjectPool->acquireCommandBuffer(pDevices->transferQueueFamily);
+    batch.fence = pObjectPool->acquireFence();
+    batch.semaphore = pObjectPool->acquireSemaphore();
+    
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS){
+        throw std::runtime_error("Failed to begin texture upload command buffer!");
+    }
+    
+    // Whatever doesn't fit in the ring this frame waits for the next one
+    std::vector<uint32_t> leftover;
+    for (uint32_t texture : ready){
+        if (!uploadTexture(texture, batch)){
+            leftover.push_back(texture);
+        }
+    }
+    if (!leftover.empty()){
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.insert(decoded.begin(), leftover.begin(), leftover.end());
+    }
+    
+    if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to record texture upload command buffer!");
+    }
+    if (batch.uploads.empty()){
+        // Never submitted, so all three can go straight back
+        pObjectPool->releaseCommandBuffer(pDevices->transferQueueFamily, batch.commandBuffer);
+        pObjectPool->releaseFence(batch.fence);
+        pObjectPool->releaseSemaphore(batch.semaphore);
+        return;
+    }
+    
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &batch.semaphore;
+    
+    // Only the render thread submits, so this is fine even when the transfer queue is really the graphics queue
+    if (vkQueueSubmit(pDevices->transferQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS){
+        throw std::runtime_error("Failed to submit texture uploads!");
+    }
+    batch.ringEnd = ringWritten;
+    inFlightBatches.push_back(std::move(batch));
+}
+
+bool textureStreamer::uploadTexture(uint32_t texture, uploadBatch& batch){
+    // Gets called from uploadDecoded with the texture busy, so the source can be read without holding the lock
+    textureSource* source;
+    textureResidency residency;
+    VkDeviceSize currentSize;
+    VkDeviceSize fullSize;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        source = textures[texture].source.get();
+        residency = textures[texture].residency;
+        currentSize = textures[texture].image.size;
+        fullSize = textures[texture].fullSize;
+    }
+    
+    // Files with their own mips go tail first so something close shows up fast, the rest comes in as a second upload
+    bool prebuilt = source->levels.size() > 1;
+    uint32_t imageLevels = prebuilt ? static_cast<uint32_t>(source->levels.size()) : textureFile::mipLevelCount(source->width, source->height);
+    uint32_t firstLevel = 0;
+    textureResidency target = textureResidency::full;
+    if (prebuilt && residency == textureResidency::none){
+        firstLevel = getTailLevel(source->width, source->height, imageLevels);
+        if (firstLevel > 0){
+            target = textureResidency::tail;
+        }
+    }
+    
+    // Coming back up from the tail only happens when the whole chain fits, otherwise it stays where it is
+    if (target == textureResidency::full && residency == textureResidency::tail){
+        VkDeviceSize estimate = fullSize != 0 ? fullSize : static_cast<VkDeviceSize>(source->width) * source->height * 16 / 3;
+        if (residentBytes - currentSize + estimate > getBudget()){
+            std::lock_guard<std::mutex> lock(mutex);
+            textures[texture].fullSize = estimate;
+            textures[texture].source.reset();
+            textures[texture].busy = false;
+            return true;
+        }
+    }
+    
+    uint32_t uploadLevels = prebuilt ? imageLevels - firstLevel : 1;
+    VkDeviceSize stagingNeeded = 0;
+    for (uint32_t level = firstLevel; level < firstLevel + uploadLevels; level++){
+        stagingNeeded += alignUp(source->levels[level].size(), stagingAlignment);
+    }
+    if (stagingNeeded > stagingSize){
+        std::lock_guard<std::mutex> lock(mutex);
+        std::cerr << "Texture " << textures[texture].filename << " is bigger than the staging ring, raise VKFUN_STAGING_SIZE to load it" << std::endl;
+        textures[texture].source.reset();
+        textures[texture].busy = false;
+        textures[texture].failed = true;
+        return true;
+    }
+    
+    VkDeviceSize offset;
+    if (!allocateStaging(stagingNeeded, offset)){
+        return false;
+    }
+    
+    uint32_t width = std::max(source->width >> firstLevel, 1u);
+    uint32_t height = std::max(source->height >> firstLevel, 1u);
+    residentImage image = createImage(width, height, imageLevels - firstLevel);
+    
+    imageBarrier(batch.commandBuffer, image.image, 0, image.mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    
+    std::vector<VkBufferImageCopy> regions;
+    for (uint32_t level = firstLevel; level < firstLevel + uploadLevels; level++){
+        const std::vector<uint8_t>& pixels = source->levels[level];
+        std::memcpy(stagingData + offset, pixels.data(), pixels.size());
+        
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - firstLevel, 0, 1};
+        region.imageExtent = {std::max(source->width >> level, 1u), std::max(source->height >> level, 1u), 1};
+        regions.push_back(region);
+        offset += alignUp(pixels.size(), stagingAlignment);
+    }
+    vkCmdCopyBufferToImage(batch.commandBuffer, stagingBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+    
+    // Layouts are left in transfer dst, the transfer queue can't name the shader stages that come next so the graphics side finishes them off
+    batch.uploads.push_back({texture, image, target, !prebuilt && image.mipLevels > 1});
+    return true;
+}
+
+bool textureStreamer::allocateStaging(VkDeviceSize size, VkDeviceSize& offset){
+    // An upload never wraps around the end, it skips to the start instead
+    uint64_t start = alignUp(ringWritten, stagingAlignment);
+    if (start % stagingSize + size > stagingSize){
+        start += stagingSize - start % stagingSize;
+    }
+    if (start + size - ringFreed > stagingSize){
+        return false;
+    }
+    offset = start % stagingSize;
+    ringWritten = start + size;
+    return true;
+}
+
+void textureStreamer::publish(uint32_t texture, const residentImage& image, textureResidency residency){
+    // From here on getImageView hands out the new image, the old one is left for the frames that might still use it
+    residentImage old;
+    bool requeue = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        streamedTexture& streamed = textures[texture];
+        old = streamed.image;
+        streamed.image = image;
+        streamed.residency = residency;
+        streamed.version++;
+        
+        if (residency == textureResidency::full){
+            streamed.fullSize = image.size;
+            streamed.source.reset();
+            streamed.busy = false;
+        } else if (streamed.source){
+            // Tail of a texture that's still streaming, the rest of it goes up next
+            requeue = true;
+        }
+        if (requeue){
+            decoded.push_back(texture);
+        }
+    }
+    
+    residentBytes += image.size;
+    if (old.image != VK_NULL_HANDLE){
+        residentBytes -= old.size;
+        pDeletionQueue->push([this, old](){
+            destroyImage(old);
+        });
+    }
+}
+
+uint32_t textureStreamer::getTailLevel(uint32_t width, uint32_t height, uint32_t mipLevels){
+    // Zero means there's no tail worth having, either it's small already or the chain never gets small
+    for (uint32_t level = 0; level < mipLevels; level++){
+        if (std::max(width >> level, height >> level) <= tailSize){
+            return level;
+        }
+    }
+    return 0;
+}
+
+void textureStreamer::onMemoryPressure(const memoryPressure& pressure){
+    // Textures only live in device local memory, the rest of the heaps aren't ours to worry about
+    if (!pressure.deviceLocal){
+        return;
+    }
+    if (pressure.bytesToFree == 0){
+        pressureLimit = UINT64_MAX;
+        return;
+    }
+    
+    const uint64_t settleFrames = 4;
+    if (pressureLimit == UINT64_MAX || frame >= pressureFrame + settleFrames){
+        VkDeviceSize limit = residentBytes > pressure.bytesToFree ? residentBytes - pressure.bytesToFree : 0;
+        pressureLimit = std::min(pressureLimit, limit);
+        pressureFrame = frame;
+    }
+}
+
+VkDeviceSize textureStreamer::getBudget(){
+    return std::min(budget, pressureLimit);
+}
+
+void textureStreamer::enforceBudget(){
+    if (residentBytes <= getBudget()){
+        return;
+    }
+    
+    // Least recently used first, only ones with their whole chain in and nothing else going on
+    std::vector<std::pair<uint64_t, uint32_t>> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t i = 0; i < textures.size(); i++){
+            const streamedTexture& streamed = textures[i];
+            if (streamed.residency == textureResidency::full && !streamed.busy && getTailLevel(streamed.image.width, streamed.image.height, streamed.image.mipLevels) > 0){
+                candidates.push_back({streamed.lastUsedFrame, i});
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    
+    for (const auto& candidate : candidates){
+        if (residentBytes <= getBudget()){
+            break;
+        }
+        evict(candidate.second);
+    }
+}
+
+void textureStreamer::evict(uint32_t texture){
+    // The tail levels get copied out on the graphics queue this frame, so there's never a point where nothing is resident
+    residentImage old;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        old = textures[texture].image;
+    }
+    uint32_t tailLevel = getTailLevel(old.width, old.height, old.mipLevels);
+    residentImage tail = createImage(std::max(old.width >> tailLevel, 1u), std::max(old.height >> tailLevel, 1u), old.mipLevels - tailLevel);
+    
+    evictions.push_back({old.image, tailLevel, tail});
+    publish(texture, tail, textureResidency::tail);
+}
+
+void textureStreamer::promoteRecent(){
+    // Something drawn last frame that's down to its tail comes back once the whole chain fits again, one a frame so a budget bump doesn't decode everything at once
+    uint32_t promoted = UINT32_MAX;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t i = 0; i < textures.size(); i++){
+            streamedTexture& streamed = textures[i];
+            if (streamed.residency != textureResidency::tail || streamed.busy || streamed.failed || streamed.lastUsedFrame + 1 < frame){
+                continue;
+            }
+            if (residentBytes - streamed.image.size + streamed.fullSize > getBudget()){
+                continue;
+            }
+            streamed.busy = true;
+            promoted = i;
+            break;
+        }
+    }
+    
+    if (promoted != UINT32_MAX){
+        pJobSystem->runBackground([this, promoted](){
+            decode(promoted);
+        }, &decodeJobs);
+    }
+}
+
+void textureStreamer::recordGraphicsWork(VkCommandBuffer commandBuffer){
+    // Uploads before evictions, an evicted texture might be one that only just finished
+    for (const auto& upload : finishedUploads){
+        if (upload.generateMips){
+            recordMipGeneration(commandBuffer, upload.image);
+        } else {
+            imageBarrier(commandBuffer, upload.image.image, 0, upload.image.mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages);
+        }
+    }
+    for (const auto& eviction : evictions){
+        recordEviction(commandBuffer, eviction);
+    }
+}
+
+void textureStreamer::recordMipGeneration(VkCommandBuffer commandBuffer, const residentImage& image){
+    // Each level gets blitted from the one above it, every level is in transfer dst from the upload
+    int32_t width = static_cast<int32_t>(image.width);
+    int32_t height = static_cast<int32_t>(image.height);
+    
+    for (uint32_t level = 1; level < image.mipLevels; level++){
+        imageBarrier(commandBuffer, image.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        
+        int32_t nextWidth = std::max(width / 2, 1);
+        int32_t nextHeight = std::max(height / 2, 1);
+        VkImageBlit blit{};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+        blit.srcOffsets[1] = {width, height, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+        vkCmdBlitImage(commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        
+        imageBarrier(commandBuffer, image.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    
+    imageBarrier(commandBuffer, image.image, image.mipLevels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages);
+}
+
+void textureStreamer::recordEviction(VkCommandBuffer commandBuffer, const pendingEviction& eviction){
+    // The old image is only read here and then left for the deletion queue, so it never has to go back to shader read
+    const residentImage& tail = eviction.image;
+    imageBarrier(commandBuffer, eviction.source, eviction.firstLevel, tail.mipLevels, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | shaderStages, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    imageBarrier(commandBuffer, tail.image, 0, tail.mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    
+    std::vector<VkImageCopy> regions(tail.mipLevels);
+    for (uint32_t level = 0; level < tail.mipLevels; level++){
+        regions[level].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, eviction.firstLevel + level, 0, 1};
+        regions[level].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        regions[level].extent = {std::max(tail.width >> level, 1u), std::max(tail.height >> level, 1u), 1};
+    }
+    vkCmdCopyImage(commandBuffer, eviction.source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, tail.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+    
+    imageBarrier(commandBuffer, tail.image, 0, tail.mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages);
+}
+
+void textureStreamer::updateMaterialSet(uint32_t currentFrame, const std::vector<uint32_t>& materialTextures){
+    // Looking every slot up each frame is what counts the textures as used, so the eviction order and promoteRecent follow what's actually drawn
+    // This frame's fence is done so its set is free to rewrite, the other frames' sets catch up when their turn comes
+    materialFrame = currentFrame;
+    VkDescriptorImageInfo imageInfos[materialSlots];
+    VkWriteDescriptorSet writes[materialSlots];
+    uint32_t writeCount = 0;
+    for (uint32_t slot = 0; slot < materialSlots; slot++){
+        // Slots without a texture of their own get the placeholder
+        uint32_t texture = slot < materialTextures.size() ? materialTextures[slot] : UINT32_MAX;
+        VkImageView view = getImageView(texture);
+        uint32_t version = getVersion(texture);
+        if (writtenVersions[currentFrame][slot] == version){
+            continue;
+        }
+        writtenVersions[currentFrame][slot] = version;
+        
+        imageInfos[writeCount] = {sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        writes[writeCount] = {};
+        writes[writeCount].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[writeCount].dstSet = materialSets[currentFrame];
+        writes[writeCount].dstBinding = 0;
+        writes[writeCount].dstArrayElement = slot;
+        writes[writeCount].descriptorCount = 1;
+        writes[writeCount].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[writeCount].pImageInfo = &imageInfos[writeCount];
+        writeCount++;
+    }
+    if (writeCount > 0){
+        vkUpdateDescriptorSets(pDevices->device, writeCount, writes, 0, nullptr);
+    }
+}
+
+VkDescriptorSet textureStreamer::getMaterialSet(){
+    return materialSets[materialFrame];
+}
+
+const std::vector<VkSemaphore>& textureStreamer::getWaitSemaphores(){
+    return waitSemaphores;
+}
+
+VkImageView textureStreamer::getImageView(uint32_t texture){
+    std::lock_guard<std::mutex> lock(mutex);
+    if (texture >= textures.size()){
+        return placeholder.view;
+    }
+    streamedTexture& streamed = textures[texture];
+    streamed.lastUsedFrame = frame;
+    return streamed.image.view != VK_NULL_HANDLE ? streamed.image.view : placeholder.view;
+}
+
+uint32_t textureStreamer::getVersion(uint32_t texture){
+    std::lock_guard<std::mutex> lock(mutex);
+    return texture < textures.size() ? textures[texture].version : 0;
+}
+
+textureResidency textureStreamer::getResidency(uint32_t texture){
+    std::lock_guard<std::mutex> lock(mutex);
+    return texture < textures.size() ? textures[texture].residency : textureResidency::none;
+}
+
+void textureStreamer::destroyTextureStreamer(){
+    // The device has to be idle and the deletion queue flushed first, decodes still running get waited out here
+    pJobSystem->wait(&decodeJobs);
+    pDevices->memoryBudget.unsubscribe(pressureSubscription);
+    
+    uint32_t resident = 0;
+    for (const auto& streamed : textures){
+        if (streamed.residency != textureResidency::none){
+            resident++;
+        }
+    }
+    std::cout << "Textures: " << resident << " of " << textures.size() << " resident, " << residentBytes / (1024 * 1024) << " of " << budget / (1024 * 1024) << " MB budget" << std::endl;
+    
+    // The batches' sync objects belong to the pool, only the images they were uploading are left to free here
+    for (const auto& batch : inFlightBatches){
+        for (const auto& upload : batch.uploads){
+            destroyImage(upload.image);
+        }
+    }
+    for (const auto& streamed : textures){
+        if (streamed.image.image != VK_NULL_HANDLE){
+            destroyImage(streamed.image);
+        }
+    }
+    destroyImage(placeholder);
+    
+    vkUnmapMemory(pDevices->device, stagingMemory);
+    vkDestroyBuffer(pDevices->device, stagingBuffer, nullptr);
+    pDevices->memoryBudget.free(stagingMemory);
+    vkDestroySampler(pDevices->device, sampler, nullptr);
+    vkDestroyDescriptorPool(pDevices->device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(pDevices->device, descriptorSetLayout, nullptr);
+}
@@ -0,0 +1,179 @@
+#ifndef textureStreamer_hpp
+#define textureStreamer_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <array>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include "devices.hpp"
+#include "jobSystem.hpp"
+#include "deletionQueue.hpp"
+#include "objectPool.hpp"
+#include "settings.hpp"
+#include "textureFile.hpp"
+
+// How much of a texture's mip chain is on the gpu
+enum class textureResidency {
+    none,
+    // Just the small mips, enough to draw with while the rest streams in or after the big ones got evicted
+    tail,
+    full
+};
+
+// Streams textures in without ever making a frame wait on one
+// Files get decoded as background jobs on the job system, copied through a staging ring and uploaded on the transfer queue, then finished off (mips and layouts) at the start of a frame on the graphics queue
+// Residency is kept under a memory budget by dropping the least recently used textures back to their tail mips
+class textureStreamer{
+public:
+    // Made straight away, the main pipeline layout needs it before the rest of the streamer is ready
+    void initMaterialSets(devices* initDevices, uint32_t initFramesInFlight);
+    void initTextureStreamer(devices* initDevices, jobSystem* initJobSystem, deletionQueue* initDeletionQueue, objectPool* initObjectPool, settings* initSettings);
+    // Safe from any thread, the texture draws as a placeholder until it arrives
+    uint32_t requestTexture(const std::string& filename);
+    // Once a frame on the render thread, before the frame gets recorded
+    void update();
+    // Once a frame after update, points each material slot of this frame's set at whatever its texture has resident
+    void updateMaterialSet(uint32_t currentFrame, const std::vector<uint32_t>& materialTextures);
+    VkDescriptorSet getMaterialSet();
+    // Goes at the start of the frame's graphics work, finishes whatever update handed over this frame
+    void recordGraphicsWork(VkCommandBuffer commandBuffer);
+    // The frame's graphics submit has to wait on these at the transfer stage, they're from uploads recordGraphicsWork finishes
+    const std::vector<VkSemaphore>& getWaitSemaphores();
+    // Never waits, gives back the placeholder or whatever mips are resident right now and counts as a use for the eviction order
+    VkImageView getImageView(uint32_t texture);
+    // Goes up every time getImageView would hand back a different view, descriptors holding the old one need rewriting
+    uint32_t getVersion(uint32_t texture);
+    textureResidency getResidency(uint32_t texture);
+    void destroyTextureStreamer();
+    
+    // Trilinear, meant for everything this hands out
+    VkSampler sampler;
+    static const VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    // Has to match the array in the fragment shader, materials past the end sample the first slot
+    static const uint32_t materialSlots = 4;
+    VkDescriptorSetLayout descriptorSetLayout;
+private:
+    // A texture's image only holds the levels that are resident, so dropping mips means swapping it for a smaller one
+    struct residentImage {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 0;
+    };
+    
+    struct streamedTexture {
+        std::string filename;
+        textureResidency residency = textureResidency::none;
+        // Decoding or uploading, a texture only has one of those going at a time
+        bool busy = false;
+        bool failed = false;
+        residentImage image;
+        uint32_t version = 0;
+        uint64_t lastUsedFrame = 0;
+        // Known once it's been fully resident, so promoting it again can be checked against the budget first
+        VkDeviceSize fullSize = 0;
+        // Only held between decoding and the last upload that needs it
+        std::unique_ptr<textureSource> source;
+    };
+    
+    struct pendingUpload {
+        uint32_t texture;
+        residentImage image;
+        textureResidency residency;
+        // Only level 0 got uploaded and the rest get blitted down from it
+        bool generateMips;
+    };
+    
+    // Everything uploaded in one update goes in one submit
+    struct uploadBatch {
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+        VkSemaphore semaphore;
+        uint64_t ringEnd;
+        std::vector<pendingUpload> uploads;
+    };
+    
+    // The big levels of an evicted texture get left behind by copying the rest into a smaller image
+    struct pendingEviction {
+        VkImage source;
+        uint32_t firstLevel;
+        residentImage image;
+    };
+    
+    devices* pDevices;
+    jobSystem* pJobSystem;
+    deletionQueue* pDeletionQueue;
+    objectPool* pObjectPool;
+    
+    // Guards the textures and the decoded list, requests and lookups come from any thread
+    std::mutex mutex;
+    std::deque<streamedTexture> textures;
+    std::vector<uint32_t> decoded;
+    jobCounter decodeJobs;
+    uint64_t frame = 0;
+    VkDeviceSize budget;
+    VkDeviceSize residentBytes = 0;
+    // Lowered under the budget while video memory is under pressure, evictions take a few frames to actually free anything so it's only tightened again after that
+    VkDeviceSize pressureLimit = UINT64_MAX;
+    uint64_t pressureFrame = 0;
+    uint32_t pressureSubscription;
+    // Largest a mip tail gets, textures this small or smaller are never evicted
+    uint32_t tailSize = 64;
+    
+    // Written by the cpu at ringWritten and freed up to ringFreed once the batch that used it is done, both only ever go up
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    uint8_t* stagingData;
+    VkDeviceSize stagingSize;
+    VkDeviceSize stagingAlignment;
+    uint64_t ringWritten = 0;
+    uint64_t ringFreed = 0;
+    
+    // The batch's command buffer, fence and semaphore are borrowed from the pool and go back once the frame waiting on it is done
+    std::deque<uploadBatch> inFlightBatches;
+    std::vector<uint32_t> concurrentFamilies;
+    
+    // This frame's share of the graphics work, swapped out by every update
+    std::vector<pendingUpload> finishedUploads;
+    std::vector<pendingEviction> evictions;
+    std::vector<VkSemaphore> waitSemaphores;
+    
+    residentImage placeholder;
+    
+    // One set per frame in flight, each slot remembers the texture version it was last written with so unchanged ones are left alone
+    VkDescriptorPool descriptorPool;
+    std::vector<VkDescriptorSet> materialSets;
+    std::vector<std::array<uint32_t, materialSlots>> writtenVersions;
+    uint32_t materialFrame = 0;
+    
+    void createStagingRing();
+    void createPlaceholder();
+    residentImage createImage(uint32_t width, uint32_t height, uint32_t mipLevels);
+    void destroyImage(const residentImage& image);
+    void decode(uint32_t texture);
+    void retireBatches();
+    void uploadDecoded();
+    bool uploadTexture(uint32_t texture, uploadBatch& batch);
+    bool allocateStaging(VkDeviceSize size, VkDeviceSize& offset);
+    void enforceBudget();
+    void onMemoryPressure(const memoryPressure& pressure);
+    VkDeviceSize getBudget();
+    void promoteRecent();
+    void evict(uint32_t texture);
+    void publish(uint32_t texture, const residentImage& image, textureResidency residency);
+    uint32_t getTailLevel(uint32_t width, uint32_t height, uint32_t mipLevels);
+    void recordMipGeneration(VkCommandBuffer commandBuffer, const residentImage& image);
+    void recordEviction(VkCommandBuffer commandBuffer, const pendingEviction& eviction);
+};
+
+#endif /* textureStreamer_hpp */
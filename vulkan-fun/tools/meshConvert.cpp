@@ -0,0 +1,318 @@
+// Offline converter from .obj to the binary mesh format in meshFile.hpp
+// Built by the meshconvert target in the Xcode project, which compiles meshFile.cpp with it so the two can't drift apart
+// Without Xcode, build it next to the sources with
+//   c++ -std=c++17 -O2 -I.. meshConvert.cpp meshOptimizer.cpp ../meshFile.cpp ../file.cpp -o meshconvert
+// Usage
+//   meshconvert <input.obj> <output.vkmesh>
+//   meshconvert --benchmark <mesh.vkmesh> [iterations]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include "meshFile.hpp"
+#include "meshOptimizer.hpp"
+
+namespace {
+    // Vertices are unique per position, uv and normal combination like the face corners in the obj
+    struct cornerKey {
+        int position;
+        int uv;
+        int normal;
+        bool operator==(const cornerKey& other) const{
+            return position == other.position && uv == other.uv && normal == other.normal;
+        }
+    };
+    
+    struct cornerHash {
+        size_t operator()(const cornerKey& key) const{
+            return (static_cast<size_t>(key.position) * 73856093) ^ (static_cast<size_t>(key.uv) * 19349663) ^ (static_cast<size_t>(key.normal) * 83492791);
+        }
+    };
+    
+    // Obj indices start at 1 and negative ones count back from the end, zero means it wasn't given
+    int resolveIndex(const std::string& value, size_t count){
+        if (value.empty()){
+            return -1;
+        }
+        int index = std::atoi(value.c_str());
+        if (index < 0){
+            return static_cast<int>(count) + index;
+        }
+        return index - 1;
+    }
+    
+    meshFile::meshData importObj(const std::string& filename){
+        std::ifstream file(filename);
+        if (!file.is_open()){
+            throw std::runtime_error("Failed to open " + filename + "!");
+        }
+        
+        std::vector<float> positions;
+        std::vector<float> uvs;
+        std::vector<float> normals;
+        std::unordered_map<cornerKey, uint32_t, cornerHash> corners;
+        meshFile::meshData mesh;
+        bool missingNormals = false;
+        
+        std::string line;
+        while (std::getline(file, line)){
+            std::istringstream stream(line);
+            std::string type;
+            stream >> type;
+            
+            if (type == "v"){
+                float x, y, z;
+                stream >> x >> y >> z;
+                positions.insert(positions.end(), {x, y, z});
+            } else if (type == "vt"){
+                float u, v;
+                stream >> u >> v;
+                // Obj has v going up, vulkan samples with it going down
+                uvs.insert(uvs.end(), {u, 1.0f - v});
+            } else if (type == "vn"){
+                float x, y, z;
+                stream >> x >> y >> z;
+                normals.insert(normals.end(), {x, y, z});
+            } else if (type == "f"){
+                // Polygons become a fan of triangles around the first corner
+                std::vector<uint32_t> face;
+                std::string corner;
+                while (stream >> corner){
+                    std::string parts[3];
+                    size_t part = 0;
+                    for (char c : corner){
+                        if (c == '/'){
+                            part++;
+                        } else if (part < 3){
+                            parts[part] += c;
+                        }
+                    }
+                    
+                    cornerKey key{resolveIndex(parts[0], positions.size() / 3), resolveIndex(parts[1], uvs.size() / 2), resolveIndex(parts[2], normals.size() / 3)};
+                    if (key.position < 0 || key.position >= static_cast<int>(positions.size() / 3)){
+                        throw std::runtime_error("Face in " + filename + " points at a vertex that doesn't exist!");
+                    }
+                    
+                    auto existing = corners.find(key);
+                    if (existing != corners.end()){
+                        face.push_back(existing->second);
+                        continue;
+                    }
+                    
+                    meshVertex vertex{};
+                    std::memcpy(vertex.position, &positions[key.position * 3], sizeof(vertex.position));
+                    if (key.uv >= 0 && key.uv < static_cast<int>(uvs.size() / 2)){
+                        std::memcpy(vertex.uv, &uvs[key.uv * 2], sizeof(vertex.uv));
+                    }
+                    if (key.normal >= 0 && key.normal < static_cast<int>(normals.size() / 3)){
+                        std::memcpy(vertex.normal, &normals[key.normal * 3], sizeof(vertex.normal));
+                    } else {
+                        missingNormals = true;
+                    }
+                    
+                    uint32_t index = static_cast<uint32_t>(mesh.vertices.size());
+                    mesh.vertices.push_back(vertex);
+                    corners.emplace(key, index);
+                    face.push_back(index);
+                }
+                
+                for (size_t i = 2; i < face.size(); i++){
+                    mesh.indices.insert(mesh.indices.end(), {face[0], face[i - 1], face[i]});
+                }
+            }
+        }
+        
+        // Area weighted face normals summed onto each vertex, only for files that didn't have their own
+        if (missingNormals){
+            for (auto& vertex : mesh.vertices){
+                vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.0f;
+            }
+            for (size_t i = 0; i < mesh.indices.size(); i += 3){
+                const float* a = mesh.vertices[mesh.indices[i]].position;
+                const float* b = mesh.vertices[mesh.indices[i + 1]].position;
+                const float* c = mesh.vertices[mesh.indices[i + 2]].position;
+                float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+                float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+                float normal[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+                for (size_t corner = 0; corner < 3; corner++){
+                    for (int axis = 0; axis < 3; axis++){
+                        mesh.vertices[mesh.indices[i + corner]].normal[axis] += normal[axis];
+                    }
+                }
+            }
+            for (auto& vertex : mesh.vertices){
+                float length = std::sqrt(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+                if (length > 0.0f){
+                    for (int axis = 0; axis < 3; axis++){
+                        vertex.normal[axis] /= length;
+                    }
+                }
+            }
+        }
+        return mesh;
+    }
+    
+    // Vertex clustering, every vertex snaps to the first vertex in its grid cell and triangles that collapse get dropped
+    // Crude next to edge collapse but it needs nothing but the positions and runs in one pass
+    std::vector<uint32_t> clusterIndices(const meshFile::meshData& mesh, const std::vector<uint32_t>& indices, uint32_t cells, float& cellSize){
+        float boundsMin[3] = {INFINITY, INFINITY, INFINITY};
+        float boundsMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+        for (const auto& vertex : mesh.vertices){
+            for (int axis = 0; axis < 3; axis++){
+                boundsMin[axis] = std::min(boundsMin[axis], vertex.position[axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], vertex.position[axis]);
+            }
+        }
+        float extent = std::max({boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2], 1e-6f});
+        cellSize = extent / cells;
+        
+        std::unordered_map<uint64_t, uint32_t> representatives;
+        std::vector<uint32_t> remap(mesh.vertices.size());
+        for (uint32_t i = 0; i < mesh.vertices.size(); i++){
+            uint64_t cell = 0;
+            for (int axis = 0; axis < 3; axis++){
+                uint64_t coordinate = std::min(static_cast<uint64_t>((mesh.vertices[i].position[axis] - boundsMin[axis]) / cellSize), static_cast<uint64_t>(cells));
+                cell = cell * (cells + 1) + coordinate;
+            }
+            remap[i] = representatives.emplace(cell, i).first->second;
+        }
+        
+        std::vector<uint32_t> clustered;
+        for (size_t i = 0; i < indices.size(); i += 3){
+            uint32_t a = remap[indices[i]];
+            uint32_t b = remap[indices[i + 1]];
+            uint32_t c = remap[indices[i + 2]];
+            if (a != b && b != c && a != c){
+                clustered.insert(clustered.end(), {a, b, c});
+            }
+        }
+        return clustered;
+    }
+    
+    void buildLods(meshFile::meshData& mesh){
+        // Every level goes on the end of the index stream, all of them share the one vertex stream
+        std::vector<uint32_t> full = mesh.indices;
+        mesh.lods.push_back({0, static_cast<uint32_t>(full.size()), 0.0f, 0});
+        
+        const uint32_t lodCells[] = {64, 16};
+        for (uint32_t cells : lodCells){
+            float cellSize;
+            std::vector<uint32_t> lod = clusterIndices(mesh, full, cells, cellSize);
+            // Not worth a level if it barely dropped anything
+            if (lod.empty() || lod.size() * 4 > mesh.lods.back().indexCount * 3){
+                continue;
+            }
+            mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lod.size()), cellSize, 0});
+            mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        }
+    }
+    
+    void optimizeMesh(meshFile::meshData& mesh){
+        // Each level gets its own triangle order since they're drawn on their own, the vertex order has to suit all of them
+        uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        for (size_t level = 0; level < mesh.lods.size(); level++){
+            const meshLod& lod = mesh.lods[level];
+            float before = meshOptimizer::getAcmr(mesh.indices, lod.firstIndex, lod.indexCount, vertexCount);
+            
+            std::vector<size_t> clusters;
+            meshOptimizer::optimizeVertexCache(mesh.indices, lod.firstIndex, lod.indexCount, vertexCount, clusters);
+            float cacheOptimized = meshOptimizer::getAcmr(mesh.indices, lod.firstIndex, lod.indexCount, vertexCount);
+            meshOptimizer::optimizeOverdraw(mesh.indices, lod.firstIndex, lod.indexCount, mesh.vertices, clusters);
+            float after = meshOptimizer::getAcmr(mesh.indices, lod.firstIndex, lod.indexCount, vertexCount);
+            
+            std::cout << "lod " << level << " ACMR: " << before << " before, " << cacheOptimized << " after vertex cache, " << after << " after overdraw (" << clusters.size() << " clusters)" << std::endl;
+        }
+        meshOptimizer::optimizeVertexFetch(mesh.indices, mesh.vertices);
+    }
+    
+    void buildMeshlets(meshFile::meshData& mesh){
+        // Greedy runs of the full level's triangles, cut whenever a run would go past the vertex or triangle limit
+        const uint32_t maxVertices = 64;
+        const uint32_t maxTriangles = 124;
+        const meshLod& full = mesh.lods[0];
+        
+        auto finish = [&mesh](uint32_t first, uint32_t count){
+            float boundsMin[3] = {INFINITY, INFINITY, INFINITY};
+            float boundsMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+            for (uint32_t i = first; i < first + count; i++){
+                for (int axis = 0; axis < 3; axis++){
+                    boundsMin[axis] = std::min(boundsMin[axis], mesh.vertices[mesh.indices[i]].position[axis]);
+                    boundsMax[axis] = std::max(boundsMax[axis], mesh.vertices[mesh.indices[i]].position[axis]);
+                }
+            }
+            meshlet newMeshlet{first, count, {}, 0.0f};
+            for (int axis = 0; axis < 3; axis++){
+                newMeshlet.center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+            }
+            for (uint32_t i = first; i < first + count; i++){
+                const float* position = mesh.vertices[mesh.indices[i]].position;
+                float dx = position[0] - newMeshlet.center[0];
+                float dy = position[1] - newMeshlet.center[1];
+                float dz = position[2] - newMeshlet.center[2];
+                newMeshlet.radius = std::max(newMeshlet.radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+            }
+            mesh.meshlets.push_back(newMeshlet);
+        };
+        
+        std::vector<uint32_t> used;
+        uint32_t first = full.firstIndex;
+        for (uint32_t i = full.firstIndex; i < full.firstIndex + full.indexCount; i += 3){
+            uint32_t added = 0;
+            for (uint32_t corner = 0; corner < 3; corner++){
+                if (std::find(used.begin(), used.end(), mesh.indices[i + corner]) == used.end()){
+                    added++;
+                }
+            }
+            if (used.size() + added > maxVertices || (i - first) / 3 >= maxTriangles){
+                finish(first, i - first);
+                used.clear();
+                first = i;
+            }
+            for (uint32_t corner = 0; corner < 3; corner++){
+                if (std::find(used.begin(), used.end(), mesh.indices[i + corner]) == used.end()){
+                    used.push_back(mesh.indices[i + corner]);
+                }
+            }
+        }
+        if (full.firstIndex + full.indexCount > first){
+            finish(first, full.firstIndex + full.indexCount - first);
+        }
+    }
+}
+
+int main(int argc, char** argv){
+    try {
+        if (argc >= 3 && std::string(argv[1]) == "--benchmark"){
+            uint32_t iterations = argc >= 4 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 50;
+            meshFile::runBenchmark(argv[2], std::max(iterations, 1u));
+            return EXIT_SUCCESS;
+        }
+        if (argc != 3){
+            std::cerr << "Usage: meshconvert <input.obj> <output.vkmesh>" << std::endl;
+            std::cerr << "       meshconvert --benchmark <mesh.vkmesh> [iterations]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        
+        meshFile::meshData mesh = importObj(argv[1]);
+        if (mesh.indices.empty()){
+            throw std::runtime_error("No triangles in " + std::string(argv[1]) + "!");
+        }
+        buildLods(mesh);
+        // Meshlets come after so each one is a run of the cache friendly order, the fetch reorder only renumbers so it doesn't move them
+        optimizeMesh(mesh);
+        buildMeshlets(mesh);
+        meshFile::writeMesh(argv[2], mesh);
+        
+        std::cout << argv[2] << ": " << mesh.vertices.size() << " vertices, " << mesh.lods[0].indexCount / 3 << " triangles, " << mesh.lods.size() << " lods, " << mesh.meshlets.size() << " meshlets" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,216 @@
+#include "meshOptimizer.hpp"
+
+void meshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t first, size_t count, uint32_t vertexCount, std::vector<size_t>& clusters){
+    // Tipsify from Sander, Nehab and Barczak, fans out around one vertex at a time and picks the next one that's still in the cache
+    size_t triangleCount = count / 3;
+    const uint32_t* source = indices.data() + first;
+    
+    // Which triangles use each vertex, packed one vertex after another
+    std::vector<uint32_t> liveCount(vertexCount, 0);
+    for (size_t i = 0; i < count; i++){
+        liveCount[source[i]]++;
+    }
+    std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; v++){
+        adjacencyStart[v + 1] = adjacencyStart[v] + liveCount[v];
+    }
+    std::vector<uint32_t> adjacency(count);
+    std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < count; i++){
+        adjacency[fill[source[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(count);
+    
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;
+    int64_t fanning = triangleCount > 0 ? source[0] : -1;
+    bool restarted = true;
+    
+    while (fanning >= 0){
+        // A restart from the dead end stack or the cursor means the cache is cold, that's where a new cluster starts
+        if (restarted){
+            clusters.push_back(first + output.size());
+            restarted = false;
+        }
+        
+        candidates.clear();
+        for (uint32_t a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++){
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle]){
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++){
+                uint32_t v = source[triangle * 3 + corner];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+                if (time - cacheTime[v] > cacheSize){
+                    cacheTime[v] = time;
+                    time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+        
+        // Next fan is the candidate that'll still be in the cache once its own triangles are done, preferring the oldest
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates){
+            if (liveCount[v] == 0){
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * liveCount[v] <= cacheSize){
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority){
+                bestPriority = priority;
+                best = v;
+            }
+        }
+        
+        if (best < 0){
+            restarted = true;
+            while (!deadEnd.empty()){
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveCount[v] > 0){
+                    best = v;
+                    break;
+                }
+            }
+            while (best < 0 && cursor < vertexCount){
+                if (liveCount[cursor] > 0){
+                    best = cursor;
+                }
+                cursor++;
+            }
+        }
+        fanning = best;
+    }
+    
+    std::copy(output.begin(), output.end(), indices.begin() + first);
+}
+
+void meshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, size_t first, size_t count, const std::vector<meshVertex>& vertices, const std::vector<size_t>& clusters, float threshold){
+    // Sorts the clusters by how much they face away from the mesh's middle, the outer shell draws first and the depth test throws out what's under it
+    if (clusters.size() < 2){
+        return;
+    }
+    
+    float meshCenter[3] = {0.0f, 0.0f, 0.0f};
+    float meshArea = 0.0f;
+    struct clusterInfo {
+        size_t start;
+        size_t end;
+        float center[3];
+        float normal[3];
+        float sortKey;
+    };
+    std::vector<clusterInfo> infos;
+    
+    for (size_t c = 0; c < clusters.size(); c++){
+        clusterInfo info{clusters[c], c + 1 < clusters.size() ? clusters[c + 1] : first + count, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, 0.0f};
+        float clusterArea = 0.0f;
+        for (size_t i = info.start; i < info.end; i += 3){
+            const float* a = vertices[indices[i]].position;
+            const float* b = vertices[indices[i + 1]].position;
+            const float* c2 = vertices[indices[i + 2]].position;
+            float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            float ac[3] = {c2[0] - a[0], c2[1] - a[1], c2[2] - a[2]};
+            float normal[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+            float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (int axis = 0; axis < 3; axis++){
+                float centroid = (a[axis] + b[axis] + c2[axis]) / 3.0f;
+                info.center[axis] += centroid * area;
+                meshCenter[axis] += centroid * area;
+                info.normal[axis] += normal[axis];
+            }
+            clusterArea += area;
+        }
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f){
+            for (int axis = 0; axis < 3; axis++){
+                info.center[axis] /= clusterArea;
+            }
+        }
+        infos.push_back(info);
+    }
+    if (meshArea > 0.0f){
+        for (int axis = 0; axis < 3; axis++){
+            meshCenter[axis] /= meshArea;
+        }
+    }
+    
+    for (auto& info : infos){
+        float length = std::sqrt(info.normal[0] * info.normal[0] + info.normal[1] * info.normal[1] + info.normal[2] * info.normal[2]);
+        info.sortKey = 0.0f;
+        if (length > 0.0f){
+            for (int axis = 0; axis < 3; axis++){
+                info.sortKey += (info.center[axis] - meshCenter[axis]) * info.normal[axis] / length;
+            }
+        }
+    }
+    std::stable_sort(infos.begin(), infos.end(), [](const clusterInfo& a, const clusterInfo& b){
+        return a.sortKey > b.sortKey;
+    });
+    
+    std::vector<uint32_t> sorted(indices.begin(), indices.end());
+    size_t position = first;
+    for (const auto& info : infos){
+        std::copy(indices.begin() + info.start, indices.begin() + info.end, sorted.begin() + position);
+        position += info.end - info.start;
+    }
+    
+    // Every cluster starts with a cold cache anyway so this hardly ever trips, but a bad sort isn't worth the vertex work
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    if (getAcmr(sorted, first, count, vertexCount) <= getAcmr(indices, first, count, vertexCount) * threshold){
+        indices.swap(sorted);
+    }
+}
+
+void meshOptimizer::optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<meshVertex>& vertices){
+    // Vertices get read in about the order they're first indexed, so laying them out that way keeps the fetches sequential
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<meshVertex> reordered;
+    reordered.reserve(vertices.size());
+    
+    for (auto& index : indices){
+        if (remap[index] == UINT32_MAX){
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    // Left in so the count doesn't change, nothing draws them
+    for (size_t v = 0; v < vertices.size(); v++){
+        if (remap[v] == UINT32_MAX){
+            reordered.push_back(vertices[v]);
+        }
+    }
+    vertices.swap(reordered);
+}
+
+float meshOptimizer::getAcmr(const std::vector<uint32_t>& indices, size_t first, size_t count, uint32_t vertexCount){
+    // Fifo cache of cacheSize entries, a vertex is in it when it went in less than cacheSize misses ago
+    if (count < 3){
+        return 0.0f;
+    }
+    std::vector<uint32_t> insertedAt(vertexCount, 0);
+    uint32_t misses = 0;
+    for (size_t i = first; i < first + count; i++){
+        uint32_t v = indices[i];
+        if (insertedAt[v] == 0 || misses - insertedAt[v] >= cacheSize){
+            misses++;
+            insertedAt[v] = misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(count / 3);
+}
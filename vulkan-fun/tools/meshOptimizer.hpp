@@ -0,0 +1,28 @@
+#ifndef meshOptimizer_hpp
+#define meshOptimizer_hpp
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "meshFile.hpp"
+
+// Import stage that reorders a mesh for the gpu, run by meshConvert before the mesh gets written
+// Triangles for the post transform cache (tipsify), then clusters of them for overdraw, then vertices for fetch locality
+class meshOptimizer {
+public:
+    // Size the cache gets modeled as, small enough that it doesn't overfit to any one gpu
+    static const uint32_t cacheSize = 16;
+    
+    // Reorders the triangles in [first, first + count) of the index list, clusters gets where each run of the new order starts
+    static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t first, size_t count, uint32_t vertexCount, std::vector<size_t>& clusters);
+    // Sorts the clusters from optimizeVertexCache so ones facing out from the middle of the mesh draw first and hide what's behind them
+    // Keeps the cache order instead if sorting made the cache misses go up by more than threshold times
+    static void optimizeOverdraw(std::vector<uint32_t>& indices, size_t first, size_t count, const std::vector<meshVertex>& vertices, const std::vector<size_t>& clusters, float threshold = 1.05f);
+    // Renumbers vertices in the order the index list first uses them, unused ones end up at the back
+    static void optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<meshVertex>& vertices);
+    // Average cache miss ratio, transformed vertices per triangle with a fifo cache, 0.5 is the best a big regular mesh can do and 3 the worst
+    static float getAcmr(const std::vector<uint32_t>& indices, size_t first, size_t count, uint32_t vertexCount);
+};
+
+#endif /* meshOptimizer_hpp */
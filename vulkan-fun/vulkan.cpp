@@ -1,49 +1,346 @@
 #include "vulkan.hpp"
 
-void vulkan::initVulkan(const bool* initEnableValidationLayers, const std::vector<const char*>* initValidationLayers, const std::vector<const char*>* initDeviceExtensions, windowManager* initWindow, const int* initMaxFramesInFlight){
+void vulkan::initVulkan(const bool* initEnableValidationLayers, const std::vector<const char*>* initValidationLayers, const std::vector<const char*>* initDeviceExtensions, windowManager* initWindow, const int* initMaxFramesInFlight, settings* initSettings){
     pEnableValidationLayers = initEnableValidationLayers;
     pValidationLayers = initValidationLayers;
     pDeviceExtensions = initDeviceExtensions;
     pWindow = initWindow;
     pMaxFramesInFlight = initMaxFramesInFlight;
+    pSettings = initSettings;
     
     currentFrame = 0;
+    frameNumber = 0;
+    policyChanged = false;
+    swapchainDirty = false;
+    inputPending = false;
     
-    createInstance();
-    debugMessengerUtil.setupDebugMessenger(pEnableValidationLayers, &instance);
-    createSurface();
-    devices.initDeviceSetup(&surface, pDeviceExtensions, pEnableValidationLayers, pValidationLayers);
-    devices.pickPhysicalDevice(&instance);
-    devices.createLogicalDevice();
-    swapchain.createSwapChain(pWindow, &devices, &surface);
-    swapchain.createImageViews();
-    renderPass.createRenderPass(&devices, &swapchain);
-    graphicsPipeline.createGraphicsPipeline(&devices, &swapchain, &renderPass);
-    framebuffer.createFramebuffers(&devices, &swapchain, &renderPass);
-    commands.initCommands(&devices, &swapchain, &framebuffer, &renderPass, &graphicsPipeline);
-    createSyncObjects();
+    // Startup as a dependency graph, anything that doesn't need the step before it gets handed to the job system
+    // Shader loading starts straight away, sync objects go off once there's a device, and the pipeline compiles once it has shaders and a target
+    // With dynamic rendering the target is just formats so the pipeline overlaps the swapchain, with render passes it has to wait for the compiled graph
+    jobSystem.initJobSystem();
+    frameStats.initFrameStats("startup");
+    initError = nullptr;
+    
+    // Every counter lives on this stack, so they're all declared up front where the catch below can wait on them
+    jobCounter shadersLoaded, cullShadersLoaded, lightShadersLoaded, particleShadersLoaded, postShadersLoaded, syncCreated, streamerCreated, cullCreated, lightsCreated, particlesCreated, postCreated, pipelineCreated;
+    try {
+        runInitStep([this](){
+            graphicsPipeline.loadShaders(&pipelineManager);
+        }, &shadersLoaded);
+        runInitStep([this](){
+            occlusionCuller.loadShaders(&pipelineManager);
+        }, &cullShadersLoaded);
+        runInitStep([this](){
+            clusteredLights.loadShaders(&pipelineManager);
+        }, &lightShadersLoaded);
+        particlesEnabled = pSettings->particles > 0;
+        if (particlesEnabled){
+            runInitStep([this](){
+                particleSystem.loadShaders(&pipelineManager);
+            }, &particleShadersLoaded);
+        }
+        if (pSettings->postProcessing){
+            runInitStep([this](){
+                postProcess.loadShaders(&pipelineManager);
+            }, &postShadersLoaded);
+        }
+        
+        createInstance();
+        debugMessengerUtil.setupDebugMessenger(pEnableValidationLayers, &instance);
+        // The main thread makes the window while the instance was being created
+        pWindow->waitForWindow();
+        createSurface();
+        devices.initDeviceSetup(&surface, pDeviceExtensions, pEnableValidationLayers, pValidationLayers, pSettings);
+        devices.pickPhysicalDevice(&instance);
+        devices.createLogicalDevice();
+        pipelineManager.initPipelineManager(&devices);
+        deletionQueue.initDeletionQueue(*pMaxFramesInFlight);
+        objectPool.initObjectPool(devices.device, &deletionQueue);
+        // The pipeline layout needs the scene's, culling's, the lights', the shadows' and the materials' set layouts, so this can't wait for a job
+        scene.initScene(&devices, *pMaxFramesInFlight);
+        populateScene();
+        occlusionCuller.initOcclusionCuller(&devices, &renderGraph, &scene, pSettings, *pMaxFramesInFlight);
+        clusteredLights.initClusteredLights(&devices, pSettings, *pMaxFramesInFlight);
+        shadowAtlas.initShadowAtlas(&devices, &scene, &clusteredLights, *pMaxFramesInFlight);
+        textureStreamer.initMaterialSets(&devices, *pMaxFramesInFlight);
+        if (particlesEnabled){
+            particleSystem.initParticleSystem(&devices, pSettings, *pMaxFramesInFlight);
+        }
+        frameStats.setLabel(devices.dynamicRenderingEnabled ? "dynamic rendering" : "render pass");
+        frameStats.setLatencyMethod(devices.presentWaitEnabled ? "present wait" : "image reacquired");
+        
+        runInitStep([this](){
+            createSyncObjects();
+        }, &syncCreated);
+        
+        // The textures themselves stream in over the first frames, this only sets up the ring and the placeholder
+        runInitStep([this](){
+            textureStreamer.initTextureStreamer(&devices, &jobSystem, &deletionQueue, &objectPool, pSettings);
+            // Each texture goes to the material with the same index
+            for (const auto& texture : pSettings->textures){
+                materialTextures.push_back(textureStreamer.requestTexture(texture));
+            }
+        }, &streamerCreated);
+        
+        swapchain.setLatencyPolicy(pSettings->latency);
+        swapchain.selectSurfaceFormat(pWindow, &devices, &surface, &deletionQueue);
+        declareRenderGraph();
+        
+        // The graph knows what the swapchain images get used for and whether the compute queue touches them
+        swapchain.imageUsage = renderGraph.getSwapchainUsage();
+        swapchain.shareWithCompute = renderGraph.usesAsyncCompute();
+        
+        // Compute pipelines don't care about formats or render passes, they only need the device and the shaders
+        runInitStep([this](){
+            occlusionCuller.createPipelines();
+        }, &cullCreated, &cullShadersLoaded);
+        runInitStep([this](){
+            clusteredLights.createPipelines();
+        }, &lightsCreated, &lightShadersLoaded);
+        if (particlesEnabled){
+            runInitStep([this](){
+                particleSystem.createPipelines();
+            }, &particlesCreated, &particleShadersLoaded);
+        }
+        if (postEnabled){
+            runInitStep([this](){
+                postProcess.createPipelines();
+            }, &postCreated, &postShadersLoaded);
+        }
+        
+        // Dynamic rendering only needs the attachment formats, so the pipeline can compile while the swapchain gets made
+        // The target gets read here so the job never looks at the graph while it's being compiled
+        if (devices.dynamicRenderingEnabled){
+            passTarget mainTarget = renderGraph.getPassTarget(mainPass);
+            passTarget shadowTarget = renderGraph.getPassTarget(shadowPass);
+            runInitStep([this, mainTarget, shadowTarget](){
+                graphicsPipeline.createGraphicsPipeline(&devices, &swapchain, &deletionQueue, &mainTarget, {scene.descriptorSetLayout, occlusionCuller.descriptorSetLayout, clusteredLights.descriptorSetLayout, shadowAtlas.descriptorSetLayout, textureStreamer.descriptorSetLayout});
+                graphicsPipeline.createDepthOnlyPipeline(shadowTarget.renderPass, shadowTarget.depthFormat, {scene.descriptorSetLayout, shadowAtlas.descriptorSetLayout});
+                if (particlesEnabled){
+                    graphicsPipeline.createParticlePipeline({particleSystem.descriptorSetLayout});
+                }
+            }, &pipelineCreated, &shadersLoaded);
+        }
+        
+        swapchain.createSwapChain();
+        swapchain.createImageViews();
+        if (captureEnabled){
+            frameCapture.createBuffers();
+        }
+        framesInFlight = std::min(swapchain.framesInFlight, static_cast<uint32_t>(*pMaxFramesInFlight));
+        framePacer.initFramePacer(pWindow->getRefreshInterval(), pSettings->targetFps, pSettings->framePacing);
+        framePacer.setPresentMode(swapchain.presentMode);
+        compileRenderGraph();
+        
+        if (!devices.dynamicRenderingEnabled){
+            passTarget mainTarget = renderGraph.getPassTarget(mainPass);
+            passTarget shadowTarget = renderGraph.getPassTarget(shadowPass);
+            runInitStep([this, mainTarget, shadowTarget](){
+                graphicsPipeline.createGraphicsPipeline(&devices, &swapchain, &deletionQueue, &mainTarget, {scene.descriptorSetLayout, occlusionCuller.descriptorSetLayout, clusteredLights.descriptorSetLayout, shadowAtlas.descriptorSetLayout, textureStreamer.descriptorSetLayout});
+                graphicsPipeline.createDepthOnlyPipeline(shadowTarget.renderPass, shadowTarget.depthFormat, {scene.descriptorSetLayout, shadowAtlas.descriptorSetLayout});
+                if (particlesEnabled){
+                    graphicsPipeline.createParticlePipeline({particleSystem.descriptorSetLayout});
+                }
+            }, &pipelineCreated, &shadersLoaded);
+        }
+        
+        waitInitStep(&pipelineCreated);
+        waitInitStep(&cullCreated);
+        waitInitStep(&lightsCreated);
+        waitInitStep(&particlesCreated);
+        if (particlesEnabled){
+            std::cout << "Particles simulated on the " << (renderGraph.hasAsyncWork() ? "async compute" : "graphics") << " queue" << std::endl;
+        }
+        waitInitStep(&syncCreated);
+        waitInitStep(&streamerCreated);
+        // Clears the pyramid on the graphics queue, so it has to wait for the streamer to be done with it
+        occlusionCuller.createResources(sceneDepth, static_cast<uint32_t>(swapchain.swapChainImages.size()));
+        if (postEnabled){
+            waitInitStep(&postCreated);
+            postProcess.createDescriptors();
+            std::cout << "Post processing on the " << (renderGraph.hasAsyncWork() ? "async compute" : "graphics") << " queue" << std::endl;
+        } else {
+            // Whatever was queued still has to finish before init returns, the counter lives on this stack
+            jobSystem.wait(&postShadersLoaded);
+        }
+        imagesInFlight.assign(swapchain.swapChainImages.size(), VK_NULL_HANDLE);
+        imageInputTimes.resize(swapchain.swapChainImages.size());
+        imageHasInput.assign(swapchain.swapChainImages.size(), false);
+        commands.initCommands(&devices, &swapchain, &renderGraph, &deletionQueue);
+    } catch (...) {
+        // Something serial threw while jobs were still going, they have to finish before their counters go away with this stack
+        // The init steps keep their own exceptions so these waits can't throw over the one being handled
+        for (jobCounter* counter : {&shadersLoaded, &cullShadersLoaded, &lightShadersLoaded, &particleShadersLoaded, &postShadersLoaded, &syncCreated, &streamerCreated, &cullCreated, &lightsCreated, &particlesCreated, &postCreated, &pipelineCreated}){
+            jobSystem.wait(counter);
+        }
+        throw;
+    }
+    
+    frameStats.recordTiming("renderer init", frameStats.sinceStartup());
+}
+
+void vulkan::runInitStep(std::function<void()> step, jobCounter* counter, jobCounter* dependency){
+    // Serial init runs the step right here once its dependency is done, that's the old one at a time startup to compare against
+    if (pSettings->serialInit){
+        if (dependency != nullptr){
+            waitInitStep(dependency);
+        }
+        step();
+        return;
+    }
+    
+    // Exceptions can't cross threads on their own, so the first one gets kept and thrown again by waitInitStep
+    auto guardedStep = [this, step](){
+        try {
+            step();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(initErrorMutex);
+            if (!initError){
+                initError = std::current_exception();
+            }
+        }
+    };
+    
+    if (dependency != nullptr){
+        jobSystem.runAfter(dependency, guardedStep, counter);
+    } else {
+        jobSystem.run(guardedStep, counter);
+    }
+}
+
+void vulkan::waitInitStep(jobCounter* counter){
+    jobSystem.wait(counter);
+    
+    std::lock_guard<std::mutex> lock(initErrorMutex);
+    if (initError){
+        std::rethrow_exception(initError);
+    }
 }
 
 void vulkan::drawFrame(){
     // The big and real draw function, this will aquire an image from the swapchain, execute the command buffer wiht that image as an attachment in the framebuffer, and return the image to the swap chain for presentation
+    if (policyChanged){
+        policyChanged = false;
+        frameStats.printLatency(swapchain.getPolicyName());
+        swapchain.setLatencyPolicy(pendingPolicy);
+        swapchainDirty = true;
+    }
+    
+    if (swapchainDirty){
+        // A minimized window has no size to make a swapchain out of, so idle until it comes back
+        if (pWindow->framebufferWidth == 0 || pWindow->framebufferHeight == 0){
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return;
+        }
+        recreateSwapChain();
+    }
+    
+    frameStats.beginFrame();
+    // Polled on both sides of the fence wait so a present that lands during it is seen at most a frame late
+    collectPresentedInput();
     vkWaitForFences(devices.device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    collectPresentedInput();
     
     uint32_t imageIndex;
-    vkAcquireNextImageKHR(devices.device, swapchain.swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result = vkAcquireNextImageKHR(devices.device, swapchain.swapChain.get(), UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    
+    if (result == VK_ERROR_OUT_OF_DATE_KHR){
+        swapchainDirty = true;
+        return;
+    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR){
+        throw std::runtime_error("Failed to acquire swapchain image!");
+    }
+    
+    // Without present wait the next best thing is the image coming back, it was on screen until the one after it replaced it
+    // So this reads up to a refresh late, an upper bound rather than the real thing
+    if (imageHasInput[imageIndex]){
+        std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - imageInputTimes[imageIndex];
+        frameStats.recordLatency(latency.count());
+        imageHasInput[imageIndex] = false;
+    }
     
     if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
         vkWaitForFences(devices.device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        // The last submit that used this image is done so its timestamps can be read back
+        double gpuTime = commands.getGpuTime(imageIndex);
+        framePacer.recordGpuTime(gpuTime);
+        clusteredLights.recordGpuTime(gpuTime);
+        if (resolutionEnabled){
+            dynamicResolution.recordGpuTime(gpuTime);
+        }
     }
     imagesInFlight[imageIndex] = inFlightFences[currentFrame];
     
+    // Only once a frame is certain to be submitted, the streamer hands this frame work that has to go out with it
+    deletionQueue.nextFrame();
+    objectPool.nextFrame();
+    // Before the streamer so it hears about pressure in time to evict this frame
+    devices.memoryBudget.update();
+    textureStreamer.update();
+    textureStreamer.updateMaterialSet(static_cast<uint32_t>(currentFrame), materialTextures);
+    frameNumber++;
+    if (captureEnabled){
+        frameCapture.beginFrame(frameNumber, frameSerials[currentFrame]);
+    }
+    frameSerials[currentFrame] = frameNumber;
+    
+    // The scene, the lights and the particles don't share anything, so each gets its own worker
+    // The culler sizes its buffers off the scene's entity count so it goes after the scene in the same job
+    // This frame's instance buffer and light buffer are free now its fence is done
+    uint32_t frame = static_cast<uint32_t>(currentFrame);
+    jobCounter updated;
+    jobSystem.run([this, frame](){
+        animateScene();
+        scene.update(frame);
+        occlusionCuller.beginFrame(frame, getSceneExtent());
+    }, &updated);
+    jobSystem.run([this, frame](){
+        clusteredLights.update(frame);
+    }, &updated);
+    if (particlesEnabled){
+        jobSystem.run([this](){
+            particleSystem.update();
+        }, &updated);
+    }
+    
+    // The atlas picks its casters from the scene and hands tiles to the lights, so it waits on both, then the image's command buffer is free to record again
+    jobCounter frameWork;
+    jobSystem.runAfter(&updated, [this, frame, imageIndex](){
+        shadowAtlas.update(frame, getSceneExtent());
+        commands.recordCommandBuffer(imageIndex);
+    }, &frameWork);
+    // If any of them threw, the recording gets skipped and the exception comes back out of the wait below on this thread
+    
+    // Whatever input came in before this point is what this frame gets to show
+    if (inputPending){
+        if (devices.presentWaitEnabled){
+            pendingPresents.push_back({frameNumber, inputTime});
+        } else {
+            imageInputTimes[imageIndex] = inputTime;
+            imageHasInput[imageIndex] = true;
+        }
+        inputPending = false;
+    }
+    
+    jobSystem.wait(&frameWork);
+    
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    // Finished texture uploads get waited on too, they're already done so it never actually holds the frame up
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    if (!renderGraph.hasAsyncWork() || !renderGraph.swapchainOnAsync){
+        waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+        waitStages.push_back(renderGraph.swapchainWaitStages);
+    }
+    for (VkSemaphore uploadSemaphore : textureStreamer.getWaitSemaphores()){
+        waitSemaphores.push_back(uploadSemaphore);
+        waitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
     submitInfo.commandBufferCount = 1;
     VkCommandBuffer currentCommandBuffer = commands.commandBuffers[imageIndex];
     submitInfo.pCommandBuffers = &currentCommandBuffer;
@@ -54,24 +351,161 @@ void vulkan::drawFrame(){
     
     vkResetFences(devices.device, 1, &inFlightFences[currentFrame]);
     
-    if (vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS){
+    if (renderGraph.hasAsyncWork()){
+        // Split frame, the graphics half signals the compute half and the compute half is what the fence and present wait on
+        // The graphics half only waits on the acquire when it touches the swapchain, otherwise it starts drawing before there's even an image
+        VkSemaphore graphicsFinished = graphicsFinishedSemaphores[currentFrame];
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &graphicsFinished;
+        
+        if (vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS){
+            throw std::runtime_error("Failed to submit draw command buffers!");
+        }
+        
+        std::vector<VkSemaphore> computeWaitSemaphores = {graphicsFinished};
+        std::vector<VkPipelineStageFlags> computeWaitStages = {renderGraph.asyncWaitStages};
+        if (renderGraph.swapchainOnAsync){
+            computeWaitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+            computeWaitStages.push_back(renderGraph.swapchainWaitStages);
+        }
+        
+        VkSubmitInfo computeSubmitInfo{};
+        computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        computeSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(computeWaitSemaphores.size());
+        computeSubmitInfo.pWaitSemaphores = computeWaitSemaphores.data();
+        computeSubmitInfo.pWaitDstStageMask = computeWaitStages.data();
+        computeSubmitInfo.commandBufferCount = 1;
+        VkCommandBuffer asyncCommandBuffer = commands.asyncCommandBuffers[imageIndex];
+        computeSubmitInfo.pCommandBuffers = &asyncCommandBuffer;
+        computeSubmitInfo.signalSemaphoreCount = 1;
+        computeSubmitInfo.pSignalSemaphores = signalSemaphores;
+        
+        if (vkQueueSubmit(devices.computeQueue, 1, &computeSubmitInfo, inFlightFences[currentFrame]) != VK_SUCCESS){
+            throw std::runtime_error("Failed to submit async compute command buffers!");
+        }
+    } else if (vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS){
         throw std::runtime_error("Failed to submit draw command buffers!");
     }
+    // Only frames that actually went to the gpu move the pacer's schedule on, not the ones that bailed out before the submit
+    framePacer.frameSubmitted();
     
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
     presentInfo.pWaitSemaphores = signalSemaphores;
     
-    VkSwapchainKHR swapChains[] = {swapchain.swapChain};
+    VkSwapchainKHR swapChains[] = {swapchain.swapChain.get()};
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &imageIndex;
     
-    vkQueuePresentKHR(devices.presentQueue, &presentInfo);
-    vkQueueWaitIdle(devices.presentQueue);
+#ifdef VK_KHR_present_id
+    // Every present gets the frame number as its id so present wait can be asked about any of them, they only have to go up
+    VkPresentIdKHR presentId{};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.swapchainCount = 1;
+    presentId.pPresentIds = &frameNumber;
+    if (devices.presentWaitEnabled){
+        presentInfo.pNext = &presentId;
+    }
+#endif
+    
+    // No waiting on the queue here, the fences already keep the cpu at most framesInFlight frames ahead
+    result = vkQueuePresentKHR(devices.presentQueue, &presentInfo);
+    
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    frameStats.endFrame();
+    
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR){
+        swapchainDirty = true;
+    } else if (result != VK_SUCCESS){
+        throw std::runtime_error("Failed to present swapchain image!");
+    }
+}
+
+void vulkan::setLatencyPolicy(latencyPolicy newPolicy){
+    if (newPolicy != swapchain.policy){
+        pendingPolicy = newPolicy;
+        policyChanged = true;
+    }
+}
+
+void vulkan::collectPresentedInput(){
+#ifdef VK_KHR_present_wait
+    // Ids go up in the order they were presented, so the first one not on screen yet means none after it are either
+    while (!pendingPresents.empty()){
+        VkResult result = devices.waitForPresent(devices.device, swapchain.swapChain.get(), pendingPresents.front().presentId, 0);
+        if (result == VK_TIMEOUT){
+            return;
+        }
+        // Anything else is the swapchain going away, the frames it held will never be shown
+        if (result != VK_SUCCESS){
+            pendingPresents.clear();
+            return;
+        }
+        std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - pendingPresents.front().inputTime;
+        frameStats.recordLatency(latency.count());
+        pendingPresents.pop_front();
+    }
+#endif
+}
+
+void vulkan::noteInput(std::chrono::steady_clock::time_point time){
+    // Only the oldest input that hasn't made it to a frame yet matters, thats the one that waited the longest
+    if (!inputPending){
+        inputTime = time;
+        inputPending = true;
+    }
+}
+
+void vulkan::notifyResized(){
+    // Some platforms never report out of date on a resize, so don't wait for present to say so
+    swapchainDirty = true;
+}
+
+void vulkan::destroySwapChainObjects(){
+    // Everything that depends on the swapchain images, in reverse order of creation
+    // The swapchain and the command pools aren't here, making them again hands the old ones to the deletion queue
+    if (captureEnabled){
+        frameCapture.destroyBuffers();
+    }
+    if (postEnabled){
+        postProcess.destroyDescriptors();
+    }
+    occlusionCuller.destroyResources();
+    renderGraph.destroyRenderGraph();
+}
+
+void vulkan::recreateSwapChain(){
+    // Tears down and rebuilds everything sized off the swapchain, called from drawFrame once the window has a size again
+    swapchainDirty = false;
+    vkDeviceWaitIdle(devices.device);
+    destroySwapChainObjects();
+    
+    // The pipeline stays, viewport and scissor are dynamic and the format doesn't change so the new render passes are still compatible
+    swapchain.createSwapChain();
+    swapchain.createImageViews();
+    if (captureEnabled){
+        frameCapture.createBuffers();
+    }
+    renderGraph.compile();
+    occlusionCuller.createResources(sceneDepth, static_cast<uint32_t>(swapchain.swapChainImages.size()));
+    if (postEnabled){
+        postProcess.createDescriptors();
+    }
+    commands.initCommands(&devices, &swapchain, &renderGraph, &deletionQueue);
+    
+    // The device is idle so every fence is signaled and the frame slots can start over with the new count
+    imagesInFlight.assign(swapchain.swapChainImages.size(), VK_NULL_HANDLE);
+    framesInFlight = std::min(swapchain.framesInFlight, static_cast<uint32_t>(*pMaxFramesInFlight));
+    framePacer.setPresentMode(swapchain.presentMode);
+    currentFrame = 0;
+    // Whatever the old swapchain still had queued won't be reported on by the new one
+    pendingPresents.clear();
+    imageInputTimes.resize(swapchain.swapChainImages.size());
+    imageHasInput.assign(swapchain.swapChainImages.size(), false);
     
-    currentFrame = (currentFrame + 1) % *pMaxFramesInFlight;
+    std::cout << "Swapchain recreated, " << swapchain.getPolicyName() << " policy, " << swapchain.swapChainImages.size() << " images, " << framesInFlight << " frames in flight" << std::endl;
 }
 
 bool vulkan::checkValidationLayerSupport() {
@@ -114,7 +548,7 @@ void vulkan::createInstance(){
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.apiVersion = VK_API_VERSION_1_1;
-
+    
     // Pass the previous structure it into the createinfo structure
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -139,7 +573,7 @@ void vulkan::createInstance(){
         
         createInfo.pNext = nullptr;
     }
-
+    
     // Actually make the instance now that it has its filled out checklist of every detail to ever exist
     // Also Error checking for if any of the stuff above is causing trouble
     if(vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS){
@@ -153,12 +587,288 @@ void vulkan::createSurface(){
     }
 }
 
+void vulkan::declareRenderGraph(){
+    // Describes the frame as passes and the images they read and write, the graph works out the render passes, framebuffers and barriers
+    // The scene draws into an hdr image that the post chain finishes off into the swapchain, or straight into the swapchain without it
+    renderGraph.initRenderGraph(&devices, &swapchain, &deletionQueue, pSettings->asyncCompute);
+    backbuffer = renderGraph.importSwapchain("backbuffer");
+    
+    postEnabled = false;
+    if (pSettings->postProcessing){
+        postProcess.initPostProcess(&devices, &swapchain, &renderGraph, pSettings);
+        postEnabled = postProcess.isSupported();
+        if (!postEnabled){
+            std::cout << "Post processing can't write to this swapchain format, drawing straight to the swapchain" << std::endl;
+        }
+    }
+    captureEnabled = false;
+    if (pSettings->capture != captureFormat::off){
+        frameCapture.initFrameCapture(&devices, &swapchain, pSettings);
+        captureEnabled = frameCapture.isSupported();
+        if (!captureEnabled){
+            std::cout << "Can't read back this swapchain format, not capturing" << std::endl;
+        }
+    }
+    sceneColor = postEnabled ? renderGraph.createImage("scene", postProcess::sceneFormat) : backbuffer;
+    
+    // With dynamic resolution the scene draws into the corner of a full size image that gets blitted up to the real one
+    // The image is as big as the swapchain so changing the scale never reallocates anything, only the viewport and the blit change
+    resolutionEnabled = false;
+    VkFormat sceneTargetFormat = postEnabled ? postProcess::sceneFormat : swapchain.swapChainImageFormat;
+    if (pSettings->dynamicResolution){
+        bool blitToSwapchain = postEnabled || (swapchain.supportedUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+        resolutionEnabled = blitToSwapchain && dynamicResolution::supportsFormat(devices.physicalDevice, sceneTargetFormat);
+        if (resolutionEnabled){
+            double frameInterval = pSettings->targetFps > 0 ? 1000.0 / pSettings->targetFps : pWindow->getRefreshInterval();
+            double budget = pSettings->gpuBudget > 0.0 ? pSettings->gpuBudget : frameInterval * 0.9;
+            dynamicResolution.initDynamicResolution(budget, pSettings->minRenderScale);
+        } else {
+            std::cout << "Can't blit this scene format, rendering at full resolution" << std::endl;
+        }
+    }
+    sceneTarget = resolutionEnabled ? renderGraph.createImage("scene render", sceneTargetFormat) : sceneColor;
+    
+    // Mips and layouts for textures that finished uploading, before anything in the frame can sample them
+    uint32_t texturePass = renderGraph.addPass("texture uploads", passType::transfer);
+    renderGraph.setSideEffects(texturePass);
+    renderGraph.setRecordFunction(texturePass, [this](VkCommandBuffer commandBuffer, uint32_t){
+        textureStreamer.recordGraphicsWork(commandBuffer);
+    });
+    
+    // The lights only depend on the camera, so they get binned before anything is drawn
+    uint32_t lightPass = renderGraph.addPass("light binning", passType::compute);
+    renderGraph.setSideEffects(lightPass);
+    renderGraph.setRecordFunction(lightPass, [this](VkCommandBuffer commandBuffer, uint32_t){
+        float viewProjection[16];
+        getViewProjection(getSceneExtent(), viewProjection);
+        clusteredLights.recordBinning(commandBuffer, viewProjection);
+    });
+    
+    // Only the tiles whose light or casters changed get drawn, the atlas keeps the rest from earlier frames so it's imported rather than made by the graph
+    uint32_t atlasImage = renderGraph.importImage("shadow atlas", shadowAtlas.atlas, shadowAtlas.atlasView, shadowAtlas.depthFormat, {shadowAtlas::atlasSize, shadowAtlas::atlasSize}, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    shadowPass = renderGraph.addPass("shadow atlas", passType::graphics);
+    renderGraph.addDepthOutput(shadowPass, atlasImage, VK_ATTACHMENT_LOAD_OP_LOAD);
+    renderGraph.setRecordFunction(shadowPass, [this](VkCommandBuffer commandBuffer, uint32_t){
+        shadowAtlas.recordShadows(commandBuffer, &graphicsPipeline);
+    });
+    
+    // Culling runs twice around the main draw, first against the depth the last frame left, then again for whatever that hid against this frame's own depth
+    // Both halves draw into the same color and depth, the late one only adds what the early one got wrong
+    sceneDepth = renderGraph.createImage("scene depth", occlusionCuller::findDepthFormat(devices.physicalDevice));
+    uint32_t cullPass = renderGraph.addPass("cull early", passType::compute);
+    renderGraph.setSideEffects(cullPass);
+    renderGraph.setRecordFunction(cullPass, [this](VkCommandBuffer commandBuffer, uint32_t){
+        VkExtent2D extent = getSceneExtent();
+        float viewProjection[16];
+        getViewProjection(extent, viewProjection);
+        occlusionCuller.recordCull(commandBuffer, 0, viewProjection);
+    });
+    
+    VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
+    VkClearValue clearDepth{};
+    clearDepth.depthStencil = {1.0f, 0};
+    mainPass = renderGraph.addPass("main", passType::graphics);
+    renderGraph.addColorOutput(mainPass, sceneTarget, VK_ATTACHMENT_LOAD_OP_CLEAR, clearColor);
+    renderGraph.addDepthOutput(mainPass, sceneDepth, VK_ATTACHMENT_LOAD_OP_CLEAR, clearDepth);
+    renderGraph.addTextureInput(mainPass, atlasImage);
+    renderGraph.setRecordFunction(mainPass, [this](VkCommandBuffer commandBuffer, uint32_t){
+        recordScene(commandBuffer, 0);
+    });
+    
+    uint32_t pyramidPass = renderGraph.addPass("depth pyramid", passType::compute);
+    renderGraph.addTextureInput(pyramidPass, sceneDepth);
+    renderGraph.setSideEffects(pyramidPass);
+    renderGraph.setRecordFunction(pyramidPass, [this](VkCommandBuffer commandBuffer, uint32_t imageIndex){
+        occlusionCuller.recordPyramid(commandBuffer, imageIndex);
+    });
+    
+    uint32_t lateCullPass = renderGraph.addPass("cull late", passType::compute);
+    renderGraph.setSideEffects(lateCullPass);
+    renderGraph.setRecordFunction(lateCullPass, [this](VkCommandBuffer commandBuffer, uint32_t){
+        VkExtent2D extent = getSceneExtent();
+        float viewProjection[16];
+        getViewProjection(extent, viewProjection);
+        occlusionCuller.recordCull(commandBuffer, 1, viewProjection);
+    });
+    
+    uint32_t latePass = renderGraph.addPass("main late", passType::graphics);
+    renderGraph.addColorOutput(latePass, sceneTarget, VK_ATTACHMENT_LOAD_OP_LOAD);
+    renderGraph.addDepthOutput(latePass, sceneDepth, VK_ATTACHMENT_LOAD_OP_LOAD);
+    renderGraph.addTextureInput(latePass, atlasImage);
+    renderGraph.setRecordFunction(latePass, [this](VkCommandBuffer commandBuffer, uint32_t){
+        recordScene(commandBuffer, 1);
+        // See through, so after everything solid in the frame has been drawn
+        if (particlesEnabled){
+            float viewProjection[16];
+            getViewProjection(getSceneExtent(), viewProjection);
+            particleSystem.recordDraw(commandBuffer, &graphicsPipeline, viewProjection);
+        }
+    });
+    
+    // The scale only changes before a frame gets recorded, so this always reads the same one the main pass drew at
+    if (resolutionEnabled){
+        uint32_t upscalePass = renderGraph.addPass("upscale", passType::transfer);
+        renderGraph.addTransferInput(upscalePass, sceneTarget);
+        renderGraph.addTransferOutput(upscalePass, sceneColor);
+        renderGraph.setRecordFunction(upscalePass, [this](VkCommandBuffer commandBuffer, uint32_t imageIndex){
+            VkExtent2D fullExtent = renderGraph.getExtent(sceneColor);
+            VkExtent2D renderExtent = dynamicResolution.getRenderExtent(renderGraph.getExtent(sceneTarget));
+            
+            VkImageBlit blit{};
+            blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+            blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            blit.dstOffsets[1] = {static_cast<int32_t>(fullExtent.width), static_cast<int32_t>(fullExtent.height), 1};
+            vkCmdBlitImage(commandBuffer, renderGraph.getImage(sceneTarget, imageIndex), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renderGraph.getImage(sceneColor, imageIndex), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        });
+    }
+    
+    if (postEnabled){
+        postProcess.declarePasses(sceneColor, backbuffer);
+    }
+    
+    // Last thing in the frame, on whichever queue finished the image so it never adds a trip between queues
+    if (captureEnabled){
+        uint32_t capturePass = renderGraph.addPass("capture", passType::transfer);
+        renderGraph.addTransferInput(capturePass, backbuffer);
+        renderGraph.setSideEffects(capturePass);
+        if (postEnabled){
+            renderGraph.setAsyncCompute(capturePass);
+        }
+        renderGraph.setRecordFunction(capturePass, [this](VkCommandBuffer commandBuffer, uint32_t imageIndex){
+            frameCapture.recordCopy(commandBuffer, renderGraph.getImage(backbuffer, imageIndex));
+        });
+    }
+    
+    // Nothing else in the frame reads what it writes, a later frame draws it, so it can always go on the compute queue at the very end
+    if (particlesEnabled){
+        uint32_t particlePass = renderGraph.addPass("particles", passType::compute);
+        renderGraph.setSideEffects(particlePass);
+        renderGraph.setAsyncCompute(particlePass);
+        renderGraph.setRecordFunction(particlePass, [this](VkCommandBuffer commandBuffer, uint32_t){
+            particleSystem.recordSimulation(commandBuffer);
+        });
+    }
+}
+
+void vulkan::compileRenderGraph(){
+    auto start = std::chrono::steady_clock::now();
+    renderGraph.compile();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    frameStats.recordTiming("render graph compile", elapsed.count());
+}
+
+void vulkan::benchmarkRenderGraph(){
+    // Rebuilding the graph is what a resize costs, with dynamic rendering there are no render passes or framebuffers to remake
+    // Only safe once the device is idle since the command buffers still point at the old objects
+    const int rebuilds = 100;
+    
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rebuilds; i++){
+        renderGraph.destroyRenderGraph();
+        renderGraph.compile();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    frameStats.recordTiming("render graph rebuild (avg of 100)", elapsed.count() / rebuilds);
+}
+
+void vulkan::populateScene(){
+    // Without a count it's just the one triangle filling the middle of the window, like before there was a scene
+    sceneStart = std::chrono::steady_clock::now();
+    // Every entity is the same triangle, its corners are all within this of its origin
+    const float triangleRadius = 0.71f;
+    if (pSettings->sceneEntities == 0){
+        entityId entity = scene.createEntity();
+        scene.setBounds(entity, 0.0f, 0.0f, 0.0f, triangleRadius);
+        return;
+    }
+    
+    // Groups of a root and the children around it laid out on a grid, one group in eight spins so most of the scene never changes
+    // They sit behind one big triangle in the middle so occlusion culling has something to throw away
+    const uint32_t groupSize = 16;
+    uint32_t groups = std::max(1u, pSettings->sceneEntities / groupSize);
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(groups))));
+    float cell = 2.0f / side;
+    for (uint32_t group = 0; group < groups; group++){
+        entityId root = scene.createEntity();
+        scene.setPosition(root, -1.0f + cell * (group % side + 0.5f), -1.0f + cell * (group / side + 0.5f), 0.5f);
+        scene.setScale(root, cell * 0.5f, cell * 0.5f, 1.0f);
+        scene.setBounds(root, 0.0f, 0.0f, 0.0f, triangleRadius);
+        scene.setMesh(root, 0, group % 4);
+        if (group % 8 == 0){
+            spinningGroups.push_back(root);
+        }
+        
+        for (uint32_t child = 1; child < groupSize; child++){
+            float angle = 6.2831853f * child / (groupSize - 1);
+            entityId entity = scene.createEntity(root);
+            // A little in front of their root so the shadow casting lights have something to throw onto it
+            scene.setPosition(entity, std::cos(angle) * 0.8f, std::sin(angle) * 0.8f, -0.04f);
+            scene.setScale(entity, 0.3f, 0.3f, 1.0f);
+            scene.setBounds(entity, 0.0f, 0.0f, 0.0f, triangleRadius);
+            scene.setMesh(entity, 0, (group + child) % 4);
+        }
+    }
+    
+    entityId occluder = scene.createEntity();
+    scene.setPosition(occluder, 0.0f, 0.0f, 0.1f);
+    scene.setScale(occluder, 1.2f, 1.2f, 1.0f);
+    scene.setBounds(occluder, 0.0f, 0.0f, 0.0f, triangleRadius);
+}
+
+void vulkan::animateScene(){
+    // A turn about z every four seconds, the children follow their root without being touched
+    std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - sceneStart;
+    float halfAngle = elapsed.count() * 3.14159265f / 4.0f;
+    for (entityId root : spinningGroups){
+        scene.setRotation(root, 0.0f, 0.0f, std::sin(halfAngle), std::cos(halfAngle));
+    }
+}
+
+VkExtent2D vulkan::getSceneExtent(){
+    VkExtent2D extent = renderGraph.getExtent(sceneTarget);
+    if (resolutionEnabled){
+        extent = dynamicResolution.getRenderExtent(extent);
+    }
+    return extent;
+}
+
+void vulkan::getViewProjection(VkExtent2D extent, float* viewProjection){
+    // Buffers get rerecorded every frame, so the transform can follow the window without touching any memory
+    std::fill(viewProjection, viewProjection + 16, 0.0f);
+    viewProjection[0] = (float) extent.height / (float) extent.width;
+    viewProjection[5] = 1.0f;
+    viewProjection[10] = 1.0f;
+    viewProjection[15] = 1.0f;
+}
+
+void vulkan::recordScene(VkCommandBuffer commandBuffer, uint32_t phase){
+    // One indirect draw of whatever culling let through for the phase, each object's own transform comes from the instance buffer
+    VkExtent2D extent = getSceneExtent();
+    VkViewport viewport{0.0f, 0.0f, (float) extent.width, (float) extent.height, 0.0f, 1.0f};
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.graphicsPipeline);
+    VkDescriptorSet sets[5] = {scene.getDescriptorSet(), occlusionCuller.descriptorSet, clusteredLights.getDescriptorSet(), shadowAtlas.getDescriptorSet(), textureStreamer.getMaterialSet()};
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipelineLayout.get(), 0, 5, sets, 0, nullptr);
+    
+    drawConstants draw{};
+    getViewProjection(extent, draw.transform);
+    draw.materialId = 0;
+    draw.firstVisible = occlusionCuller.getFirstVisible(phase);
+    commands::pushConstants(commandBuffer, graphicsPipeline.pipelineLayout.get(), graphicsPipeline.drawRange, draw);
+    occlusionCuller.recordDraw(commandBuffer, phase);
+}
+
 void vulkan::createSyncObjects(){
     // Sets up the semaphores so that everything can be synced even if things finish at different rates
     imageAvailableSemaphores.resize(*pMaxFramesInFlight);
     renderFinishedSemaphores.resize(*pMaxFramesInFlight);
+    graphicsFinishedSemaphores.resize(*pMaxFramesInFlight);
     inFlightFences.resize(*pMaxFramesInFlight);
-    imagesInFlight.resize(swapchain.swapChainImages.size(), VK_NULL_HANDLE);
+    frameSerials.resize(*pMaxFramesInFlight, 0);
     
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -167,9 +877,9 @@ void vulkan::createSyncObjects(){
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
     
-    for (size_t i = 0; i < *pMaxFramesInFlight; i++){
-        if (vkCreateSemaphore(devices.device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS | vkCreateSemaphore(devices.device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS |
-            vkCreateFence(devices.device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS){
+    for (size_t i = 0; i < static_cast<size_t>(*pMaxFramesInFlight); i++){
+        if ((vkCreateSemaphore(devices.device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS) | (vkCreateSemaphore(devices.device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) |
+            (vkCreateFence(devices.device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) | (vkCreateSemaphore(devices.device, &semaphoreInfo, nullptr, &graphicsFinishedSemaphores[i]) != VK_SUCCESS)){
             throw std::runtime_error("failed to create sync objects for a frame!");
         }
     }
@@ -177,16 +887,55 @@ void vulkan::createSyncObjects(){
 
 void vulkan::destroyVulkan(){
     // Cleanup and Free the things used
-    for (size_t i = 0; i < *pMaxFramesInFlight; i++){
+    framePacer.printSummary();
+    devices.memoryBudget.printReport();
+    objectPool.printCounters();
+    scene.printSummary();
+    occlusionCuller.printSummary();
+    clusteredLights.printSummary();
+    shadowAtlas.printSummary();
+    if (particlesEnabled){
+        particleSystem.printSummary();
+    }
+    if (resolutionEnabled){
+        dynamicResolution.printSummary();
+    }
+    if (pSettings->benchmarkFrames > 0){
+        benchmarkRenderGraph();
+        jobSystem.runBenchmark();
+        std::cout << "Latency policy: " << swapchain.getPolicyName() << std::endl;
+        frameStats.printSummary();
+    }
+    
+    for (size_t i = 0; i < static_cast<size_t>(*pMaxFramesInFlight); i++){
         vkDestroySemaphore(devices.device, renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(devices.device, imageAvailableSemaphores[i], nullptr);
+        vkDestroySemaphore(devices.device, graphicsFinishedSemaphores[i], nullptr);
         vkDestroyFence(devices.device, inFlightFences[i], nullptr);
     }
-    commands.destroyCommands();
-    framebuffer.destroyFramebuffers();
-    graphicsPipeline.destroyGraphicsPipeline();
-    renderPass.destroyRenderPass();
-    swapchain.destroySwapChain();
+    destroySwapChainObjects();
+    // These own their handles, dropping them hands everything over to the deletion queue in one go and the flush below destroys it
+    commands = {};
+    graphicsPipeline = {};
+    swapchain = {};
+    if (postEnabled){
+        postProcess.destroyPostProcess();
+    }
+    if (captureEnabled){
+        frameCapture.destroyFrameCapture();
+    }
+    // Flushed first since some of what's queued hands things back to the streamer
+    deletionQueue.flush();
+    textureStreamer.destroyTextureStreamer();
+    objectPool.destroyObjectPool();
+    occlusionCuller.destroyOcclusionCuller();
+    shadowAtlas.destroyShadowAtlas();
+    if (particlesEnabled){
+        particleSystem.destroyParticleSystem();
+    }
+    clusteredLights.destroyClusteredLights();
+    scene.destroyScene();
+    pipelineManager.destroyPipelineManager();
     devices.destroyDevices();
     
     // Clean up the messenger system if validation layers are enabled
@@ -197,4 +946,5 @@ void vulkan::destroyVulkan(){
     // General Cleanup to free memory
     vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyInstance(instance, nullptr);
+    jobSystem.destroyJobSystem();
 }
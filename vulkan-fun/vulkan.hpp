@@ -7,45 +7,151 @@
 #include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <exception>
+#include <deque>
 #include "debugMessengerUtil.hpp"
 #include "windowManager.hpp"
 #include "devices.hpp"
 #include "swapchain.hpp"
 #include "graphicsPipeline.hpp"
-#include "renderPass.hpp"
-#include "frameBuffer.hpp"
+#include "postProcess.hpp"
+#include "pipelineManager.hpp"
+#include "deletionQueue.hpp"
+#include "objectPool.hpp"
+#include "textureStreamer.hpp"
+#include "scene.hpp"
+#include "occlusionCuller.hpp"
+#include "clusteredLights.hpp"
+#include "shadowAtlas.hpp"
+#include "particleSystem.hpp"
+#include "frameCapture.hpp"
+#include "renderGraph.hpp"
 #include "commands.hpp"
+#include "settings.hpp"
+#include "frameStats.hpp"
+#include "framePacer.hpp"
+#include "dynamicResolution.hpp"
+#include "jobSystem.hpp"
 
 class vulkan{
 public:
-    void initVulkan(const bool* initEnableValidationLayers, const std::vector<const char*>* initValidationLayers, const std::vector<const char*>* initDeviceExensions, windowManager* initWindow, const int* initMaxFramesInFlight);
+    void initVulkan(const bool* initEnableValidationLayers, const std::vector<const char*>* initValidationLayers, const std::vector<const char*>* initDeviceExensions, windowManager* initWindow, const int* initMaxFramesInFlight, settings* initSettings);
     void drawFrame();
+    // Applied at the start of the next frame by recreating the swapchain
+    void setLatencyPolicy(latencyPolicy newPolicy);
+    // Both come from the window's event queue, the render thread hands them over before drawing
+    void noteInput(std::chrono::steady_clock::time_point time);
+    void notifyResized();
     void destroyVulkan();
     
     devices devices;
+    frameStats frameStats;
+    framePacer framePacer;
+    dynamicResolution dynamicResolution;
+    // Shared by everything that wants to spread work over the cores, owned here since the render thread owns vulkan
+    jobSystem jobSystem;
 private:
     VkInstance instance;
     VkSurfaceKHR surface;
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
+    // Between the graphics and compute halves of a frame when the post chain runs async
+    std::vector<VkSemaphore> graphicsFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
     std::vector<VkFence> imagesInFlight;
+    // Frames that carried input, by the present id they went out with, until present wait says they reached the screen
+    struct presentedInput {
+        uint64_t presentId;
+        std::chrono::steady_clock::time_point inputTime;
+    };
+    std::deque<presentedInput> pendingPresents;
+    // Without present wait, the input each swapchain image carried, checked when acquire hands that image back
+    std::vector<std::chrono::steady_clock::time_point> imageInputTimes;
+    std::vector<bool> imageHasInput;
+    // Which frame each slot's fence was last submitted with, so once it signals everything up to that frame is known to be done
+    std::vector<uint64_t> frameSerials;
+    uint64_t frameNumber;
     size_t currentFrame;
+    uint32_t framesInFlight;
+    bool policyChanged;
+    latencyPolicy pendingPolicy;
+    bool swapchainDirty;
+    // The oldest input that hasn't been picked up by a frame yet
+    bool inputPending;
+    std::chrono::steady_clock::time_point inputTime;
     
     debugMessengerUtil debugMessengerUtil;
     swapchain swapchain;
-    renderPass renderPass;
+    renderGraph renderGraph;
+    pipelineManager pipelineManager;
     graphicsPipeline graphicsPipeline;
-    framebuffer framebuffer;
+    postProcess postProcess;
     commands commands;
+    deletionQueue deletionQueue;
+    objectPool objectPool;
+    textureStreamer textureStreamer;
+    // The streamer's handle for each material's texture, filled in by the job that starts the streamer
+    std::vector<uint32_t> materialTextures;
+    scene scene;
+    occlusionCuller occlusionCuller;
+    clusteredLights clusteredLights;
+    shadowAtlas shadowAtlas;
+    particleSystem particleSystem;
+    frameCapture frameCapture;
+    
+    // First failure from an init step that ran on a worker
+    std::exception_ptr initError;
+    std::mutex initErrorMutex;
+    
+    uint32_t backbuffer;
+    uint32_t sceneColor;
+    // What the main pass draws into, a full size image it only fills the corner of when dynamic resolution is on
+    uint32_t sceneTarget;
+    uint32_t sceneDepth;
+    uint32_t mainPass;
+    uint32_t shadowPass;
+    // Off when the settings say so or the swapchain format can't take the post chain's output
+    bool postEnabled;
+    // Off unless the settings ask for it, or when the scene's format can't be blitted
+    bool resolutionEnabled;
+    // Off unless the settings ask for it, or when the swapchain images can't be read back
+    bool captureEnabled;
+    // Off unless the settings ask for some particles
+    bool particlesEnabled;
     
     const bool* pEnableValidationLayers;
     const int* pMaxFramesInFlight;
     const std::vector<const char*>* pValidationLayers;
     const std::vector<const char*>* pDeviceExtensions;
     windowManager* pWindow;
+    settings* pSettings;
+    
+    // The roots that get turned every frame, everything else in the scene sits still after the first one
+    std::vector<entityId> spinningGroups;
+    std::chrono::steady_clock::time_point sceneStart;
     
+    void declareRenderGraph();
+    void compileRenderGraph();
+    void runInitStep(std::function<void()> step, jobCounter* counter, jobCounter* dependency = nullptr);
+    void waitInitStep(jobCounter* counter);
+    void benchmarkRenderGraph();
     void createSyncObjects();
+    void populateScene();
+    void animateScene();
+    // The part of the scene target drawn into this frame, all of it unless dynamic resolution has scaled it down
+    VkExtent2D getSceneExtent();
+    // Squashes x by the aspect ratio so the triangles don't stretch with the window, culling has to use the same one the draws do
+    void getViewProjection(VkExtent2D extent, float* viewProjection);
+    void recordScene(VkCommandBuffer commandBuffer, uint32_t phase);
+    // Records the latency of every frame with input that present wait says is on screen now, never blocks
+    void collectPresentedInput();
+    void recreateSwapChain();
+    void destroySwapChainObjects();
     bool checkValidationLayerSupport();
     void createInstance();
     void createSurface();
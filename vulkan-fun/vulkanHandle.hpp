@@ -0,0 +1,102 @@
+#ifndef vulkanHandle_hpp
+#define vulkanHandle_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <cstdint>
+#include "deletionQueue.hpp"
+
+// How many handles are owned right now and how many have gone through the deletion queue, for the shutdown report
+struct handleCounters {
+    static inline std::atomic<int64_t> live{0};
+    static inline std::atomic<uint64_t> deferred{0};
+};
+
+// Owns one device level handle, destroys it when it goes out of scope or gets reset
+// Only ever moved, so there's always exactly one thing responsible for the handle
+// With a deletion queue the destroy waits until every frame that could still be using the handle is done, without one it happens right away
+template <typename T>
+class uniqueHandle{
+public:
+    typedef void (VKAPI_PTR *destroyFunction)(VkDevice device, T handle, const VkAllocationCallbacks* pAllocator);
+    
+    uniqueHandle() = default;
+    uniqueHandle(VkDevice initDevice, T initHandle, destroyFunction initDestroy, deletionQueue* initDeletionQueue = nullptr){
+        device = initDevice;
+        handle = initHandle;
+        destroy = initDestroy;
+        pDeletionQueue = initDeletionQueue;
+        if (handle != VK_NULL_HANDLE){
+            handleCounters::live++;
+        }
+    }
+    uniqueHandle(const uniqueHandle&) = delete;
+    uniqueHandle& operator=(const uniqueHandle&) = delete;
+    uniqueHandle(uniqueHandle&& other) noexcept {
+        take(other);
+    }
+    uniqueHandle& operator=(uniqueHandle&& other) noexcept {
+        if (this != &other){
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+    ~uniqueHandle(){
+        reset();
+    }
+    
+    T get() const {
+        return handle;
+    }
+    // For the calls that want an array of handles, fine for a count of one
+    const T* address() const {
+        return &handle;
+    }
+    explicit operator bool() const {
+        return handle != VK_NULL_HANDLE;
+    }
+    
+    // Gives the handle up without destroying it, the caller owns it from here on
+    T release(){
+        T released = handle;
+        if (handle != VK_NULL_HANDLE){
+            handleCounters::live--;
+        }
+        handle = VK_NULL_HANDLE;
+        return released;
+    }
+    
+    void reset(){
+        if (handle == VK_NULL_HANDLE){
+            return;
+        }
+        VkDevice oldDevice = device;
+        T old = release();
+        destroyFunction oldDestroy = destroy;
+        if (pDeletionQueue != nullptr){
+            handleCounters::deferred++;
+            pDeletionQueue->push([oldDevice, old, oldDestroy](){
+                oldDestroy(oldDevice, old, nullptr);
+            });
+        } else {
+            oldDestroy(oldDevice, old, nullptr);
+        }
+    }
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    T handle = VK_NULL_HANDLE;
+    destroyFunction destroy = nullptr;
+    deletionQueue* pDeletionQueue = nullptr;
+    
+    void take(uniqueHandle& other){
+        device = other.device;
+        handle = other.handle;
+        destroy = other.destroy;
+        pDeletionQueue = other.pDeletionQueue;
+        other.handle = VK_NULL_HANDLE;
+    }
+};
+
+#endif /* vulkanHandle_hpp */
@@ -4,6 +4,7 @@ void windowManager::init(const bool* INIT_ENABLEVALIDATIONLAYERS, const uint32_t
     pEnableValidationLayers = INIT_ENABLEVALIDATIONLAYERS;
     pWIDTH = INIT_WIDTH;
     pHEIGHT = INIT_HEIGHT;
+    windowReady = windowCreated.get_future().share();
     
     initGLFW();
 }
@@ -11,11 +12,89 @@ void windowManager::init(const bool* INIT_ENABLEVALIDATIONLAYERS, const uint32_t
 void windowManager::initGLFW(){
     // Basic GLFW Setup code
     glfwInit();
+}
 
+void windowManager::createWindow(){
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
     window = glfwCreateWindow(*pWIDTH, *pHEIGHT, "Vulkan", nullptr, nullptr);
+    // The render thread is waiting on this either way, waitForWindow is where it finds out there's no window
+    if (window == nullptr){
+        windowCreated.set_value();
+        return;
+    }
+    
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    framebufferWidth = width;
+    framebufferHeight = height;
+    droppedEvents = 0;
+    
+    // Windowed mode doesn't have a monitor of its own so go with the primary one, and 60hz if glfw can't say
+    GLFWmonitor* monitor = glfwGetWindowMonitor(window);
+    if (monitor == nullptr){
+        monitor = glfwGetPrimaryMonitor();
+    }
+    const GLFWvidmode* mode = monitor != nullptr ? glfwGetVideoMode(monitor) : nullptr;
+    refreshInterval = (mode == nullptr || mode->refreshRate <= 0) ? 1000.0 / 60.0 : 1000.0 / mode->refreshRate;
+    
+    glfwSetWindowUserPointer(window, this);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetWindowCloseCallback(window, closeCallback);
+    
+    windowCreated.set_value();
+}
+
+void windowManager::waitForWindow(){
+    windowReady.wait();
+    if (window == nullptr){
+        throw std::runtime_error("Failed to create window!");
+    }
+}
+
+bool windowManager::pushEvent(inputEvent::eventType type, int code, int action){
+    // Never wait on the render thread here, if the queue is full the event just gets counted and dropped
+    inputEvent event{type, code, action, std::chrono::steady_clock::now()};
+    if (!events.push(event)){
+        droppedEvents++;
+        return false;
+    }
+    return true;
+}
+
+bool windowManager::retryClose(){
+    if (closePending && events.push({inputEvent::close, 0, 0, std::chrono::steady_clock::now()})){
+        closePending = false;
+    }
+    return closePending;
+}
+
+void windowManager::keyCallback(GLFWwindow* window, int key, int, int action, int){
+    auto manager = reinterpret_cast<windowManager*>(glfwGetWindowUserPointer(window));
+    manager->pushEvent(inputEvent::key, key, action);
+}
+
+void windowManager::mouseButtonCallback(GLFWwindow* window, int button, int action, int){
+    auto manager = reinterpret_cast<windowManager*>(glfwGetWindowUserPointer(window));
+    manager->pushEvent(inputEvent::mouseButton, button, action);
+}
+
+void windowManager::framebufferSizeCallback(GLFWwindow* window, int width, int height){
+    auto manager = reinterpret_cast<windowManager*>(glfwGetWindowUserPointer(window));
+    manager->framebufferWidth = width;
+    manager->framebufferHeight = height;
+    manager->pushEvent(inputEvent::resize, 0, 0);
+}
+
+void windowManager::closeCallback(GLFWwindow* window){
+    auto manager = reinterpret_cast<windowManager*>(glfwGetWindowUserPointer(window));
+    // Glfw only asks once, so a close that got dropped is kept for retryClose
+    if (!manager->pushEvent(inputEvent::close, 0, 0)){
+        manager->closePending = true;
+    }
 }
 
 std::vector<const char*> windowManager::getRequiredExtensions() {
@@ -33,6 +112,10 @@ std::vector<const char*> windowManager::getRequiredExtensions() {
     return extensions;
 }
 
+double windowManager::getRefreshInterval(){
+    return refreshInterval;
+}
+
 void windowManager::destroyWindow(){
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -4,21 +4,67 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include "spscQueue.hpp"
 
+// Everything the render thread needs to hear about from the window, stamped when glfw handed it over
+struct inputEvent {
+    enum eventType {
+        key,
+        mouseButton,
+        resize,
+        close
+    };
+    
+    eventType type;
+    int code;
+    int action;
+    std::chrono::steady_clock::time_point time;
+};
+
+// Owned by the main thread, glfw only lets most of its functions be called from there
+// The render thread only ever reads the event queue and the atomics below
 class windowManager {
 public:
+    // Only starts glfw, the window itself comes from createWindow so the renderer can get going on everything that doesn't need it
     void init(const bool* INIT_ENABLEVALIDATIONLAYERS, const uint32_t* INIT_WIDTH, const uint32_t* INIT_HEIGHT);
+    void createWindow();
+    // Blocks until createWindow has finished, safe from any thread
+    void waitForWindow();
+    // Main thread only, tries again to hand over a close the queue had no room for and says whether it's still waiting to go
+    bool retryClose();
     
     GLFWwindow* window;
     std::vector<const char*> getRequiredExtensions();
+    // Milliseconds between refreshes of the monitor the window is on, looked up once at init so any thread can ask
+    double getRefreshInterval();
     void destroyWindow();
     
+    spscQueue<inputEvent, 256> events;
+    // Kept up to date by the resize callback so the swapchain can be sized without calling into glfw
+    std::atomic<int> framebufferWidth;
+    std::atomic<int> framebufferHeight;
+    // Events that didn't fit because the render thread fell behind
+    std::atomic<uint32_t> droppedEvents;
+    
 private:
     const uint32_t* pWIDTH;
     const uint32_t* pHEIGHT;
     const bool* pEnableValidationLayers;
+    double refreshInterval;
+    std::promise<void> windowCreated;
+    std::shared_future<void> windowReady;
+    bool closePending = false;
     
     void initGLFW();
+    bool pushEvent(inputEvent::eventType type, int code, int action);
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+    static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+    static void closeCallback(GLFWwindow* window);
 };
 
 #endif /* windowManager_hpp */